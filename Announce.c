@@ -0,0 +1,267 @@
+// Copyright (c) 2013 by Wayne C. Gramlich.  All rights reserved.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include "Announce.h"
+#include "Double.h"
+#include "Integer.h"
+#include "Logger.h"
+#include "Logical.h"
+#include "Memory.h"
+#include "Unsigned.h"
+
+// *Announce_Queue* routines:
+//
+// The location and tag announce callbacks fire synchronously from the
+// detection thread inside *Fiducials__process*() and *Map__update*(),
+// so a slow consumer (e.g. a network publisher) directly inflates the
+// vision loop's worst-case frame time.  An *Announce_Queue* sits
+// between the two: the detection thread (the single producer) drops
+// plain pose records into a fixed ring and returns immediately, and a
+// drain thread (the single consumer) invokes the real publisher
+// callbacks at whatever rate the consumer can sustain.  When the
+// publisher falls behind, the oldest unpublished records are simply
+// overwritten -- for pose streams the newest data is the valuable
+// data.
+//
+// *Announce_Queue__location_announce*() and
+// *Announce_Queue__tag_announce*() have the same signatures as the
+// announce routine types, so a queue plugs straight into
+// *Fiducials__create*() as the announce object/routine pair.
+
+/// @brief The number of records in the ring (must be a power of 2.)
+#define ANNOUNCE_QUEUE__RECORDS_SIZE 64
+
+/// @brief Record kind: a robot location fix.
+#define ANNOUNCE_QUEUE__KIND_LOCATION 0
+
+/// @brief Record kind: a tag pose update.
+#define ANNOUNCE_QUEUE__KIND_TAG 1
+
+/// @brief *Announce_Record__Struct* is one plain announcement record.
+/// Location records use *twist* as the bearing and leave *dx*/*dy*/*dz*
+/// zero.
+typedef struct Announce_Record__Struct {
+    Double dx;
+    Double dy;
+    Double dz;
+    Integer id;
+    Unsigned kind;
+    Double twist;
+    Double x;
+    Double y;
+    Double z;
+} Announce_Record;
+
+struct Announce_Queue__Struct {
+    atomic_uint head;
+    Announce_Location_Routine location_routine;
+    Unsigned overwritten;
+    void *publish_object;
+    Announce_Record records[ANNOUNCE_QUEUE__RECORDS_SIZE];
+    volatile Logical shutdown;
+    atomic_uint tail;
+    Announce_Tag_Routine tag_routine;
+    pthread_t thread;
+};
+
+// *Announce_Queue__publish*() invokes the real publisher callback for
+// one drained *record*:
+
+static void Announce_Queue__publish(
+  Announce_Queue announce_queue, Announce_Record *record) {
+    if (record->kind == ANNOUNCE_QUEUE__KIND_LOCATION) {
+	announce_queue->location_routine(announce_queue->publish_object,
+	  record->id, record->x, record->y, record->z, record->twist);
+    } else {
+	announce_queue->tag_routine(announce_queue->publish_object,
+	  record->id, record->x, record->y, record->z, record->twist,
+	  record->dx, record->dy, record->dz);
+    }
+}
+
+// *Announce_Queue__drain*() is the drain thread entry point.  Both
+// indices increase monotonically; the producer never waits, so when it
+// laps the consumer the consumer first jumps *head* forward over the
+// overwritten records.  A drained record is copied out and then
+// validated against *tail* again, in case the producer overwrote the
+// slot mid copy:
+
+static void *Announce_Queue__drain(void *memory) {
+    Announce_Queue announce_queue = (Announce_Queue)memory;
+    while (1) {
+	Unsigned head =
+	  atomic_load_explicit(&announce_queue->head, memory_order_relaxed);
+	Unsigned tail =
+	  atomic_load_explicit(&announce_queue->tail, memory_order_acquire);
+	if (head == tail) {
+	    // The ring is empty:
+	    if (announce_queue->shutdown) {
+		break;
+	    }
+	    struct timespec pause = {0, 1000000};	// 1 millisecond
+	    nanosleep(&pause, (struct timespec *)0);
+	    continue;
+	}
+
+	// Skip over any records the producer has already overwritten.
+	// One slot is kept as a guard band: when the producer is a full
+	// ring ahead, the slot at *head* is the one it writes next (the
+	// producer fills the slot before publishing the new *tail*), so
+	// that slot is treated as overwritten too rather than drained:
+	if (tail - head >= ANNOUNCE_QUEUE__RECORDS_SIZE) {
+	    Unsigned skipped =
+	      tail - head - (ANNOUNCE_QUEUE__RECORDS_SIZE - 1);
+	    announce_queue->overwritten += skipped;
+	    head += skipped;
+	}
+
+	// Copy the record out, then make sure the producer did not
+	// reach the guard band and overwrite the slot while we were
+	// copying:
+	Announce_Record record = announce_queue->records[
+	  head & (ANNOUNCE_QUEUE__RECORDS_SIZE - 1)];
+	Unsigned tail_after =
+	  atomic_load_explicit(&announce_queue->tail, memory_order_acquire);
+	if (tail_after - head >= ANNOUNCE_QUEUE__RECORDS_SIZE) {
+	    // Torn copy; resync on the next lap:
+	    atomic_store_explicit(&announce_queue->head, head,
+	      memory_order_release);
+	    continue;
+	}
+	atomic_store_explicit(&announce_queue->head, head + 1,
+	  memory_order_release);
+
+	Announce_Queue__publish(announce_queue, &record);
+    }
+    return (void *)0;
+}
+
+// *Announce_Queue__append*() is the single-producer enqueue shared by
+// the two announce entry points:
+
+static void Announce_Queue__append(
+  Announce_Queue announce_queue, Announce_Record *record) {
+    Unsigned tail =
+      atomic_load_explicit(&announce_queue->tail, memory_order_relaxed);
+    announce_queue->records[
+      tail & (ANNOUNCE_QUEUE__RECORDS_SIZE - 1)] = *record;
+    atomic_store_explicit(&announce_queue->tail, tail + 1,
+      memory_order_release);
+}
+
+/// @brief Creates an announce queue in front of a publisher.
+/// @param publish_object is passed to the publisher callbacks.
+/// @param location_routine is the real location publisher (or null.)
+/// @param tag_routine is the real tag pose publisher (or null.)
+/// @returns the new *Announce_Queue* object.
+///
+/// *Announce_Queue__create*() starts the drain thread and returns the
+/// queue.  Pass the queue as the announce object together with
+/// *Announce_Queue__location_announce*()/*Announce_Queue__tag_announce*()
+/// to *Fiducials__create*() to decouple detection from publishing.
+/// Announcements of a kind whose routine is null are discarded.
+
+Announce_Queue Announce_Queue__create(void *publish_object,
+  Announce_Location_Routine location_routine,
+  Announce_Tag_Routine tag_routine) {
+    Announce_Queue announce_queue = Memory__new(Announce_Queue);
+    atomic_init(&announce_queue->head, 0);
+    announce_queue->location_routine = location_routine;
+    announce_queue->overwritten = 0;
+    announce_queue->publish_object = publish_object;
+    announce_queue->shutdown = (Logical)0;
+    atomic_init(&announce_queue->tail, 0);
+    announce_queue->tag_routine = tag_routine;
+    assert (pthread_create(&announce_queue->thread,
+      (pthread_attr_t *)0, Announce_Queue__drain,
+      (void *)announce_queue) == 0);
+    return announce_queue;
+}
+
+/// @brief Stops the drain thread and releases *announce_queue*.
+/// @param announce_queue to free.
+///
+/// *Announce_Queue__free*() drains any remaining records, stops the
+/// drain thread, and releases all storage.  The number of records
+/// overwritten because the publisher fell behind (if any) is logged.
+
+void Announce_Queue__free(Announce_Queue announce_queue) {
+    announce_queue->shutdown = (Logical)1;
+    assert (pthread_join(announce_queue->thread, (void **)0) == 0);
+    if (announce_queue->overwritten != 0) {
+	Logger__format(LOGGER__LEVEL_WARN,
+	  "Announce queue overwrote %d unpublished record(s)\n",
+	  announce_queue->overwritten);
+    }
+    Memory__free((Memory)announce_queue);
+}
+
+/// @brief Queues a location announcement (detection thread side.)
+/// @param object is the *Announce_Queue* (as an opaque pointer.)
+/// @param id is the id of the closest tag.
+/// @param x is the robot X location.
+/// @param y is the robot Y location.
+/// @param z is the robot Z location.
+/// @param bearing is the robot bearing in radians.
+///
+/// *Announce_Queue__location_announce*() writes one location record
+/// into the ring and returns immediately; it never blocks on the
+/// publisher.
+
+void Announce_Queue__location_announce(void *object, Integer id,
+  Double x, Double y, Double z, Double bearing) {
+    Announce_Queue announce_queue = (Announce_Queue)object;
+    if (announce_queue->location_routine == (Announce_Location_Routine)0) {
+	return;
+    }
+    Announce_Record record;
+    record.dx = 0.0;
+    record.dy = 0.0;
+    record.dz = 0.0;
+    record.id = id;
+    record.kind = ANNOUNCE_QUEUE__KIND_LOCATION;
+    record.twist = bearing;
+    record.x = x;
+    record.y = y;
+    record.z = z;
+    Announce_Queue__append(announce_queue, &record);
+}
+
+/// @brief Queues a tag pose announcement (detection thread side.)
+/// @param object is the *Announce_Queue* (as an opaque pointer.)
+/// @param id is the tag id.
+/// @param x is the tag X location.
+/// @param y is the tag Y location.
+/// @param z is the tag Z location.
+/// @param twist is the tag twist in radians.
+/// @param dx is the tag size along the X axis (before twist).
+/// @param dy is the tag size along the Y axis (before twist).
+/// @param dz is the tag height in the Z axis.
+///
+/// *Announce_Queue__tag_announce*() writes one tag pose record into
+/// the ring and returns immediately; it never blocks on the publisher.
+
+void Announce_Queue__tag_announce(void *object, Integer id,
+  Double x, Double y, Double z, Double twist, Double dx, Double dy, Double dz) {
+    Announce_Queue announce_queue = (Announce_Queue)object;
+    if (announce_queue->tag_routine == (Announce_Tag_Routine)0) {
+	return;
+    }
+    Announce_Record record;
+    record.dx = dx;
+    record.dy = dy;
+    record.dz = dz;
+    record.id = id;
+    record.kind = ANNOUNCE_QUEUE__KIND_TAG;
+    record.twist = twist;
+    record.x = x;
+    record.y = y;
+    record.z = z;
+    Announce_Queue__append(announce_queue, &record);
+}
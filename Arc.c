@@ -125,6 +125,7 @@ Unsigned Arc__hash(Arc arc) {
 
 Arc Arc__new(void) {
     Arc arc = Memory__new(Arc);
+    arc->checksum = 0;
     arc->distance = 0.0;
     arc->from_tag = (Tag)0;
     arc->from_twist = 0.0;
@@ -145,19 +146,19 @@ Arc Arc__new(void) {
 /// and return the resulting *Arc* object.  *Tag* objects all looked
 /// up using *map*.
 
-Arc Arc__read(File in_file, Map map) {
+Arc Arc__read(File_Reader in_file, Map map) {
     // Read <Arc ... /> tag:
-    File__tag_match(in_file, "Arc");
+    File_Reader__tag_match(in_file, "Arc");
     Unsigned from_tag_id =
-      (Unsigned)File__integer_attribute_read(in_file, "From_Tag_Id");
-    Double from_twist = File__float_attribute_read(in_file, "From_Twist");
-    Double distance = File__float_attribute_read(in_file, "Distance");
+      (Unsigned)File_Reader__integer_attribute_read(in_file, "From_Tag_Id");
+    Double from_twist = File_Reader__float_attribute_read(in_file, "From_Twist");
+    Double distance = File_Reader__float_attribute_read(in_file, "Distance");
     Unsigned to_tag_id =
-       (Unsigned)File__integer_attribute_read(in_file, "To_Tag_Id");
-    Double to_twist = File__float_attribute_read(in_file, "To_Twist");
-    Double goodness = File__float_attribute_read(in_file, "Goodness");
-    Logical in_tree = (Logical)File__integer_attribute_read(in_file, "In_Tree");
-    File__string_match(in_file, "/>\n");
+       (Unsigned)File_Reader__integer_attribute_read(in_file, "To_Tag_Id");
+    Double to_twist = File_Reader__float_attribute_read(in_file, "To_Twist");
+    Double goodness = File_Reader__float_attribute_read(in_file, "Goodness");
+    Logical in_tree = (Logical)File_Reader__integer_attribute_read(in_file, "In_Tree");
+    File_Reader__string_match(in_file, "/>\n");
 
     // Convert from degrees to radians:
     Double pi = (Double)3.14159265358979323846264;
@@ -171,6 +172,7 @@ Arc Arc__read(File in_file, Map map) {
     Arc arc =
       Arc__create(from_tag, from_twist, distance, to_tag, to_twist, goodness);
     arc->in_tree = in_tree;
+    Map__checksum_arc(map, arc);
     return arc;
 }
 
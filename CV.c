@@ -3,6 +3,8 @@
 #include <assert.h>
 #include <opencv/cv.h>
 #include <opencv/highgui.h>
+#include <pthread.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "Character.h"
@@ -295,6 +297,57 @@ Integer CV__round(Double value) {
     return cvRound(value);
 }
 
+// Undistortion map cache: recomputing the full resolution map_x/map_y
+// matrices with cvInitUndistortMap() takes noticeable seconds at high
+// resolutions and is identical run to run, so the computed maps are
+// cached to a binary sidecar file next to the calibration file.  The
+// header keys the cache on the parsed calibration parameters plus the
+// image dimensions; the maps are only trusted when all of them match
+// the current request exactly.
+
+/// @brief Magic number at the front of an undistortion map cache ("UMAP").
+#define CV__UNDISTORTION_CACHE_MAGIC 0x554d4150
+
+/// @brief Version number of the undistortion map cache layout.
+#define CV__UNDISTORTION_CACHE_VERSION 1
+
+typedef struct CV_Undistortion_Cache_Header__Struct
+  *CV_Undistortion_Cache_Header;
+
+/// @brief The fixed layout cache file header.  *parameters* holds the
+/// 8 calibration values (fc, cc, kc) the maps were computed from.
+struct CV_Undistortion_Cache_Header__Struct {
+    Unsigned magic;
+    Unsigned version;
+    Integer width;
+    Integer height;
+    double parameters[8];
+};
+
+// This routine reads the rows of one cached 32-bit float {map} from
+// {file}; it returns false if the file is truncated:
+
+static Logical CV__undistortion_cache_read(File file, CV_Image map) {
+    Integer width = map->width;
+    for (Integer y = 0; y < map->height; y++) {
+	float *row = (float *)(map->imageData + map->widthStep * y);
+	if (fread(row, sizeof(float), width, file) != (size_t)width) {
+	    return (Logical)0;
+	}
+    }
+    return (Logical)1;
+}
+
+// This routine writes the rows of one 32-bit float {map} to {file}:
+
+static void CV__undistortion_cache_write(File file, CV_Image map) {
+    Integer width = map->width;
+    for (Integer y = 0; y < map->height; y++) {
+	float *row = (float *)(map->imageData + map->widthStep * y);
+	assert (fwrite(row, sizeof(float), width, file) == (size_t)width);
+    }
+}
+
 // Read the calibration file and generate the undistortion maps
 // in:
 //   calibrate_file_name   -  camera calibration file
@@ -306,7 +359,7 @@ Integer CV__undistortion_setup(const char * calibrate_file_name,
  Integer width, Integer height, CV_Image *mapx, CV_Image *mapy) {
     Double fcx, fcy, ccx, ccy;
     Double kc[4];
-  
+
     // Open *calibrate_file_name*:
     File file = File__open(calibrate_file_name, "r");
     if (file == (File)0) {
@@ -316,32 +369,73 @@ Integer CV__undistortion_setup(const char * calibrate_file_name,
 
     // Scan in the calibration values:
     //  format is fc - focal length, cc, principal point, kc distortion vector
-    int x = fscanf(file, "fc %lf %lf cc %lf %lf kc %lf %lf %lf %lf", 
+    int x = fscanf(file, "fc %lf %lf cc %lf %lf kc %lf %lf %lf %lf",
        &fcx, &fcy, &ccx, &ccy, &kc[0], &kc[1], &kc[2], &kc[3]);
     if (x != 8) {
         File__format(stderr, "Expected 8 parameters got %d\n", x);
         return -1;
     }
     File__close(file);
-    
-    // Create *intrisic* matrix:
-    double intrinsic_vector[9] = {
-        fcx,   0, ccx,
-          0, fcy, ccy,
-          0,   0,   1
-    }; 
-    CvMat intrinsic = cvMat(3, 3, CV_64FC1, intrinsic_vector);
-    //printf("intrinsic matrix\n");
-    //dumpMat(&intrinsic);
-
-    // Create *distortion* matrix*:
-    CvMat distortion = cvMat(1, 4, CV_64FC1, kc);
-    //printf("distortion matrix\n");
-    //dumpMat(&distortion);
 
     *mapx = cvCreateImage(cvSize(width, height), IPL_DEPTH_32F, 1);
     *mapy = cvCreateImage(cvSize(width, height), IPL_DEPTH_32F, 1);
-    cvInitUndistortMap(&intrinsic, &distortion, *mapx, *mapy);
+
+    // Try to load previously computed maps from the binary sidecar file
+    // next to *calibrate_file_name*:
+    double parameters[8] = {fcx, fcy, ccx, ccy, kc[0], kc[1], kc[2], kc[3]};
+    String cache_file_name = String__format("%s.maps", calibrate_file_name);
+    Logical cached = (Logical)0;
+    File cache_file = File__open(cache_file_name, "rb");
+    if (cache_file != (File)0) {
+	struct CV_Undistortion_Cache_Header__Struct header;
+	if (fread(&header, sizeof(header), 1, cache_file) == 1 &&
+	  header.magic == CV__UNDISTORTION_CACHE_MAGIC &&
+	  header.version == CV__UNDISTORTION_CACHE_VERSION &&
+	  header.width == width && header.height == height &&
+	  memcmp(header.parameters, parameters, sizeof(parameters)) == 0) {
+	    // The cache matches this calibration and geometry exactly;
+	    // the maps load with two straight reads:
+	    cached = CV__undistortion_cache_read(cache_file, *mapx) &&
+	      CV__undistortion_cache_read(cache_file, *mapy);
+	}
+	File__close(cache_file);
+    }
+
+    if (!cached) {
+	// Create *intrisic* matrix:
+	double intrinsic_vector[9] = {
+	    fcx,   0, ccx,
+	      0, fcy, ccy,
+	      0,   0,   1
+	};
+	CvMat intrinsic = cvMat(3, 3, CV_64FC1, intrinsic_vector);
+	//printf("intrinsic matrix\n");
+	//dumpMat(&intrinsic);
+
+	// Create *distortion* matrix*:
+	CvMat distortion = cvMat(1, 4, CV_64FC1, kc);
+	//printf("distortion matrix\n");
+	//dumpMat(&distortion);
+
+	cvInitUndistortMap(&intrinsic, &distortion, *mapx, *mapy);
+
+	// Cache the computed maps for the next startup.  Failure to
+	// write the cache is not an error; the maps are already good:
+	cache_file = File__open(cache_file_name, "wb");
+	if (cache_file != (File)0) {
+	    struct CV_Undistortion_Cache_Header__Struct header;
+	    header.magic = CV__UNDISTORTION_CACHE_MAGIC;
+	    header.version = CV__UNDISTORTION_CACHE_VERSION;
+	    header.width = width;
+	    header.height = height;
+	    memcpy(header.parameters, parameters, sizeof(parameters));
+	    assert (fwrite(&header, sizeof(header), 1, cache_file) == 1);
+	    CV__undistortion_cache_write(cache_file, *mapx);
+	    CV__undistortion_cache_write(cache_file, *mapy);
+	    File__close(cache_file);
+	}
+    }
+    String__free(cache_file_name);
 
     return 0;
 }
@@ -355,6 +449,234 @@ void CV_Image__adaptive_threshold(CV_Image source_image,
       adaptive_method, threshold_type, block_size, parameter1);
 }
 
+void CV_Image__roi_set(CV_Image image,
+  Integer x, Integer y, Integer width, Integer height) {
+    cvSetImageROI(image, cvRect(x, y, width, height));
+}
+
+void CV_Image__roi_reset(CV_Image image) {
+    cvResetImageROI(image);
+}
+
+// This routine samples {size} {points} on the 8 bit gray {image} in a
+// single pass.  Each sample is the weighted average of the 9 pixel
+// neighborhood around the rounded point, using the 3 x 3 {weights}
+// table (scanned row major), matching CV_Image__point_sample.  The
+// image geometry is hoisted out of the loop and interior neighborhoods
+// are gathered with direct row pointer arithmetic; only points within
+// one pixel of the image edge take the bounds checked path.  The
+// samples are stored into {values}.
+
+void CV_Image__points_sample(CV_Image image, CV_Point2D32F_Vector points,
+  Unsigned size, Integer *weights, Integer *values) {
+    Integer width = image->width;
+    Integer height = image->height;
+    uchar *data = (uchar *)image->imageData;
+    int width_step = image->widthStep;
+
+    // The interior denominator never changes:
+    Integer weights_total = 0;
+    for (Unsigned index = 0; index < 9; index++) {
+	weights_total += weights[index];
+    }
+
+    for (Unsigned index = 0; index < size; index++) {
+	Integer x = cvRound(points[index].x);
+	Integer y = cvRound(points[index].y);
+	Integer numerator = 0;
+	Integer denominator = weights_total;
+	if (1 <= x && x < width - 1 && 1 <= y && y < height - 1) {
+	    // Interior point; gather the 9 pixels directly:
+	    uchar *row_above = data + width_step * (y - 1) + x;
+	    uchar *row = data + width_step * y + x;
+	    uchar *row_below = data + width_step * (y + 1) + x;
+	    numerator =
+	      weights[0] * row_above[-1] +
+	      weights[1] * row_above[0] +
+	      weights[2] * row_above[1] +
+	      weights[3] * row[-1] +
+	      weights[4] * row[0] +
+	      weights[5] * row[1] +
+	      weights[6] * row_below[-1] +
+	      weights[7] * row_below[0] +
+	      weights[8] * row_below[1];
+	} else {
+	    // Edge point; probe with bounds checks:
+	    denominator = 0;
+	    for (Integer j = -1; j <= 1; j++) {
+		for (Integer i = -1; i <= 1; i++) {
+		    Integer sample = CV_Image__gray_fetch(image, x + i, y + j);
+		    if (sample >= 0) {
+			Integer weight = weights[(j + 1) * 3 + (i + 1)];
+			numerator += sample * weight;
+			denominator += weight;
+		    }
+		}
+	    }
+	}
+	values[index] = (denominator > 0) ? numerator / denominator : 0;
+    }
+}
+
+// This routine computes summed area tables over the single channel
+// {image}: {sums}[i] accumulates the gray levels and {squares}[i]
+// their squares.  Both tables are (width + 1) x (height + 1) with a
+// zero first row and column, so the total over the half open pixel
+// rectangle [x1, x2) x [y1, y2) is
+//
+//     table[y2 * (width + 1) + x2] - table[y2 * (width + 1) + x1]
+//   - table[y1 * (width + 1) + x2] + table[y1 * (width + 1) + x1]
+//
+// The squares are kept as {Double} because the sum of squared gray
+// levels overflows 32 bits on multi-megapixel images.
+
+void CV_Image__integrals_compute(
+  CV_Image image, Unsigned *sums, Double *squares) {
+    Integer width = image->width;
+    Integer height = image->height;
+    uchar *data = (uchar *)image->imageData;
+    int width_step = image->widthStep;
+    Integer columns = width + 1;
+    for (Integer x = 0; x < columns; x++) {
+	sums[x] = 0;
+	squares[x] = 0.0;
+    }
+    for (Integer y = 0; y < height; y++) {
+	uchar *row = data + width_step * y;
+	Unsigned *sums_row = sums + columns * (y + 1);
+	Unsigned *previous_sums = sums + columns * y;
+	Double *squares_row = squares + columns * (y + 1);
+	Double *previous_squares = squares + columns * y;
+	Unsigned row_sum = 0;
+	Double row_square_sum = 0.0;
+	sums_row[0] = 0;
+	squares_row[0] = 0.0;
+	for (Integer x = 0; x < width; x++) {
+	    Unsigned gray = row[x];
+	    row_sum += gray;
+	    row_square_sum += (Double)(gray * gray);
+	    sums_row[x + 1] = previous_sums[x + 1] + row_sum;
+	    squares_row[x + 1] = previous_squares[x + 1] + row_square_sum;
+	}
+    }
+}
+
+// This routine shrinks {source_image} into {destination_image} by
+// keeping every {scale}'th pixel in each direction.  Both images must
+// be single channel gray scale and {destination_image} must be at
+// least 1/{scale} of the {source_image} size in each direction.
+
+void CV_Image__decimate(
+  CV_Image source_image, CV_Image destination_image, Integer scale) {
+    Integer width = destination_image->width;
+    Integer height = destination_image->height;
+    uchar *source_data = (uchar *)source_image->imageData;
+    uchar *destination_data = (uchar *)destination_image->imageData;
+    int source_step = source_image->widthStep;
+    int destination_step = destination_image->widthStep;
+    for (Integer y = 0; y < height; y++) {
+	uchar *source_row = source_data + source_step * (y * scale);
+	uchar *destination_row = destination_data + destination_step * y;
+	for (Integer x = 0; x < width; x++) {
+	    destination_row[x] = source_row[x * scale];
+	}
+    }
+}
+
+// This routine converts {source_image} to gray scale into {gray_image}
+// and adaptively thresholds the result into {destination_image} in a
+// single pass over the pixel data.  The {block_size} x {block_size}
+// Gaussian weighting used by CV_Image__adaptive_threshold is
+// approximated by a box filter mean computed from an integral image,
+// which keeps the inner loops simple enough for the compiler to
+// vectorize them.  {source_image} may have either 1 or 3 channels.
+// {integral} is caller supplied scratch for the integral image with
+// room for ({width} + 1) x ({height} + 1) entries; keeping the scratch
+// with the caller lets independent detectors run concurrently.
+
+void CV_Image__fused_gray_threshold(CV_Image source_image,
+  CV_Image gray_image, CV_Image destination_image,
+  Integer block_size, Double offset, Unsigned *integral) {
+    Integer width = gray_image->width;
+    Integer height = gray_image->height;
+    Integer channels = source_image->nChannels;
+    uchar *source_data = (uchar *)source_image->imageData;
+    uchar *gray_data = (uchar *)gray_image->imageData;
+    uchar *destination_data = (uchar *)destination_image->imageData;
+    int source_step = source_image->widthStep;
+    int gray_step = gray_image->widthStep;
+    int destination_step = destination_image->widthStep;
+
+    // The extra row and column of zeros in the integral image keep the
+    // window sums free of edge tests:
+    Integer columns = width + 1;
+    for (Integer x = 0; x < columns; x++) {
+	integral[x] = 0;
+    }
+
+    // Pass 1: convert each row to gray while accumulating the integral:
+    for (Integer y = 0; y < height; y++) {
+	uchar *source_row = source_data + source_step * y;
+	uchar *gray_row = gray_data + gray_step * y;
+	unsigned int *integral_row = integral + columns * (y + 1);
+	unsigned int *previous_row = integral + columns * y;
+	if (channels == 3) {
+	    // The pixel data is in B:G:R order; use the usual integer
+	    // approximation of the luminance weights:
+	    for (Integer x = 0; x < width; x++) {
+		uchar *pixel = source_row + x * 3;
+		gray_row[x] = (uchar)((29 * (unsigned int)pixel[0] +
+		  150 * (unsigned int)pixel[1] +
+		  77 * (unsigned int)pixel[2] + 128) >> 8);
+	    }
+	} else {
+	    for (Integer x = 0; x < width; x++) {
+		gray_row[x] = source_row[x];
+	    }
+	}
+	unsigned int row_sum = 0;
+	integral_row[0] = 0;
+	for (Integer x = 0; x < width; x++) {
+	    row_sum += gray_row[x];
+	    integral_row[x + 1] = previous_row[x + 1] + row_sum;
+	}
+    }
+
+    // Pass 2: threshold each gray pixel against the box filter mean of
+    // the surrounding {block_size} x {block_size} window (clipped at
+    // the image edges):
+    Integer half_block = block_size >> 1;
+    for (Integer y = 0; y < height; y++) {
+	Integer y1 = y - half_block;
+	Integer y2 = y + half_block + 1;
+	if (y1 < 0) {
+	    y1 = 0;
+	}
+	if (y2 > height) {
+	    y2 = height;
+	}
+	unsigned int *top_row = integral + columns * y1;
+	unsigned int *bottom_row = integral + columns * y2;
+	uchar *gray_row = gray_data + gray_step * y;
+	uchar *destination_row = destination_data + destination_step * y;
+	for (Integer x = 0; x < width; x++) {
+	    Integer x1 = x - half_block;
+	    Integer x2 = x + half_block + 1;
+	    if (x1 < 0) {
+		x1 = 0;
+	    }
+	    if (x2 > width) {
+		x2 = width;
+	    }
+	    unsigned int sum = bottom_row[x2] - bottom_row[x1] -
+	      top_row[x2] + top_row[x1];
+	    Double mean = (Double)sum / (Double)((x2 - x1) * (y2 - y1));
+	    destination_row[x] =
+	      ((Double)gray_row[x] > mean - offset) ? (uchar)255 : (uchar)0;
+	}
+    }
+}
+
 void CV_Image__blob_draw(
   CV_Image image, Integer x, Integer y, CV_Scalar color) {
     // Draw a small cross at the indicated point.
@@ -382,6 +704,66 @@ CV_Image CV_Image__create(CV_Size size, Unsigned depth, Unsigned channels) {
     return cvCreateImage(*size, depth, channels);
 }
 
+/// @brief The row start alignment (in bytes) guaranteed by
+/// *CV_Image__create_aligned*().
+#define CV_IMAGE__ROW_ALIGNMENT 64
+
+/// @brief Creates an 8-bit image with 64-byte-aligned rows.
+/// @param size is the image width and height.
+/// @param depth is the pixel depth (must be *CV__depth_8u*.)
+/// @param channels is the number of channels per pixel.
+/// @returns the new *CV_Image* object.
+///
+/// *CV_Image__create_aligned*() works like *CV_Image__create*() except
+/// that the image data is allocated so that every row starts on a
+/// *CV_IMAGE__ROW_ALIGNMENT* byte boundary with the stride padded up to
+/// a multiple of the same alignment.  This guarantees aligned vector
+/// loads for custom kernels that walk the rows directly (see
+/// *CV_Image__row_fetch*()).  Two aligned images with the same geometry
+/// always share the same stride.
+
+CV_Image CV_Image__create_aligned(
+  CV_Size size, Unsigned depth, Unsigned channels) {
+    assert (depth == (Unsigned)IPL_DEPTH_8U);
+    CV_Image image = cvCreateImageHeader(*size, depth, channels);
+
+    // Pad the stride up to the next alignment boundary:
+    Unsigned stride = (Unsigned)size->width * channels;
+    stride = (stride + CV_IMAGE__ROW_ALIGNMENT - 1) &
+      ~(Unsigned)(CV_IMAGE__ROW_ALIGNMENT - 1);
+
+    // {aligned_alloc} requires the total size to be a multiple of the
+    // alignment; the padded stride already guarantees that:
+    Memory data = (Memory)aligned_alloc(
+      CV_IMAGE__ROW_ALIGNMENT, stride * (Unsigned)size->height);
+    assert (data != (Memory)0);
+    cvSetData(image, data, (int)stride);
+    return image;
+}
+
+/// @brief Returns a pointer to the start of row *y* of *image*.
+/// @param image to index into.
+/// @param y is the row to fetch.
+/// @returns the raw row pointer.
+///
+/// *CV_Image__row_fetch*() exposes the raw row start so vectorized
+/// stages can walk pixels directly instead of paying for a bounds
+/// checked *CV_Image__gray_fetch*() per pixel.  Use
+/// *CV_Image__stride_get*() to step between rows.
+
+Memory CV_Image__row_fetch(CV_Image image, Integer y) {
+    assert (0 <= y && y < image->height);
+    return (Memory)(image->imageData + image->widthStep * y);
+}
+
+/// @brief Returns the row stride of *image* in bytes.
+/// @param image to query.
+/// @returns the byte distance between the starts of adjacent rows.
+
+Integer CV_Image__stride_get(CV_Image image) {
+    return image->widthStep;
+}
+
 Integer CV_Image__channels_get(CV_Image image) {
     return image->nChannels;
 }
@@ -540,6 +922,83 @@ void CV_Image__remap(CV_Image source_image, CV_Image destination_image,
       destination_image, map_x, map_y, flags, *fill_value);
 }
 
+/// @brief Compiles {map_x}/{map_y} into a flat source-index LUT.
+/// @param map_x is the 32-bit float X undistortion map.
+/// @param map_y is the 32-bit float Y undistortion map.
+/// @param source_image is an 8-bit gray image with the geometry the LUT
+///        will be applied to.
+/// @returns the new LUT; release it with *Memory__free*().
+///
+/// *CV_Image__remap_lut_create*() precomputes the nearest-neighbor
+/// remap defined by {map_x}/{map_y} into one {Integer} per destination
+/// pixel (scanned row major): the byte offset of the source pixel in
+/// *source_image*'s data, or -1 where the map points outside the image.
+/// Since the undistortion maps are fixed after *CV__undistortion_setup*(),
+/// the per-pixel rounding, bounds checking, and two-array indirection
+/// all happen exactly once here instead of on every frame.
+
+Integer *CV_Image__remap_lut_create(
+  CV_Image map_x, CV_Image map_y, CV_Image source_image) {
+    Integer width = source_image->width;
+    Integer height = source_image->height;
+    assert (map_x->width == width && map_x->height == height);
+    assert (map_y->width == width && map_y->height == height);
+    Integer source_step = source_image->widthStep;
+
+    Integer *lut =
+      (Integer *)Memory__allocate(width * height * sizeof(Integer));
+    for (Integer y = 0; y < height; y++) {
+	float *map_x_row = (float *)(map_x->imageData + map_x->widthStep * y);
+	float *map_y_row = (float *)(map_y->imageData + map_y->widthStep * y);
+	Integer *lut_row = lut + width * y;
+	for (Integer x = 0; x < width; x++) {
+	    Integer source_x = cvRound(map_x_row[x]);
+	    Integer source_y = cvRound(map_y_row[x]);
+	    Integer source_index = -1;
+	    if (0 <= source_x && source_x < width &&
+	      0 <= source_y && source_y < height) {
+		source_index = source_step * source_y + source_x;
+	    }
+	    lut_row[x] = source_index;
+	}
+    }
+    return lut;
+}
+
+/// @brief Remaps {source_image} into {destination_image} through {lut}.
+/// @param source_image is the 8-bit gray image to read.
+/// @param destination_image is the 8-bit gray image to write.
+/// @param lut is the LUT from *CV_Image__remap_lut_create*().
+/// @param fill_value is stored where the LUT points outside the image.
+///
+/// *CV_Image__remap_lut*() performs the precompiled nearest-neighbor
+/// remap in a single gather pass: each destination pixel is read
+/// straight from its LUT source offset.  {source_image} and
+/// {destination_image} must be distinct images with the geometry the
+/// LUT was compiled for.
+
+void CV_Image__remap_lut(CV_Image source_image,
+  CV_Image destination_image, Integer *lut, CV_Scalar fill_value) {
+    Integer width = destination_image->width;
+    Integer height = destination_image->height;
+    assert (source_image != destination_image);
+    assert (source_image->widthStep == destination_image->widthStep);
+    uchar *source_data = (uchar *)source_image->imageData;
+    uchar fill = (uchar)fill_value->val[0];
+
+    for (Integer y = 0; y < height; y++) {
+	uchar *destination_row =
+	  (uchar *)(destination_image->imageData +
+	  destination_image->widthStep * y);
+	Integer *lut_row = lut + width * y;
+	for (Integer x = 0; x < width; x++) {
+	    Integer source_index = lut_row[x];
+	    destination_row[x] =
+	      (source_index >= 0) ? source_data[source_index] : fill;
+	}
+    }
+}
+
 void CV_Image__smooth(CV_Image source_image, CV_Image destination_image,
   Integer smooth_type, Integer parameter1, Integer parameter2,
   Double parameter3, Double parameter4) {
@@ -573,22 +1032,17 @@ CV_Image CV_Image__tga_read(CV_Image image, const char * tga_file_name) {
 	assert (0);
     }
 
-    // Read .tga header from *tga_in_file*:
-    File__byte_read(tga_in_file);			// identsize
-    File__byte_read(tga_in_file);			// colourmaptype
-    Unsigned image_type =
-      File__byte_read(tga_in_file);		       // imagetype (3=>raw b&w)
-    File__little_endian_short_read(tga_in_file);	// colourmapstart
-    File__little_endian_short_read(tga_in_file);	// colourmaplength
-    File__byte_read(tga_in_file);			// colourmapbits
-    File__little_endian_short_read(tga_in_file);	// xstart
-    File__little_endian_short_read(tga_in_file);	// ystart
+    // Read the fixed 18 byte .tga header from *tga_in_file* in one
+    // block read and pick it apart in memory:
+    unsigned char header[18];
+    assert (fread(header, 1, sizeof(header), tga_in_file) ==
+      sizeof(header));
+    Unsigned image_type = header[2];			// imagetype (3=>raw b&w)
     Unsigned width =
-      File__little_endian_short_read(tga_in_file);	// width
+      (Unsigned)header[12] | ((Unsigned)header[13] << 8); // width
     Unsigned height =
-      File__little_endian_short_read(tga_in_file);	// height
-    Unsigned bpp = File__byte_read(tga_in_file);	// bits per pixel
-    File__byte_read(tga_in_file);			// descriptor
+      (Unsigned)header[14] | ((Unsigned)header[15] << 8); // height
+    Unsigned bpp = header[16];				// bits per pixel
 
     // Compare {image_type}, {bpp}, {width} and {height} with {image}.
     if (image != (CV_Image)0 && (Unsigned)image->width == width &&
@@ -634,30 +1088,18 @@ CV_Image CV_Image__tga_read(CV_Image image, const char * tga_file_name) {
 	}
     }
 
-    // Read the .tga data into {image}:
+    // Read the .tga data into {image} one whole row at a time.  A
+    // pixel row is contiguous both in the file and in the image (any
+    // row padding lives between image rows), so each row block-reads
+    // straight into place instead of going through one fgetc() call
+    // per byte:
+    Unsigned row_bytes = width;
+    if (!gray_mode) {
+	row_bytes = width * 3;
+    }
     for (Unsigned row = 0; row < height; row++) {
-	Unsigned j = height - row - 1;
-	for (Unsigned column = 0; column < width; column++) {
-	    Unsigned i = column;
-	    if (gray_mode) {
-		Unsigned gray = fgetc(tga_in_file);
-		CV_Image__store3(image, column, row, 0, gray);
-	    } else {
-	        //Unsigned red = File__byte_read(tga_in_file);
-		//Unsigned green = File__byte_read(tga_in_file);
-		//Unsigned blue = File__byte_read(tga_in_file);
-		Unsigned red = fgetc(tga_in_file);
-		Unsigned green = fgetc(tga_in_file);
-		Unsigned blue = fgetc(tga_in_file);
-		unsigned char *pointer = cvPtr2D(image, row, column, (int *)0);
-		pointer[0] = red;
-		pointer[1] = green;
-		pointer[2] = blue;
-		//CV_Image__store3(image, i, j, 0, red);
-		//CV_Image__store3(image, i, j, 1, green);
-		//CV_Image__store3(image, i, j, 2, blue);
-	    }
-	}
+	unsigned char *pointer = cvPtr2D(image, row, 0, (int *)0);
+	assert (fread(pointer, 1, row_bytes, tga_in_file) == row_bytes);
     }
 
     // Close {tga_in_file}:
@@ -704,38 +1146,33 @@ void CV_Image__tga_write(CV_Image image, const char * file_name) {
 	assert (0);
     }
 
-    // Write .tga header:
-    File__byte_write(tga_out_file, 0);			// identsize
-    File__byte_write(tga_out_file, 0);			// colourmaptype
-    File__byte_write(tga_out_file, image_type);		// type (3=b&w)
-    File__little_endian_short_write(tga_out_file, 0);	// colormapstart
-    File__little_endian_short_write(tga_out_file, 0);	// colourmaplen
-    File__byte_write(tga_out_file, 0);			// colourmapbits
-    File__little_endian_short_write(tga_out_file, 0);	// xstart
-    File__little_endian_short_write(tga_out_file, 0);	// ystart
-    File__little_endian_short_write(tga_out_file, width); // width
-    File__little_endian_short_write(tga_out_file, height); //height
-    File__byte_write(tga_out_file, bpp);		// bits/pixel
-    File__byte_write(tga_out_file, 0);			// descriptor
-
-    // Write out the .tga file data:
+    // Build the fixed 18 byte .tga header in memory and write it in
+    // one block write:
+    unsigned char header[18];
+    for (Unsigned index = 0; index < sizeof(header); index++) {
+	header[index] = 0;
+    }
+    header[2] = (unsigned char)image_type;		// type (3=b&w)
+    header[12] = (unsigned char)(width & 0xff);		// width
+    header[13] = (unsigned char)((width >> 8) & 0xff);
+    header[14] = (unsigned char)(height & 0xff);	// height
+    header[15] = (unsigned char)((height >> 8) & 0xff);
+    header[16] = (unsigned char)bpp;			// bits/pixel
+    assert (fwrite(header, 1, sizeof(header), tga_out_file) ==
+      sizeof(header));
+
+    // Write out the .tga file data one whole (vertically flipped) row
+    // at a time; a pixel row is contiguous in the image, so each row
+    // block-writes straight from it instead of going through one
+    // File__byte_write() call per byte:
+    Unsigned row_bytes = width;
+    if (!gray_mode) {
+	row_bytes = width * 3;
+    }
     for (Unsigned row = 0; row < height; row++) {
 	Unsigned j = height - row - 1;
-	for (Unsigned column = 0; column < width; column++) {
-	    Unsigned i = column;
-	    if (gray_mode) {
-	        Unsigned gray = CV_Image__fetch3(image, i, j, 0);
-		File__byte_write(tga_out_file, gray);
-	    } else {
-		Unsigned index = height - row - 1;
-		Unsigned red = CV_Image__fetch3(image, i, j, 0);
-		Unsigned green = CV_Image__fetch3(image, i, j, 1);
-		Unsigned blue = CV_Image__fetch3(image, i, j, 2);
-		File__byte_write(tga_out_file, red);
-		File__byte_write(tga_out_file, green);
-		File__byte_write(tga_out_file, blue);
-	    }
-	}
+	unsigned char *pointer = cvPtr2D(image, j, 0, (int *)0);
+	assert (fwrite(pointer, 1, row_bytes, tga_out_file) == row_bytes);
     }
 
     // Close the .tga file:
@@ -746,6 +1183,348 @@ Integer CV_Image__width_get(CV_Image image) {
     return (Unsigned)image->width;
 }
 
+// *CV_Image_Dumper* routines:
+
+/// @brief The maximum file name length an image dumper can queue.
+#define CV_IMAGE_DUMPER__FILE_NAME_MAXIMUM 256
+
+/// @brief *CV_Image_Dumper__Struct* is a double buffered background
+/// image writer.  *CV_Image_Dumper__submit*() copies the frame into a
+/// free slot and returns immediately; a dedicated writer thread does
+/// the actual .tga/.pnm encode and disk write, so enabling debug
+/// dumps no longer stalls the detection thread behind the disk.  When
+/// both slots are occupied the oldest unwritten frame is replaced and
+/// counted in *dropped*, so a slow disk sheds frames instead of
+/// applying back pressure.
+struct CV_Image_Dumper__Struct {
+    CV_Image buffers[2];
+    pthread_cond_t condition;
+    Unsigned dropped;
+    char file_names[2][CV_IMAGE_DUMPER__FILE_NAME_MAXIMUM];
+    pthread_mutex_t mutex;
+    Integer pending_index;
+    Logical shutdown;
+    pthread_t thread;
+    Integer writing_index;
+    Unsigned written;
+};
+
+// *CV_Image_Dumper__writer*() is the writer thread entry point.  It
+// takes the pending slot, writes it to disk without holding the
+// mutex, and goes back to sleep:
+
+static void *CV_Image_Dumper__writer(void *memory) {
+    CV_Image_Dumper dumper = (CV_Image_Dumper)memory;
+    assert (pthread_mutex_lock(&dumper->mutex) == 0);
+    while (1) {
+	while (!dumper->shutdown && dumper->pending_index < 0) {
+	    assert (pthread_cond_wait(
+	      &dumper->condition, &dumper->mutex) == 0);
+	}
+	if (dumper->pending_index < 0) {
+	    // Shut down only once everything pending is on disk:
+	    break;
+	}
+
+	// Claim the pending slot and write it with the mutex released,
+	// so the detection thread can keep submitting into the other
+	// slot:
+	Integer index = dumper->pending_index;
+	dumper->pending_index = -1;
+	dumper->writing_index = index;
+	assert (pthread_mutex_unlock(&dumper->mutex) == 0);
+
+	char *file_name = dumper->file_names[index];
+	Unsigned size = (Unsigned)strlen(file_name);
+	if (size >= 4 && strcmp(file_name + size - 4, ".pnm") == 0) {
+	    CV_Image__pnm_write(dumper->buffers[index], file_name);
+	} else {
+	    CV_Image__tga_write(dumper->buffers[index], file_name);
+	}
+
+	assert (pthread_mutex_lock(&dumper->mutex) == 0);
+	dumper->writing_index = -1;
+	dumper->written += 1;
+    }
+    assert (pthread_mutex_unlock(&dumper->mutex) == 0);
+    return (void *)0;
+}
+
+/// @brief Creates and returns a new background image dumper.
+/// @returns the new *CV_Image_Dumper* object.
+
+CV_Image_Dumper CV_Image_Dumper__create(void) {
+    CV_Image_Dumper dumper = Memory__new(CV_Image_Dumper);
+    dumper->buffers[0] = (CV_Image)0;
+    dumper->buffers[1] = (CV_Image)0;
+    dumper->dropped = 0;
+    dumper->pending_index = -1;
+    dumper->shutdown = (Logical)0;
+    dumper->writing_index = -1;
+    dumper->written = 0;
+    assert (pthread_mutex_init(&dumper->mutex, (void *)0) == 0);
+    assert (pthread_cond_init(&dumper->condition, (void *)0) == 0);
+    assert (pthread_create(&dumper->thread,
+      (pthread_attr_t *)0, CV_Image_Dumper__writer, (void *)dumper) == 0);
+    return dumper;
+}
+
+/// @brief Returns how many submitted frames were dropped so far.
+/// @param dumper to query.
+/// @returns the dropped frame count.
+
+Unsigned CV_Image_Dumper__dropped_get(CV_Image_Dumper dumper) {
+    assert (pthread_mutex_lock(&dumper->mutex) == 0);
+    Unsigned dropped = dumper->dropped;
+    assert (pthread_mutex_unlock(&dumper->mutex) == 0);
+    return dropped;
+}
+
+/// @brief Queues a copy of *image* to be written to *file_name*.
+/// @param dumper to queue on.
+/// @param image to write out.
+/// @param file_name to write to (.pnm selects PNM, anything else TGA.)
+/// @returns true if queued, false if it replaced an unwritten frame.
+///
+/// *CV_Image_Dumper__submit*() copies *image* into a free slot and
+/// wakes the writer thread; the caller's *image* can be reused as
+/// soon as this returns.  If the writer is still busy with both
+/// slots' worth of work, the oldest unwritten frame is replaced and
+/// the *dropped* counter bumped.
+
+Logical CV_Image_Dumper__submit(
+  CV_Image_Dumper dumper, CV_Image image, const char * file_name) {
+    assert (strlen(file_name) < CV_IMAGE_DUMPER__FILE_NAME_MAXIMUM);
+    assert (pthread_mutex_lock(&dumper->mutex) == 0);
+
+    // Pick the slot to fill.  An unclaimed pending frame is replaced
+    // (and counted as dropped); otherwise either slot not being
+    // written is free:
+    Logical replaced = (Logical)0;
+    Integer slot = dumper->pending_index;
+    if (slot >= 0) {
+	replaced = (Logical)1;
+	dumper->dropped += 1;
+    } else {
+	slot = 0;
+	if (dumper->writing_index == 0) {
+	    slot = 1;
+	}
+    }
+
+    // Make sure the slot's buffer matches *image* and copy into it:
+    CV_Image buffer = dumper->buffers[slot];
+    if (buffer != (CV_Image)0 &&
+      (buffer->width != image->width || buffer->height != image->height ||
+      buffer->depth != image->depth ||
+      buffer->nChannels != image->nChannels)) {
+	CV__release_image(buffer);
+	buffer = (CV_Image)0;
+    }
+    if (buffer == (CV_Image)0) {
+	buffer = CV__clone_image(image);
+    } else {
+	CV_Image__copy(image, buffer, (CV_Image)0);
+    }
+    dumper->buffers[slot] = buffer;
+    (void)strcpy(dumper->file_names[slot], file_name);
+    dumper->pending_index = slot;
+
+    assert (pthread_cond_signal(&dumper->condition) == 0);
+    assert (pthread_mutex_unlock(&dumper->mutex) == 0);
+    return !replaced;
+}
+
+/// @brief Drains, stops, and releases *dumper*.
+/// @param dumper to free.
+///
+/// *CV_Image_Dumper__free*() waits for any queued frame to reach the
+/// disk, stops the writer thread, reports the drop accounting to
+/// standard error, and releases all storage.
+
+void CV_Image_Dumper__free(CV_Image_Dumper dumper) {
+    assert (pthread_mutex_lock(&dumper->mutex) == 0);
+    dumper->shutdown = (Logical)1;
+    assert (pthread_cond_signal(&dumper->condition) == 0);
+    assert (pthread_mutex_unlock(&dumper->mutex) == 0);
+    assert (pthread_join(dumper->thread, (void **)0) == 0);
+
+    if (dumper->dropped != 0) {
+	File__format(stderr, "CV_Image_Dumper: %d frames written, "
+	  "%d dropped (disk could not keep up)\n",
+	  dumper->written, dumper->dropped);
+    }
+    for (Unsigned index = 0; index < 2; index++) {
+	if (dumper->buffers[index] != (CV_Image)0) {
+	    CV__release_image(dumper->buffers[index]);
+	}
+    }
+    assert (pthread_mutex_destroy(&dumper->mutex) == 0);
+    assert (pthread_cond_destroy(&dumper->condition) == 0);
+    Memory__free((Memory)dumper);
+}
+
+// *CV_Image_Reader* routines:
+
+/// @brief The number of decoded frames a reader keeps ahead.
+#define CV_IMAGE_READER__DEPTH 4
+
+/// @brief *CV_Image_Reader__Struct* is a background decode-ahead frame
+/// reader.  A dedicated reader thread calls *read_routine* to fetch
+/// and decode frames from the source, keeping a small bounded queue
+/// of them ahead of the consumer, so offline replay is not gated on
+/// disk or codec latency.  *CV_Image_Reader__fetch*() hands the
+/// frames out in order and returns null once the source is exhausted.
+struct CV_Image_Reader__Struct {
+    Logical done;
+    CV_Image frames[CV_IMAGE_READER__DEPTH];
+    Unsigned head;
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    void *object;
+    CV_Image_Reader_Read_Routine read_routine;
+    Logical shutdown;
+    Unsigned size;
+    pthread_t thread;
+};
+
+// *CV_Image_Reader__read*() is the reader thread entry point.  It
+// decodes the next frame with the mutex released and appends it to
+// the queue, blocking while the queue is full:
+
+static void *CV_Image_Reader__read(void *memory) {
+    CV_Image_Reader reader = (CV_Image_Reader)memory;
+    while (1) {
+	// Fetch and decode the next frame without holding the mutex:
+	CV_Image frame = reader->read_routine(reader->object);
+
+	assert (pthread_mutex_lock(&reader->mutex) == 0);
+	if (frame == (CV_Image)0) {
+	    // End of the source; let any blocked consumer know:
+	    reader->done = (Logical)1;
+	    assert (pthread_cond_signal(&reader->not_empty) == 0);
+	    assert (pthread_mutex_unlock(&reader->mutex) == 0);
+	    break;
+	}
+	while (reader->size >= CV_IMAGE_READER__DEPTH && !reader->shutdown) {
+	    assert (pthread_cond_wait(
+	      &reader->not_full, &reader->mutex) == 0);
+	}
+	if (reader->shutdown) {
+	    assert (pthread_mutex_unlock(&reader->mutex) == 0);
+	    CV__release_image(frame);
+	    break;
+	}
+	reader->frames[
+	  (reader->head + reader->size) % CV_IMAGE_READER__DEPTH] = frame;
+	reader->size += 1;
+	assert (pthread_cond_signal(&reader->not_empty) == 0);
+	assert (pthread_mutex_unlock(&reader->mutex) == 0);
+    }
+    return (void *)0;
+}
+
+/// @brief Creates and returns a new decode-ahead frame reader.
+/// @param object is passed through to *read_routine*.
+/// @param read_routine decodes and returns the source's next frame.
+/// @returns the new *CV_Image_Reader* object.
+///
+/// *CV_Image_Reader__create*() starts a reader thread that repeatedly
+/// calls *read_routine*(*object*) to prefetch frames.  *read_routine*
+/// must return a frame the caller of *CV_Image_Reader__fetch*() is
+/// allowed to keep (and eventually release), or null when the source
+/// is exhausted.
+
+CV_Image_Reader CV_Image_Reader__create(
+  void *object, CV_Image_Reader_Read_Routine read_routine) {
+    CV_Image_Reader reader = Memory__new(CV_Image_Reader);
+    reader->done = (Logical)0;
+    reader->head = 0;
+    reader->object = object;
+    reader->read_routine = read_routine;
+    reader->shutdown = (Logical)0;
+    reader->size = 0;
+    assert (pthread_mutex_init(&reader->mutex, (void *)0) == 0);
+    assert (pthread_cond_init(&reader->not_empty, (void *)0) == 0);
+    assert (pthread_cond_init(&reader->not_full, (void *)0) == 0);
+    assert (pthread_create(&reader->thread,
+      (pthread_attr_t *)0, CV_Image_Reader__read, (void *)reader) == 0);
+    return reader;
+}
+
+/// @brief Returns the next frame from *reader*, or null at the end.
+/// @param reader to fetch the next frame from.
+/// @returns the next decoded frame, or null when the source is done.
+///
+/// *CV_Image_Reader__fetch*() removes and returns the oldest
+/// prefetched frame, blocking only when the reader thread has not
+/// decoded one yet.  The caller owns the returned frame and should
+/// release it with *CV__release_image*().
+
+CV_Image CV_Image_Reader__fetch(CV_Image_Reader reader) {
+    assert (pthread_mutex_lock(&reader->mutex) == 0);
+    while (reader->size == 0 && !reader->done) {
+	assert (pthread_cond_wait(&reader->not_empty, &reader->mutex) == 0);
+    }
+    CV_Image frame = (CV_Image)0;
+    if (reader->size != 0) {
+	frame = reader->frames[reader->head];
+	reader->head = (reader->head + 1) % CV_IMAGE_READER__DEPTH;
+	reader->size -= 1;
+	assert (pthread_cond_signal(&reader->not_full) == 0);
+    }
+    assert (pthread_mutex_unlock(&reader->mutex) == 0);
+    return frame;
+}
+
+/// @brief Return the oldest prefetched frame, or null immediately.
+/// @param reader to fetch from.
+/// @returns the oldest prefetched frame, or null when none is queued.
+///
+/// *CV_Image_Reader__try_fetch*() is the non-blocking variant of
+/// *CV_Image_Reader__fetch*(): when no frame is decoded yet (or the
+/// source is exhausted) it returns null immediately instead of
+/// waiting.  The frame skip governor uses it to drain stale queued
+/// frames without ever blocking on the reader thread.
+
+CV_Image CV_Image_Reader__try_fetch(CV_Image_Reader reader) {
+    assert (pthread_mutex_lock(&reader->mutex) == 0);
+    CV_Image frame = (CV_Image)0;
+    if (reader->size != 0) {
+	frame = reader->frames[reader->head];
+	reader->head = (reader->head + 1) % CV_IMAGE_READER__DEPTH;
+	reader->size -= 1;
+	assert (pthread_cond_signal(&reader->not_full) == 0);
+    }
+    assert (pthread_mutex_unlock(&reader->mutex) == 0);
+    return frame;
+}
+
+/// @brief Stops and releases *reader*.
+/// @param reader to free.
+///
+/// *CV_Image_Reader__free*() stops the reader thread and releases any
+/// prefetched frames that were never fetched.
+
+void CV_Image_Reader__free(CV_Image_Reader reader) {
+    assert (pthread_mutex_lock(&reader->mutex) == 0);
+    reader->shutdown = (Logical)1;
+    assert (pthread_cond_signal(&reader->not_full) == 0);
+    assert (pthread_mutex_unlock(&reader->mutex) == 0);
+    assert (pthread_join(reader->thread, (void **)0) == 0);
+
+    while (reader->size != 0) {
+	CV__release_image(reader->frames[reader->head]);
+	reader->head = (reader->head + 1) % CV_IMAGE_READER__DEPTH;
+	reader->size -= 1;
+    }
+    assert (pthread_mutex_destroy(&reader->mutex) == 0);
+    assert (pthread_cond_destroy(&reader->not_empty) == 0);
+    assert (pthread_cond_destroy(&reader->not_full) == 0);
+    Memory__free((Memory)reader);
+}
+
 // *CV_Matrix* routines:
 
 Integer CV_Matrix__columns_get(CV_Matrix matrix) {
@@ -894,7 +1673,19 @@ CV_Sequence CV_Sequence__approximate_polygon(CV_Sequence contour,
 Double CV_Sequence__arc_length(
   CV_Sequence contour, CV_Slice slice, Integer is_closed) {
     return cvArcLength(contour, *slice, is_closed);
-}    
+}
+
+// This routine stores the up-right bounding rectangle of {contour}
+// into {x}, {y}, {width} and {height}.
+
+void CV_Sequence__bounding_rectangle(CV_Sequence contour,
+  Integer *x, Integer *y, Integer *width, Integer *height) {
+    CvRect rectangle = cvBoundingRect(contour, 0);
+    *x = rectangle.x;
+    *y = rectangle.y;
+    *width = rectangle.width;
+    *height = rectangle.height;
+}
 
 Logical CV_Sequence__check_contour_convexity(CV_Sequence contour) {
     return (Logical)(cvCheckContourConvexity(contour) ? 1 : 0);
@@ -0,0 +1,141 @@
+// Copyright (c) 2013 by Wayne C. Gramlich.  All rights reserved.
+
+#include <assert.h>
+
+#include "Codeword.h"
+#include "CRC.h"
+#include "FEC.h"
+#include "Logical.h"
+#include "Memory.h"
+#include "Unsigned.h"
+
+// *Codeword__hash*() returns an FNV-1a hash of the *CODEWORD__SIZE*
+// low bytes of {codeword}:
+
+static Unsigned Codeword__hash(Unsigned *codeword) {
+    Unsigned hash = 0x811c9dc5;
+    for (Unsigned index = 0; index < CODEWORD__SIZE; index++) {
+	hash ^= codeword[index] & 0xff;
+	hash *= 0x01000193;
+    }
+    return hash;
+}
+
+/// @brief Create a codeword table covering tag ids 0 through
+/// *ids_size* - 1.
+/// @param ids_size is the number of tag ids to precompute.
+/// @returns the new *Codeword_Table* object.
+///
+/// *Codeword_Table__create*() encodes the complete codeword (tag id,
+/// CCITT CRC, and Reed-Solomon parity) for each covered tag id once up
+/// front and inserts each one into the reverse hash.  The hash is
+/// sized to at least twice *ids_size* so probe chains stay short.
+
+Codeword_Table Codeword_Table__create(Unsigned ids_size) {
+    assert (ids_size >= 1);
+
+    Codeword_Table codeword_table = Memory__new(Codeword_Table);
+    codeword_table->bytes = (Unsigned *)Memory__allocate(
+      ids_size * CODEWORD__SIZE * sizeof(Unsigned));
+    codeword_table->ids_size = ids_size;
+
+    // Size the hash to the smallest power of 2 that is at least
+    // 2 x {ids_size}:
+    Unsigned hash_size = 1;
+    while (hash_size < 2 * ids_size) {
+	hash_size <<= 1;
+    }
+    codeword_table->hash_mask = hash_size - 1;
+    codeword_table->hash_buckets =
+      (Unsigned *)Memory__allocate(hash_size * sizeof(Unsigned));
+    for (Unsigned index = 0; index < hash_size; index++) {
+	codeword_table->hash_buckets[index] = 0;
+    }
+
+    // Encode each codeword and insert it into the hash:
+    FEC fec = FEC__create(8, 4, 4);
+    for (Unsigned id = 0; id < ids_size; id++) {
+	Unsigned *codeword =
+	  codeword_table->bytes + id * CODEWORD__SIZE;
+	for (Unsigned index = 0; index < CODEWORD__SIZE; index++) {
+	    codeword[index] = 0;
+	}
+	codeword[0] = id & 0xff;
+	codeword[1] = (id >> 8) & 0xff;
+	Unsigned crc = CRC__compute(codeword, 2);
+	codeword[2] = crc & 0xff;
+	codeword[3] = (crc >> 8) & 0xff;
+	FEC__parity(fec, codeword, CODEWORD__SIZE);
+
+	// Linear probe to the first empty bucket:
+	Unsigned bucket_index =
+	  Codeword__hash(codeword) & codeword_table->hash_mask;
+	while (codeword_table->hash_buckets[bucket_index] != 0) {
+	    bucket_index = (bucket_index + 1) & codeword_table->hash_mask;
+	}
+	codeword_table->hash_buckets[bucket_index] = id + 1;
+    }
+
+    return codeword_table;
+}
+
+/// @brief Return the precomputed codeword for *id*.
+/// @param codeword_table is the codeword table to index.
+/// @param id is the tag id to fetch the codeword for.
+/// @returns a pointer to the *CODEWORD__SIZE* codeword bytes.
+///
+/// *Codeword_Table__fetch*() returns the complete codeword for *id*.
+/// The returned storage belongs to *codeword_table* and must not be
+/// modified.
+
+Unsigned *Codeword_Table__fetch(
+  Codeword_Table codeword_table, Unsigned id) {
+    assert (id < codeword_table->ids_size);
+    return codeword_table->bytes + id * CODEWORD__SIZE;
+}
+
+/// @brief Release the storage associated with *codeword_table*.
+/// @param codeword_table is the codeword table to free.
+
+void Codeword_Table__free(Codeword_Table codeword_table) {
+    Memory__free((Memory)codeword_table->bytes);
+    Memory__free((Memory)codeword_table->hash_buckets);
+    Memory__free((Memory)codeword_table);
+}
+
+/// @brief Look up a raw sampled codeword.
+/// @param codeword_table is the codeword table to probe.
+/// @param codeword is the *CODEWORD__SIZE* raw sampled bytes.
+/// @param tag_id is where the matched tag id is stored.
+/// @returns true if *codeword* exactly matches a covered codeword.
+///
+/// *Codeword_Table__lookup*() probes the reverse hash with the raw
+/// bytes of *codeword*.  On an exact match (i.e. a pristine read) the
+/// decoded tag id is stored into *tag_id* and true is returned; the
+/// caller can skip error correction and CRC verification entirely.
+/// Otherwise false is returned and the caller falls back to the usual
+/// FEC/CRC decode path.
+
+Logical Codeword_Table__lookup(
+  Codeword_Table codeword_table, Unsigned *codeword, Unsigned *tag_id) {
+    Unsigned bucket_index =
+      Codeword__hash(codeword) & codeword_table->hash_mask;
+    Unsigned id_plus_one;
+    while ((id_plus_one =
+      codeword_table->hash_buckets[bucket_index]) != 0) {
+	Unsigned *table_codeword = codeword_table->bytes +
+	  (id_plus_one - 1) * CODEWORD__SIZE;
+	Unsigned index;
+	for (index = 0; index < CODEWORD__SIZE; index++) {
+	    if (((codeword[index] ^ table_codeword[index]) & 0xff) != 0) {
+		break;
+	    }
+	}
+	if (index >= CODEWORD__SIZE) {
+	    *tag_id = id_plus_one - 1;
+	    return (Logical)1;
+	}
+	bucket_index = (bucket_index + 1) & codeword_table->hash_mask;
+    }
+    return (Logical)0;
+}
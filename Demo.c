@@ -17,8 +17,33 @@
 #include "String.h"
 #include "Unsigned.h"
 
+typedef struct Demo_Frame_Source__Struct *Demo_Frame_Source;
+
+// {Demo_Frame_Source__Struct} tracks the reader thread's position in
+// the image file name sequence:
+struct Demo_Frame_Source__Struct {
+    List /* <String> */ image_file_names;
+    Unsigned index;
+};
+
+// This routine reads and decodes the next image file for the
+// decode-ahead reader; it returns null after the last file:
+
+static CV_Image Demo__frame_read(void *object) {
+    Demo_Frame_Source source = (Demo_Frame_Source)object;
+    CV_Image image = (CV_Image)0;
+    if (source->index < List__size(source->image_file_names)) {
+	String image_file_name =
+	  (String)List__fetch(source->image_file_names, source->index);
+	source->index += 1;
+	image = CV_Image__pnm_read(image_file_name);
+	assert (image != (CV_Image)0);
+    }
+    return image;
+}
+
 int main(int arguments_size, char * arguments[]) {
-    struct timeval start_time_value_struct;    
+    struct timeval start_time_value_struct;
     struct timeval end_time_value_struct;    
     struct timeval difference_time_value_struct;    
     Time_Value start_time_value = &start_time_value_struct;
@@ -57,13 +82,33 @@ int main(int arguments_size, char * arguments[]) {
 	  Fiducials__location_announce, Map__tag_announce);
 	Fiducials__tag_heights_xml_read(fiducials, "Tag_Heights.xml");
 
-	for (Unsigned index = 0; index < size; index++) {
-	    String image_file_name = 
-	      (String)List__fetch(image_file_names, index);
-	    image = CV_Image__pnm_read(image_file_name);
+	// A decode-ahead reader thread keeps a few decoded frames queued
+	// in front of the detector, so detection is never gated on the
+	// disk read and .pnm decode of the next frame:
+	struct Demo_Frame_Source__Struct frame_source_struct;
+	Demo_Frame_Source frame_source = &frame_source_struct;
+	frame_source->image_file_names = image_file_names;
+	frame_source->index = 0;
+	CV_Image_Reader image_reader =
+	  CV_Image_Reader__create((void *)frame_source, Demo__frame_read);
+
+	CV_Image previous_image = (CV_Image)0;
+	while (1) {
+	    image = CV_Image_Reader__fetch(image_reader);
+	    if (image == (CV_Image)0) {
+		break;
+	    }
 	    Fiducials__image_set(fiducials, image);
 	    Fiducials__process(fiducials);
+
+	    // The previous frame is no longer referenced by *fiducials*;
+	    // the final frame is kept alive for *Fiducials__image_show*():
+	    if (previous_image != (CV_Image)0) {
+		CV__release_image(previous_image);
+	    }
+	    previous_image = image;
 	}
+	CV_Image_Reader__free(image_reader);
 
 	assert (gettimeofday(end_time_value, (struct timezone *)0) == 0);
 
@@ -39,10 +39,12 @@
     and optimize this code further.
 */
 
+#include <assert.h>
 #include <stdlib.h>
 #include <alloca.h>
 
 #include "FEC.h"
+#include "FEC_Tables.h"
 #include "Logical.h"
 #include "Unsigned.h"
 
@@ -233,6 +235,34 @@ rvFec* rvFec_New(rvInt16 symbolSize, rvInt16 dataSize, rvInt16 paritySize)
     else if (symbolSize == 8) pp = pp_8;
     else return NULL;
 
+    // The standard fiducial parameter set (8, 4, 4) shares the
+    // precomputed read-only tables from FEC_Tables.h instead of
+    // recomputing and heap allocating its own copies, so creation is
+    // cheap and every detector thread reads the same tables.
+    if ((symbolSize == 8) && (dataSize == 4) && (paritySize == 4)) {
+        self = (rvFec *) malloc(sizeof(rvFec));
+        if (self != NULL) {
+            // Set the Reed Solomon properties.
+            self->mm = mm;
+            self->nn = nn;
+            self->kk = kk;
+
+            // Set the buffer properties.
+            self->zeroSize = zeroSize;
+            self->dataSize = dataSize;
+            self->paritySize = paritySize;
+            self->blockSize = blockSize;
+
+            // Nothing writes the tables after initialization (the two
+            // rvFec_Init*() routines are skipped entirely), so casting
+            // away const here is safe.
+            self->gg = (uintGF *) FEC__generator_8_4_4;
+            self->alphaTo = (uintGF *) FEC__alpha_to_8_4_4;
+            self->indexOf = (uintGF *) FEC__index_of_8_4_4;
+        }
+        return self;
+    }
+
     // Allocate a new ecc object and tables.
     self = (rvFec *) malloc(sizeof(rvFec));
     gg = (uintGF*) malloc(sizeof(uintGF) * (paritySize + 1));
@@ -324,8 +354,19 @@ rvInt16 rvFec_Parity(rvFec* self, rvUint8* dataBuffer, rvUint8* parityBuffer)
 }
 
 
-rvInt16 rvFec_Correct(rvFec* self, rvUint8* blockBuffer)
-// Correct the block buffer.  Returns 1 if success or 0 if unable to correct.
+// Scratch elements rvFec_CorrectScratch() needs: the receive buffer
+// (nn symbols) plus seven polynomial buffers of paritySize + 1 symbols
+// each (syndromes, lambda, b, t, reg, root, and omega.)
+#define rvFec_SCRATCH_SIZE(nn, paritySize) ((nn) + 7 * ((paritySize) + 1))
+
+static rvInt16 rvFec_CorrectScratch(rvFec* self, rvUint8* blockBuffer,
+  uintGF* scratch, rvInt16* locScratch)
+// Correct the block buffer.  Returns 1 if success or 0 if unable to
+// correct.  {scratch} must hold rvFec_SCRATCH_SIZE(nn, paritySize)
+// elements and {locScratch} must hold paritySize elements; neither is
+// read on entry, so both can be reused across calls.  When every
+// syndrome is zero (the common case) only the receive buffer and
+// syndromes portions of {scratch} are ever touched.
 {
     rvInt16 i;
     rvInt16 j;
@@ -348,12 +389,11 @@ rvInt16 rvFec_Correct(rvFec* self, rvUint8* blockBuffer)
 
     // Local references so code is easier on the eyes.
     rvInt16 nn = self->nn;
-    uintGF *gg = self->gg;
     uintGF *alphaTo = self->alphaTo;
     uintGF *indexOf = self->indexOf;
 
-    // Allocate the recieve buffer off the stack.
-    recd = (uintGF*) alloca(sizeof(uintGF) * nn);
+    // Carve the recieve buffer out of the scratch arena.
+    recd = scratch;
 
     // Copy and convert the encoded buffer from polynomial form to index form.
     for (i = nn - 1; i >= 0; --i) {
@@ -362,8 +402,8 @@ rvInt16 rvFec_Correct(rvFec* self, rvUint8* blockBuffer)
 	  indexOf[(i >= self->zeroSize) ? blockBuffer[i - self->zeroSize] : 0];
     }
 
-    // Allocate the syndromes buffer off the stack.
-    syndromes = (uintGF*) alloca(sizeof(uintGF) * (self->paritySize + 1));
+    // Carve the syndromes buffer out of the scratch arena.
+    syndromes = scratch + nn;
 
     // Initialize the syndrome error flag.
     syn_error = 0;
@@ -393,16 +433,16 @@ rvInt16 rvFec_Correct(rvFec* self, rvUint8* blockBuffer)
         return 1;
     }
 
-    // Allocate the lambda buffer off the stack.
-    lambda = (uintGF*) alloca(sizeof(uintGF) * (self->paritySize + 1));
+    // Carve the lambda buffer out of the scratch arena.
+    lambda = scratch + nn + (self->paritySize + 1);
 
     // Clear the lampda buffer.
     for (i = 1; i < self->paritySize + 1; ++i) lambda[i] = 0;
 
     lambda[0] = 1;
 
-    b = (uintGF*) alloca(sizeof(uintGF) * (self->paritySize + 1));
-    t = (uintGF*) alloca(sizeof(uintGF) * (self->paritySize + 1));
+    b = scratch + nn + 2 * (self->paritySize + 1);
+    t = scratch + nn + 3 * (self->paritySize + 1);
 
     for (i = 0; i < self->paritySize + 1; i++) {
 	b[i] = indexOf[lambda[i]];
@@ -479,9 +519,9 @@ rvInt16 rvFec_Correct(rvFec* self, rvUint8* blockBuffer)
 	}
     }
 
-    loc = (rvInt16*) alloca(sizeof(rvInt16) * self->paritySize);
-    reg = (uintGF*) alloca(sizeof(uintGF) * (self->paritySize + 1));
-    root = (uintGF*) alloca(sizeof(uintGF) * self->paritySize);
+    loc = locScratch;
+    reg = scratch + nn + 4 * (self->paritySize + 1);
+    root = scratch + nn + 5 * (self->paritySize + 1);
 
     // Find roots of the error locator polynomial by Chien search.
     for (i = 1; i < self->paritySize + 1; ++i) {
@@ -525,7 +565,7 @@ rvInt16 rvFec_Correct(rvFec* self, rvUint8* blockBuffer)
 
     deg_omega = 0;
 
-    omega = (uintGF*) alloca(sizeof(uintGF) * (self->paritySize + 1));
+    omega = scratch + nn + 6 * (self->paritySize + 1);
 
     // Compute error evaluator poly omega(x) =
     // s(x) * lambda(x) (modulo x**(NN-KK))
@@ -602,6 +642,17 @@ rvInt16 rvFec_Correct(rvFec* self, rvUint8* blockBuffer)
     return 1;
 }
 
+rvInt16 rvFec_Correct(rvFec* self, rvUint8* blockBuffer)
+// Correct the block buffer.  Returns 1 if success or 0 if unable to correct.
+{
+    uintGF *scratch = (uintGF*) alloca(sizeof(uintGF) *
+      rvFec_SCRATCH_SIZE(self->nn, self->paritySize));
+    rvInt16 *locScratch = (rvInt16*) alloca(sizeof(rvInt16) *
+      self->paritySize);
+
+    return rvFec_CorrectScratch(self, blockBuffer, scratch, locScratch);
+}
+
 Logical
 FEC__correct(
     FEC fec,
@@ -628,6 +679,60 @@ FEC__correct(
     return result;
 }
 
+Unsigned
+FEC__correct_batch(
+    FEC fec,
+    Unsigned *codewords,
+    Unsigned codewords_size,
+    Unsigned codeword_size)
+{
+    unsigned char data_bytes[8];
+    Unsigned bitmap;
+    Unsigned codeword_index;
+    Unsigned index;
+    uintGF *scratch;
+    rvInt16 *loc_scratch;
+
+    /* {codewords} is a flat array of {codewords_size} codewords of
+       {codeword_size} symbols each -- typically every candidate
+       codeword harvested from one frame.  Each correctable codeword
+       is corrected in place and its bit is set in the returned
+       bitmap, so {codewords_size} is limited to the bitmap width.
+       The scratch arena is carved once here and reused for every
+       codeword, and codewords whose syndromes are all zero (the
+       overwhelmingly common case) never touch the error location
+       machinery at all.  The arena lives on this call's stack, so
+       concurrent batch calls on the same {fec} are safe: */
+    assert(codewords_size <= 32);
+    assert(codeword_size <= 8);
+    scratch = (uintGF*) alloca(sizeof(uintGF) *
+      rvFec_SCRATCH_SIZE(fec->nn, fec->paritySize));
+    loc_scratch = (rvInt16*) alloca(sizeof(rvInt16) * fec->paritySize);
+
+    bitmap = 0;
+    for (codeword_index = 0;
+      codeword_index < codewords_size; codeword_index++) {
+	Unsigned *codeword = codewords + codeword_index * codeword_size;
+
+	/* Load {codeword} into {data_bytes}: */
+	for (index = 0; index < codeword_size; index++) {
+	    data_bytes[index] = codeword[index] & 0xff;
+	}
+
+	/* Correct any errors: */
+	if (rvFec_CorrectScratch(fec, data_bytes, scratch, loc_scratch)) {
+	    bitmap |= 1 << codeword_index;
+
+	    /* Load {data_bytes} back into {codeword}: */
+	    for (index = 0; index < codeword_size; index++) {
+		codeword[index] = data_bytes[index];
+	    }
+	}
+    }
+
+    return bitmap;
+}
+
 void
 FEC__parity(
   FEC fec,
@@ -1,10 +1,16 @@
 // Copyright (c) 2013 by Wayne C. Gramlich.  All rights reserved.
 
+// Expose clock_gettime()/CLOCK_MONOTONIC under -std=c11:
+#define _POSIX_C_SOURCE 200809L
+
 typedef struct Fiducials__Struct *Fiducials;
 
 #include "assert.h"
+#include "pthread.h"
 #include "sys/time.h"
+#include "time.h"
 
+#include "Bounding_Box.h"
 #include "Camera_Tag.h"
 #include "Character.h"
 #include "CRC.h"
@@ -18,14 +24,71 @@ typedef struct Fiducials__Struct *Fiducials;
 #include "Integer.h"
 #include "List.h"
 #include "Logical.h"
+#include "Logger.h"
 #include "Map.h"
 #include "String.h"
 #include "Tag.h"
 #include "Unsigned.h"
 
+// When FIDUCIALS__RELEASE is defined (see the FIDUCIALS_RELEASE option
+// in CMakeLists.txt), the debug stepping branches, the debug image
+// maintenance, and the per-frame stderr diagnostics in the detection
+// hot path all compile away.  *Fiducials__debug_format*() behaves like
+// *File__format*() in the debug build and vanishes in release:
+
+#if defined(FIDUCIALS__RELEASE)
+#define Fiducials__debug_format(...) do { } while (0)
+#else
+#define Fiducials__debug_format File__format
+#endif
+
+static void Fiducials__references_fill(
+  CV_Point2D32F_Vector corners, CV_Point2D32F_Vector references);
+static Integer *Fiducials__weights_select(Fiducials fiducials);
+
+// The default CPU backend for the remap + threshold stages (defined
+// next to *Fiducials__backend_set*() below):
+static struct Fiducials_Backend__Struct Fiducials__cpu_backend_struct;
+
+static CV_Image Fiducials__debug_image_obtain(Fiducials fiducials);
+
+// This routine returns the monotonic clock as seconds.  It is used by
+// the per stage timing accumulators in {Fiducials_Stats__Struct}:
+
+static Double Fiducials__now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (Double)now.tv_sec + (Double)now.tv_nsec * 1.0e-9;
+}
+
+/// @brief Return the accumulated pipeline statistics.
+/// @param fiducials is the *Fiducials* object to query.
+/// @returns the live statistics structure.
+///
+/// *Fiducials__stats_get*() will return the per stage timing and
+/// counter accumulators of *fiducials*.  The returned pointer refers
+/// to live storage inside *fiducials*; callers that stream the values
+/// out on an interval should copy them and then call
+/// *Fiducials__stats_reset*().
+
+Fiducials_Stats Fiducials__stats_get(Fiducials fiducials) {
+    return &fiducials->stats;
+}
+
+/// @brief Reset the accumulated pipeline statistics.
+/// @param fiducials is the *Fiducials* object to reset.
+///
+/// *Fiducials__stats_reset*() will zero all of the timing accumulators
+/// and counters of *fiducials*.
+
+void Fiducials__stats_reset(Fiducials fiducials) {
+    static struct Fiducials_Stats__Struct zero_stats;
+    fiducials->stats = zero_stats;
+}
+
 void Fiducials__location_announce(void *object, Integer id,
   Double x, Double y, Double z, Double bearing) {
-    File__format(stderr,
+    Logger__format(LOGGER__LEVEL_INFO,
       "Location: id=%d x=%f y=%f bearing=%f\n", id, x, y, bearing);
 }
 
@@ -39,7 +102,7 @@ void Fiducials__image_set(Fiducials fiducials, CV_Image image) {
 
 void Fiducials__image_show(Fiducials fiducials, Logical show) {
     // Grab some values out of *fiduicals*:
-    CV_Image debug_image = fiducials->debug_image;
+    CV_Image debug_image = Fiducials__debug_image_obtain(fiducials);
     CV_Image gray_image = fiducials->gray_image;
     CV_Image original_image = fiducials->original_image;
 
@@ -74,7 +137,7 @@ void Fiducials__image_show(Fiducials fiducials, Logical show) {
           case '\33':
             //# Exit program:
             done = (Logical)1;
-            File__format(stderr, "done\n");
+            Logger__format(LOGGER__LEVEL_INFO, "done\n");
             break;
           case '+':
             //# Increment {debug_index}:
@@ -97,17 +160,18 @@ void Fiducials__image_show(Fiducials fiducials, Logical show) {
           case 'b':
             // Toggle image blur:
             fiducials->blur = !fiducials->blur;
-            File__format(stderr, "blur = %d\n", fiducials->blur);
+            Logger__format(LOGGER__LEVEL_INFO, "blur = %d\n", fiducials->blur);
             break;
           case 'f':
             // Toggle image blur:
             fiducials->y_flip = !fiducials->y_flip;
-            File__format(stderr, "y_flip = %d\n", fiducials->y_flip);
+            Logger__format(LOGGER__LEVEL_INFO,
+              "y_flip = %d\n", fiducials->y_flip);
             break;
           default:
             // Deal with unknown {control_character}:
             if ((Unsigned)control_character <= 127) {
-                File__format(stderr,
+                Logger__format(LOGGER__LEVEL_WARN,
                   "Unknown control character %d\n", control_character);
             }
             break;
@@ -118,7 +182,7 @@ void Fiducials__image_show(Fiducials fiducials, Logical show) {
 
         // Show user *debug_index* if it has changed:
         if (debug_index != previous_debug_index) {
-          File__format(stderr,
+          Logger__format(LOGGER__LEVEL_INFO,
             "****************************debug_index = %d\n", debug_index);
           previous_debug_index = debug_index;
         }
@@ -131,18 +195,26 @@ void Fiducials__image_show(Fiducials fiducials, Logical show) {
     }
 }
 
-Fiducials Fiducials__create(
+// *Fiducials__new*() is the common constructor under both
+// *Fiducials__create*() and *Fiducials__share*().  When {primary} is
+// null a fully independent instance is built; otherwise the new
+// instance shares {primary}'s immutable tables (FEC, codeword table)
+// and its *Map*:
+
+static Fiducials Fiducials__new(
   CV_Image original_image, const char * lens_calibrate_file_name,
   void *announce_object,
   Fiducials_Location_Announce_Routine location_announce_routine,
-  Fiducials_Tag_Announce_Routine tag_announce_routine) {
+  Fiducials_Tag_Announce_Routine tag_announce_routine,
+  Fiducials primary) {
     // Create *image_size*:
     Unsigned width = CV_Image__width_get(original_image);
     Unsigned height = CV_Image__height_get(original_image);
     CV_Size image_size = CV_Size__create(width, height);
     CV_Memory_Storage storage = CV_Memory_Storage__create(0);
 
-    File__format(stderr, "CV width=%d CV height = %d\n", width, height);
+    Logger__format(LOGGER__LEVEL_INFO,
+      "CV width=%d CV height = %d\n", width, height);
 
     Integer term_criteria_type =
       CV__term_criteria_iterations | CV__term_criteria_eps;
@@ -330,21 +402,47 @@ Fiducials Fiducials__create(
     // Create and load *fiducials*:
     Fiducials fiducials = Memory__new(Fiducials);
     fiducials->announce_object = announce_object;
+    fiducials->backend = &Fiducials__cpu_backend_struct;
     fiducials->blue = CV_Scalar__rgb(0.0, 0.0, 1.0);
     fiducials->blur = (Logical)1;
     fiducials->camera_tags = List__new(); // <Camera_Tag>
     fiducials->camera_tags_pool = List__new(); // <Camera_Tag>
+    if (primary != (Fiducials)0) {
+	fiducials->codeword_table = primary->codeword_table;
+    } else {
+	fiducials->codeword_table =
+	  Codeword_Table__create(FIDUCIALS__CODEWORD_IDS_SIZE);
+    }
     fiducials->corners = CV_Point2D32F_Vector__create(4);
     fiducials->cyan = CV_Scalar__rgb(0.0, 1.0, 1.0);
-    fiducials->debug_image = CV_Image__create(image_size, CV__depth_8u, 3);
+    // The debug image is allocated lazily on the first frame that needs
+    // it (see *Fiducials__debug_image_obtain*()), so headless runs never
+    // pay for it.  The other working images get 64-byte-aligned rows so
+    // custom kernels over them can use aligned vector loads:
+    fiducials->debug_image = (CV_Image)0;
     fiducials->debug_index = 0;
-    fiducials->edge_image = CV_Image__create(image_size, CV__depth_8u, 1);
-    fiducials->fec = FEC__create(8, 4, 4);
-    fiducials->gray_image = CV_Image__create(image_size, CV__depth_8u, 1);
+    fiducials->edge_image =
+      CV_Image__create_aligned(image_size, CV__depth_8u, 1);
+    if (primary != (Fiducials)0) {
+	fiducials->fec = primary->fec;
+    } else {
+	fiducials->fec = FEC__create(8, 4, 4);
+    }
+    fiducials->gray_image =
+      CV_Image__create_aligned(image_size, CV__depth_8u, 1);
     fiducials->green = CV_Scalar__rgb(0.0, 255.0, 0.0);
+    fiducials->headless = (Logical)0;
     fiducials->location_announce_routine = location_announce_routine;
+    fiducials->location_latest = (Location)0;
     fiducials->locations = List__new();
-    fiducials->map = Map__new(announce_object, tag_announce_routine);
+    fiducials->locations_head = 0;
+    fiducials->locations_limit = 0;
+    fiducials->locations_pool = List__new();
+    if (primary != (Fiducials)0) {
+	fiducials->map = primary->map;
+    } else {
+	fiducials->map = Map__new(announce_object, tag_announce_routine);
+    }
     fiducials->map_x = map_x;
     fiducials->map_y = map_y;
     fiducials->mappings = &mappings[0];
@@ -353,135 +451,872 @@ Fiducials Fiducials__create(
     fiducials->purple = CV_Scalar__rgb(255.0, 0.0, 255.0);
     fiducials->red = CV_Scalar__rgb(255.0, 0.0, 0.0);
     fiducials->references = CV_Point2D32F_Vector__create(8);
+    fiducials->remap_lut = (Integer *)0;
+    if (map_x != (CV_Image)0) {
+	// Compile the fixed undistortion maps into a flat source-index
+	// LUT once, so the per-frame remap is a single gather pass:
+	fiducials->remap_lut = CV_Image__remap_lut_create(
+	  map_x, map_y, fiducials->gray_image);
+    }
     fiducials->sample_points = CV_Point2D32F_Vector__create(64);
     fiducials->size_5x5 = CV_Size__create(5, 5);
     fiducials->size_m1xm1 = CV_Size__create(-1, -1);
     fiducials->storage = storage;
     fiducials->temporary_gray_image =
-      CV_Image__create(image_size, CV__depth_8u, 1);
+      CV_Image__create_aligned(image_size, CV__depth_8u, 1);
     fiducials->weights_index = 0;
-    fiducials->term_criteria = 
+    fiducials->term_criteria =
       CV_Term_Criteria__create(term_criteria_type, 5, 0.2);
     fiducials->y_flip = (Logical)0;
     fiducials->black = CV_Scalar__rgb(0, 0, 0);
 
+    // Start with room for a handful of candidate quads; the candidates
+    // vector grows on demand:
+    fiducials->candidates_limit = 16;
+    fiducials->candidates_size = 0;
+    fiducials->candidates = (Fiducials_Candidate)Memory__allocate(
+      fiducials->candidates_limit * sizeof(*fiducials->candidates));
+
+    // Default to serial candidate decoding:
+    fiducials->decode_threads = 0;
+    fiducials->decodes = (Fiducials_Decode *)0;
+    Fiducials__decode_threads_set(fiducials, 1);
+
+    // Tracking mode is off by default; when enabled, a full-frame sweep
+    // still happens every *track_interval* frames to acquire new tags:
+    fiducials->contour_count = 0;
+    fiducials->contour_reject_count = 0;
+    Fiducials__stats_reset(fiducials);
+    fiducials->early_reject = (Logical)1;
+    fiducials->frame_arena = Memory__arena_create(16 * 1024);
+    fiducials->fuse = (Logical)1;
+    fiducials->fused_integral = (Unsigned *)0;
+    fiducials->fused_integral_size = 0;
+    fiducials->integral_size = 0;
+    fiducials->integral_squares = (Double *)0;
+    fiducials->integral_sums = (Unsigned *)0;
+    fiducials->integral_valid = (Logical)0;
+    fiducials->pyramid_edge_image = (CV_Image)0;
+    fiducials->pyramid_gray_image = (CV_Image)0;
+    fiducials->pyramid_scale = 1;
+    fiducials->priors_limit = 16;
+    fiducials->priors_size = 0;
+    fiducials->priors = (Fiducials_Prior)Memory__allocate(
+      fiducials->priors_limit * sizeof(*fiducials->priors));
+    fiducials->temporal = (Logical)1;
+    fiducials->threshold_block_size = 45;
+    fiducials->threshold_offset = 5.0;
+    fiducials->tune = (Logical)1;
+    fiducials->tune_streak = 0;
+    fiducials->track_boxes = List__new(); // <Bounding_Box>
+    fiducials->track_boxes_pool = List__new(); // <Bounding_Box>
+    fiducials->track_enable = (Logical)0;
+    fiducials->track_frame = 0;
+    fiducials->track_interval = 15;
+    fiducials->track_origin = CV_Point__create(0, 0);
+
     return fiducials;
 }
 
-Unsigned Fiducials__process(Fiducials fiducials) {
-    // Clear *storage*:
-    CV_Memory_Storage storage = fiducials->storage;
-    CV_Memory_Storage__clear(storage);
+Fiducials Fiducials__create(
+  CV_Image original_image, const char * lens_calibrate_file_name,
+  void *announce_object,
+  Fiducials_Location_Announce_Routine location_announce_routine,
+  Fiducials_Tag_Announce_Routine tag_announce_routine) {
+    return Fiducials__new(original_image, lens_calibrate_file_name,
+      announce_object, location_announce_routine, tag_announce_routine,
+      (Fiducials)0);
+}
+
+/// @brief Creates an additional *Fiducials* that shares *primary*'s map.
+/// @param primary is the existing *Fiducials* to share with.
+/// @param original_image is a frame from the additional camera.
+/// @param lens_calibrate_file_name is the additional camera's
+///        calibration file (or null.)
+/// @param announce_object is passed to *location_announce_routine*.
+/// @param location_announce_routine is the location callback for this
+///        camera (or null to use *primary*'s.)
+/// @returns the new *Fiducials* object.
+///
+/// *Fiducials__share*() creates a detector instance for an additional
+/// camera.  The new instance gets its own working images, undistortion
+/// maps, and scratch state (so each camera can run on its own thread),
+/// but shares *primary*'s immutable FEC and codeword tables and --
+/// most importantly -- its *Map*, including the tag heights loaded
+/// into it.  All map access inside *Fiducials__process*() is
+/// serialized through *Map__lock*(), so concurrent detectors never
+/// race in *Map__arc_update*().
+
+Fiducials Fiducials__share(Fiducials primary,
+  CV_Image original_image, const char * lens_calibrate_file_name,
+  void *announce_object,
+  Fiducials_Location_Announce_Routine location_announce_routine) {
+    if (location_announce_routine ==
+      (Fiducials_Location_Announce_Routine)0) {
+	announce_object = primary->announce_object;
+	location_announce_routine = primary->location_announce_routine;
+    }
+    return Fiducials__new(original_image, lens_calibrate_file_name,
+      announce_object, location_announce_routine,
+      primary->map->tag_announce_routine, primary);
+}
+
+/// @brief Enable or disable ROI tracking mode.
+/// @param fiducials is the *Fiducials* object to update.
+/// @param track_enable is true to enable tracking.
+///
+/// *Fiducials__tracking_set*() will enable or disable tracking mode.
+/// When tracking is enabled, the adaptive threshold and contour trace
+/// stages run only inside inflated regions of interest around the tags
+/// found in the previous frame.  A full-frame sweep still runs every
+/// *track_interval* frames (and whenever no tags are being tracked) so
+/// that new tags entering the view are acquired.
+
+void Fiducials__tracking_set(Fiducials fiducials, Logical track_enable) {
+    fiducials->track_enable = track_enable;
+    fiducials->track_frame = 0;
+}
 
-    // Grab some values from *fiducials*:
+/// @brief Enable or disable adaptive threshold auto-tuning.
+/// @param fiducials is the *Fiducials* object to update.
+/// @param tune is true to enable auto-tuning.
+///
+/// *Fiducials__tune_set*() will enable or disable the feedback control
+/// stage that adjusts the adaptive threshold block size and offset
+/// between frames (the default is enabled.)  Disabling it also resets
+/// both parameters to their stock values (block size 45, offset 5.0.)
+/// The tuner watches the per frame contour count and decode yield:
+/// speckle storms (thousands of contours that decode into nothing)
+/// push the offset up and then the block size up, while textured frames
+/// that stop decoding push them back down.  Adjustments only happen
+/// after the same signal persists for several consecutive frames, so
+/// one odd frame never moves the parameters.
+
+void Fiducials__tune_set(Fiducials fiducials, Logical tune) {
+    fiducials->tune = tune;
+    fiducials->tune_streak = 0;
+    if (!tune) {
+	fiducials->threshold_block_size = 45;
+	fiducials->threshold_offset = 5.0;
+    }
+}
+
+// This routine is the per-frame threshold feedback controller.
+// {frame_contours} is the number of contours the sweep produced and
+// {matched} is the number of candidates that decoded into tags.  The
+// controller nudges one parameter at a time, and only after the same
+// signal has persisted for 3 consecutive frames:
+
+static void Fiducials__threshold_tune(
+  Fiducials fiducials, Unsigned frame_contours, Unsigned matched) {
+    // A "noisy" frame walks far more contours than its decoded tags can
+    // explain -- threshold speckle that the contour sweep then pays
+    // for.  A "starved" frame has plenty of image texture yet decodes
+    // nothing, the signature of tag borders fragmented by an
+    // over-aggressive threshold:
+    Logical noisy = frame_contours > 64 * matched + 512;
+    Logical starved =
+      matched == 0 && frame_contours >= 64 && !noisy;
+
+    Integer streak = fiducials->tune_streak;
+    if (noisy) {
+	streak = (streak > 0) ? (streak + 1) : 1;
+    } else if (starved) {
+	streak = (streak < 0) ? (streak - 1) : -1;
+    } else {
+	// Converged; stay put:
+	streak = 0;
+    }
+
+    if (streak >= 3) {
+	// Suppress speckle: raise the offset first (cheap, reversible),
+	// then widen the window once the offset tops out:
+	if (fiducials->threshold_offset < 12.0) {
+	    fiducials->threshold_offset += 1.0;
+	} else if (fiducials->threshold_block_size < 85) {
+	    fiducials->threshold_block_size += 8;	// Stays odd
+	}
+	Logger__format(LOGGER__LEVEL_DEBUG,
+	  "threshold tune up: block_size=%d offset=%f contours=%d\n",
+	  fiducials->threshold_block_size, fiducials->threshold_offset,
+	  frame_contours);
+	streak = 0;
+    } else if (streak <= -3) {
+	// Recover fragmented borders: back the offset off first, then
+	// narrow the window:
+	if (fiducials->threshold_offset > 2.0) {
+	    fiducials->threshold_offset -= 1.0;
+	} else if (fiducials->threshold_block_size > 29) {
+	    fiducials->threshold_block_size -= 8;	// Stays odd
+	}
+	Logger__format(LOGGER__LEVEL_DEBUG,
+	  "threshold tune down: block_size=%d offset=%f contours=%d\n",
+	  fiducials->threshold_block_size, fiducials->threshold_offset,
+	  frame_contours);
+	streak = 0;
+    }
+    fiducials->tune_streak = streak;
+}
+
+/// @brief Enable or disable the temporal decode fast path.
+/// @param fiducials is the *Fiducials* object to update.
+/// @param temporal is true to enable the fast path.
+///
+/// *Fiducials__temporal_set*() will enable or disable the temporal
+/// decode fast path (the default is enabled.)  When enabled, candidate
+/// quads that overlap a tag decoded in the previous frame seed the
+/// sub-pixel corner refiner with the previous frame's refined corners
+/// and try only the previously matching mapping direction, falling back
+/// to the full 4-direction trial decode when the single trial misses.
+/// On a stationary or slowly moving robot this removes most of the
+/// per-candidate decode cost.
+
+void Fiducials__temporal_set(Fiducials fiducials, Logical temporal) {
+    fiducials->temporal = temporal;
+    fiducials->priors_size = 0;
+}
+
+/// @brief Enable or disable the fused conversion + threshold kernel.
+/// @param fiducials is the *Fiducials* object to update.
+/// @param fuse is true to enable the fused kernel.
+///
+/// *Fiducials__fuse_set*() selects between the fused single-pass
+/// gray scale conversion + adaptive threshold kernel (the default) and
+/// the original two-pass OpenCV code.  The fused kernel approximates
+/// the Gaussian threshold window with a box filter; disable it when an
+/// exact match with the OpenCV behavior is needed.  Frames that use
+/// undistortion, blur, or the debug stepper always take the original
+/// path regardless of this setting.
+
+void Fiducials__fuse_set(Fiducials fiducials, Logical fuse) {
+    fiducials->fuse = fuse;
+}
+
+// The default CPU backend: the LUT remap followed by the OpenCV
+// adaptive threshold, exactly as the inline path runs them:
+
+static void Fiducials__cpu_backend_process(void *object,
+  CV_Image converted_image, CV_Image gray_image, CV_Image edge_image,
+  Integer *remap_lut, CV_Scalar fill_color,
+  Integer block_size, Double offset) {
+    if (remap_lut != (Integer *)0) {
+	CV_Image__remap_lut(converted_image, gray_image,
+	  remap_lut, fill_color);
+    }
+    CV_Image__adaptive_threshold(gray_image, edge_image, 255.0,
+      CV__adaptive_thresh_gaussian_c, CV__thresh_binary, block_size, offset);
+}
+
+// The statically allocated CPU backend every *Fiducials* object starts
+// with:
+static struct Fiducials_Backend__Struct Fiducials__cpu_backend_struct = {
+    "cpu",
+    (void *)0,
+    Fiducials__cpu_backend_process,
+};
+
+// This routine returns the debug image, allocating it on first use.
+// Headless runs never call it, so they never pay for the allocation:
+
+static CV_Image Fiducials__debug_image_obtain(Fiducials fiducials) {
     CV_Image debug_image = fiducials->debug_image;
-    Unsigned debug_index = fiducials->debug_index;
-    CV_Image edge_image = fiducials->edge_image;
-    CV_Image gray_image = fiducials->gray_image;
-    CV_Image temporary_gray_image = fiducials->temporary_gray_image;
-    CV_Image original_image = fiducials->original_image;
-    List /*<Location>*/ locations = fiducials->locations;
+    if (debug_image == (CV_Image)0) {
+	CV_Image original_image = fiducials->original_image;
+	CV_Size image_size = CV_Size__create(
+	  CV_Image__width_get(original_image),
+	  CV_Image__height_get(original_image));
+	debug_image = CV_Image__create_aligned(image_size, CV__depth_8u, 3);
+	fiducials->debug_image = debug_image;
+    }
+    return debug_image;
+}
 
-    // For *debug_level* 0, we show the original image in color:
-    if (debug_index == 0) {
-        CV_Image__copy(original_image, debug_image, (CV_Image)0);
+/// @brief Enables or disables headless operation.
+/// @param fiducials is the *Fiducials* object to update.
+/// @param headless is true to run without any display support.
+///
+/// *Fiducials__headless_set*() puts *fiducials* into headless mode:
+/// the debug image is never allocated or maintained and the debug
+/// stepper is pinned to 0, so frames pay nothing for display support.
+/// Use a decoupled viewer (see *CV_Viewer* in High_GUI2.h) when a
+/// display is wanted without blocking the detection thread.
+
+void Fiducials__headless_set(Fiducials fiducials, Logical headless) {
+    fiducials->headless = headless;
+    if (headless) {
+	fiducials->debug_index = 0;
     }
+}
 
-    // Convert from color to gray scale:
-    Integer channels = CV_Image__channels_get(original_image);
+/// @brief Selects the backend for the remap + threshold stages.
+/// @param fiducials is the *Fiducials* object to update.
+/// @param backend is the backend to install (null restores the CPU
+///        backend.)
+///
+/// *Fiducials__backend_set*() installs *backend* as the implementation
+/// of the fixed-function remap + adaptive threshold stages.  The
+/// backend only services the common full-sweep path; frames that use
+/// blur, the fused kernel, the pyramid, region-of-interest tracking,
+/// or the debug stepper always run the inline CPU code, since those
+/// need to see the frame between the two stages.
+
+void Fiducials__backend_set(Fiducials fiducials, Fiducials_Backend backend) {
+    if (backend == (Fiducials_Backend)0) {
+	backend = &Fiducials__cpu_backend_struct;
+    }
+    fiducials->backend = backend;
+}
 
-    // Deal with *debug_index* 0:
-    if (debug_index == 0) {
-        if (channels == 3) {
-            // Original image is color, so a simple copy will work:
-            CV_Image__copy(original_image, debug_image, (CV_Image)0);
-        } else if (channels == 1) {
-            // Original image is gray, so we have to convert back to "color":
-            CV_Image__convert_color(original_image,
-              debug_image, CV__gray_to_rgb);
-        }
+/// @brief Returns the most recently computed camera *Location*.
+/// @param fiducials is the *Fiducials* object to query.
+/// @returns the latest *Location*, or null if no frame with visible
+///          tags has been processed yet.
+///
+/// *Fiducials__location_latest*() is an O(1) accessor for the newest
+/// entry of the location history; it works the same whether the
+/// history is unbounded or in ring mode.
+
+Location Fiducials__location_latest(Fiducials fiducials) {
+    return fiducials->location_latest;
+}
+
+/// @brief Bound the location history to the last *locations_limit* entries.
+/// @param fiducials is the *Fiducials* object to update.
+/// @param locations_limit is the maximum history size (0 for unbounded.)
+///
+/// *Fiducials__locations_limit_set*() switches the location history
+/// into ring buffer mode: once *locations* holds *locations_limit*
+/// entries, each new frame overwrites the oldest entry in place instead
+/// of growing the list, so week long runs stop accumulating pose
+/// history.  Any entries beyond the new limit are recycled into
+/// *locations_pool* right away.  In ring mode the *locations* list is
+/// no longer in chronological order; use
+/// *Fiducials__location_latest*() for the newest entry.  A limit of 0
+/// restores the original unbounded behavior.
+
+void Fiducials__locations_limit_set(
+  Fiducials fiducials, Unsigned locations_limit) {
+    fiducials->locations_limit = locations_limit;
+    fiducials->locations_head = 0;
+    if (locations_limit > 0) {
+	List /* <Location> */ locations = fiducials->locations;
+	List /* <Location> */ locations_pool = fiducials->locations_pool;
+	while (List__size(locations) > locations_limit) {
+	    List__append(locations_pool, List__pop(locations));
+	}
+
+	// The trimmed entries may have included the latest location,
+	// so re-point it at a live entry:
+	fiducials->location_latest = (Location)0;
+	Unsigned locations_size = List__size(locations);
+	if (locations_size > 0) {
+	    fiducials->location_latest =
+	      (Location)List__fetch(locations, locations_size - 1);
+	}
     }
+}
 
-    // Convert *original_image* to gray scale:
-    if (channels == 3) {
-        // Original image is color, so we need to convert to gray scale:
-        CV_Image__convert_color(original_image, gray_image, CV__rgb_to_gray);
-    } else if (channels == 1) {
-        // Original image is gray, so a simple copy will work:
-        CV_Image__copy(original_image, gray_image, (CV_Image)0);
-    } else {
-        assert(0);
+/// @brief Enable or disable the contrast early-reject pre-filter.
+/// @param fiducials is the *Fiducials* object to update.
+/// @param early_reject is true to enable the pre-filter.
+///
+/// *Fiducials__early_reject_set*() will enable or disable the cheap
+/// contrast pre-filter (the default is enabled.)  When enabled, each
+/// candidate quad is checked against a per-frame integral image of
+/// the gray scale camera image: a real tag contains both dark border
+/// and white interior pixels, so candidates whose gray level variance
+/// is too low (specular highlights, low contrast ceiling features)
+/// are rejected before the expensive corner refinement and bit
+/// sampling path runs.
+
+void Fiducials__early_reject_set(Fiducials fiducials, Logical early_reject) {
+    fiducials->early_reject = early_reject;
+}
+
+/// @brief Set the pyramid down scale factor for quad discovery.
+/// @param fiducials is the *Fiducials* object to update.
+/// @param pyramid_scale is the down scale factor (1, 2, or 4.)
+///
+/// *Fiducials__pyramid_set*() will configure *fiducials* to discover
+/// candidate quads on an image down scaled by *pyramid_scale* in each
+/// direction.  The adaptive threshold and contour trace run on the
+/// small image; only the corners of the surviving quads are mapped
+/// back to full resolution for sub-pixel refinement and bit sampling.
+/// A *pyramid_scale* of 1 (the default) disables the pyramid stage.
+
+void Fiducials__pyramid_set(Fiducials fiducials, Unsigned pyramid_scale) {
+    assert (pyramid_scale == 1 || pyramid_scale == 2 || pyramid_scale == 4);
+    if (fiducials->pyramid_gray_image != (CV_Image)0) {
+        CV__release_image(fiducials->pyramid_gray_image);
+        CV__release_image(fiducials->pyramid_edge_image);
+        fiducials->pyramid_gray_image = (CV_Image)0;
+        fiducials->pyramid_edge_image = (CV_Image)0;
+    }
+    if (pyramid_scale > 1) {
+        CV_Image gray_image = fiducials->gray_image;
+        CV_Size pyramid_size = CV_Size__create(
+          CV_Image__width_get(gray_image) / (Integer)pyramid_scale,
+          CV_Image__height_get(gray_image) / (Integer)pyramid_scale);
+        fiducials->pyramid_gray_image =
+          CV_Image__create(pyramid_size, CV__depth_8u, 1);
+        fiducials->pyramid_edge_image =
+          CV_Image__create(pyramid_size, CV__depth_8u, 1);
+        Memory__free((Memory)pyramid_size);
     }
+    fiducials->pyramid_scale = pyramid_scale;
+}
 
-    // Show results of gray scale converion for *debug_index* 1:
-    if (debug_index == 1) {
-        CV_Image__convert_color(gray_image, debug_image, CV__gray_to_rgb);
+/// @brief Set the number of candidate decode worker threads.
+/// @param fiducials is the *Fiducials* object to update.
+/// @param decode_threads is the desired number of decode workers.
+///
+/// *Fiducials__decode_threads_set*() will configure *fiducials* to decode
+/// candidate quads using *decode_threads* worker threads.  A value of 1
+/// (the default) decodes candidates serially on the calling thread.
+/// The value is clamped to *FIDUCIALS__DECODE_THREADS_MAXIMUM*.
+
+void Fiducials__decode_threads_set(
+  Fiducials fiducials, Unsigned decode_threads) {
+    if (decode_threads < 1) {
+	decode_threads = 1;
     }
-    
-    // Preform undistort if available:
-    if (fiducials->map_x != (CV_Image)0) {
-        Integer flags = CV_INTER_NN | CV_WARP_FILL_OUTLIERS;
-        CV_Image__copy(gray_image, temporary_gray_image, (CV_Image)0);
-        CV_Image__remap(temporary_gray_image, gray_image,
-          fiducials->map_x, fiducials->map_y, flags, fiducials->black);
+    if (decode_threads > FIDUCIALS__DECODE_THREADS_MAXIMUM) {
+	decode_threads = FIDUCIALS__DECODE_THREADS_MAXIMUM;
     }
 
-    // Show results of undistort:
-    if (debug_index == 2) {
-        CV_Image__convert_color(gray_image, debug_image, CV__gray_to_rgb);
+    // Release any previous per-worker scratch storage:
+    Fiducials_Decode *decodes = fiducials->decodes;
+    if (decodes != (Fiducials_Decode *)0) {
+	for (Unsigned index = 0; index < fiducials->decode_threads; index++) {
+	    Memory__free((Memory)decodes[index]);
+	}
+	Memory__free((Memory)decodes);
     }
 
-    // Perform Gaussian blur if requested:
-    if (fiducials->blur) {
-        CV_Image__smooth(gray_image, gray_image, CV__gaussian, 3, 0, 0.0, 0.0);
+    // Allocate one *Fiducials_Decode* scratch object per worker:
+    decodes = (Fiducials_Decode *)Memory__allocate(
+      decode_threads * sizeof(Fiducials_Decode));
+    for (Unsigned index = 0; index < decode_threads; index++) {
+	Fiducials_Decode decode = Memory__new(Fiducials_Decode);
+	decode->corners = CV_Point2D32F_Vector__create(4);
+	decode->debugging = (Logical)0;
+	decode->fiducials = fiducials;
+	decode->references = CV_Point2D32F_Vector__create(8);
+	decode->sample_points = CV_Point2D32F_Vector__create(64);
+	decode->worker_index = index;
+	decodes[index] = decode;
     }
+    fiducials->decodes = decodes;
+    fiducials->decode_threads = decode_threads;
+}
 
-    // Show results of Gaussian blur for *debug_index* 2:
-    if (debug_index == 3) {
-        CV_Image__convert_color(gray_image, debug_image, CV__gray_to_rgb);
+// This routine maps the 64 sampled {tag_bits} through {mapping} (one
+// of the 4 orientation mappings) and packs the result into the 8 byte
+// codeword {tag_bytes}:
+
+static void Fiducials__codeword_build(
+  Logical *mapping, Logical *tag_bits, Unsigned *tag_bytes) {
+    Logical mapped_bits[64];
+    for (Unsigned i = 0; i < 64; i++) {
+	 mapped_bits[mapping[i]] = tag_bits[i];
     }
 
-    // Perform adpative threshold:
-    CV_Image__adaptive_threshold(gray_image, edge_image, 255.0,
-      CV__adaptive_thresh_gaussian_c, CV__thresh_binary, 45, 5.0);
+    // Fill in tag bytes;
+    for (Unsigned i = 0; i < 8; i++) {
+	Unsigned byte = 0;
+	for (Unsigned j = 0; j < 8; j++) {
+	    if (mapped_bits[(i<<3) + j]) {
+		byte |= 1 << (7 - j);
+	    }
+	}
+	tag_bytes[i] = byte;
+    }
+}
 
-    // Show results of adaptive threshold for *debug_index* 3:
-    if (debug_index == 4) {
-        CV_Image__convert_color(edge_image, debug_image, CV__gray_to_rgb);
+// This routine will decode one harvested {candidate} quad using the
+// per-worker scratch storage in {decode}.  It performs the sub-pixel
+// corner refinement, the periphery contrast check, the 64 bit samples
+// and the 4 direction FEC/CRC trials.  On success {candidate.matched}
+// is set along with {candidate.tag_id} and {candidate.direction}.  The
+// routine only reads shared {fiducials} state ({gray_image}, {mappings},
+// {fec}, etc.), so multiple workers can run it concurrently on disjoint
+// candidates.
+
+static void Fiducials__candidate_decode(
+  Fiducials fiducials, Fiducials_Candidate candidate, Fiducials_Decode decode) {
+    CV_Image debug_image = fiducials->debug_image;
+    CV_Image gray_image = fiducials->gray_image;
+    Unsigned debug_index = 0;
+#if !defined(FIDUCIALS__RELEASE)
+    if (decode->debugging) {
+	debug_index = fiducials->debug_index;
+    }
+#endif
+
+    // Cheap contrast pre-filter using the per-frame integral images:
+    // a real tag contains both dark border and white interior pixels,
+    // so the gray level variance over the candidate's bounding box must
+    // be substantial.  Specular highlights and low contrast ceiling
+    // features are rejected here before the expensive refinement and
+    // sampling path below runs:
+    if (fiducials->integral_valid) {
+	Double minimum_x = candidate->corner_xs[0];
+	Double maximum_x = candidate->corner_xs[0];
+	Double minimum_y = candidate->corner_ys[0];
+	Double maximum_y = candidate->corner_ys[0];
+	for (Unsigned index = 1; index < 4; index++) {
+	    minimum_x = Double__minimum(minimum_x, candidate->corner_xs[index]);
+	    maximum_x = Double__maximum(maximum_x, candidate->corner_xs[index]);
+	    minimum_y = Double__minimum(minimum_y, candidate->corner_ys[index]);
+	    maximum_y = Double__maximum(maximum_y, candidate->corner_ys[index]);
+	}
+	Integer width = CV_Image__width_get(gray_image);
+	Integer height = CV_Image__height_get(gray_image);
+	Integer x1 = (Integer)minimum_x;
+	Integer y1 = (Integer)minimum_y;
+	Integer x2 = (Integer)maximum_x + 1;
+	Integer y2 = (Integer)maximum_y + 1;
+	if (x1 < 0) {
+	    x1 = 0;
+	}
+	if (y1 < 0) {
+	    y1 = 0;
+	}
+	if (x2 > width) {
+	    x2 = width;
+	}
+	if (y2 > height) {
+	    y2 = height;
+	}
+	if (x2 > x1 && y2 > y1) {
+	    Integer columns = width + 1;
+	    Unsigned *sums = fiducials->integral_sums;
+	    Double *squares = fiducials->integral_squares;
+	    Double area = (Double)((x2 - x1) * (y2 - y1));
+	    Double sum = (Double)(sums[y2 * columns + x2] -
+	      sums[y2 * columns + x1] -
+	      sums[y1 * columns + x2] + sums[y1 * columns + x1]);
+	    Double square_sum = squares[y2 * columns + x2] -
+	      squares[y2 * columns + x1] -
+	      squares[y1 * columns + x2] + squares[y1 * columns + x1];
+	    Double mean = sum / area;
+	    Double variance = square_sum / area - mean * mean;
+
+	    // A gray level standard deviation below 20 cannot come from
+	    // a black and white tag:
+	    if (variance < 400.0) {
+		if (debug_index == 9) {
+		    Logger__format(LOGGER__LEVEL_DEBUG,
+		      "Candidate rejected: variance=%f\n", variance);
+		}
+		return;
+	    }
+	}
     }
 
-    // Find the *edge_image* *contours*:
-    CV_Point origin = fiducials->origin;
-    Integer header_size = 128;
-    CV_Sequence contours = CV_Image__find_contours(edge_image, storage,
-      header_size, CV__retr_list, CV__chain_approx_simple, origin);
-    if (contours == (CV_Sequence)0) {
-        File__format(stderr, "no contours found\n");
+    // A candidate that overlaps a tag decoded in the previous frame
+    // seeds the refiner with the prior frame's refined corners, which
+    // are within a pixel or two of the truth on a stationary or slowly
+    // moving robot -- a much better start than the raw contour corners:
+    Fiducials_Prior prior = (Fiducials_Prior)0;
+    if (candidate->prior != 0) {
+	prior = fiducials->priors + (candidate->prior - 1);
     }
 
-    // For *debug_index* 4, show the *edge_image* *contours*:
-    if (debug_index == 5) {
-        //File__format(stderr, "Draw red contours\n");
-        CV_Scalar red = fiducials->red;
-        CV_Image__convert_color(gray_image, debug_image, CV__gray_to_rgb);
-        CV_Image__draw_contours(debug_image,
-          contours, red, red, 2, 2, 8, origin);
+    // Load the corners to refine into {corners}:
+    CV_Point2D32F_Vector corners = decode->corners;
+    for (Unsigned index = 0; index < 4; index++) {
+	CV_Point2D32F corner = CV_Point2D32F_Vector__fetch1(corners, index);
+	if (prior != (Fiducials_Prior)0) {
+	    CV_Point2D32F__x_set(corner, prior->corner_xs[index]);
+	    CV_Point2D32F__y_set(corner, prior->corner_ys[index]);
+	} else {
+	    CV_Point2D32F__x_set(corner, candidate->corner_xs[index]);
+	    CV_Point2D32F__y_set(corner, candidate->corner_ys[index]);
+	}
     }
 
-    // For the remaining debug steps, we use the original *gray_image*:
-    if (debug_index >= 5) {
-        CV_Image__convert_color(gray_image, debug_image, CV__gray_to_rgb);
+    // Now find the sub pixel corners of {corners}:
+    CV_Image__find_corner_sub_pix(gray_image, corners, 4,
+      fiducials->size_5x5, fiducials->size_m1xm1,
+      fiducials->term_criteria);
+
+    // Ensure that the corners are in a counter_clockwise direction.
+    // Prior corners were normalized last frame and the refiner only
+    // nudges them, so their order is already correct:
+    if (prior == (Fiducials_Prior)0) {
+	CV_Point2D32F_Vector__corners_normalize(corners);
     }
 
-    // Iterate over all of the *contours*:
-    List /* <Camera_Tag> */ camera_tags = fiducials->camera_tags;
-    Map map = fiducials->map;
+    // Store the refined corners back for the merge phase:
+    for (Unsigned index = 0; index < 4; index++) {
+	CV_Point2D32F corner = CV_Point2D32F_Vector__fetch1(corners, index);
+	candidate->corner_xs[index] = CV_Point2D32F__x_get(corner);
+	candidate->corner_ys[index] = CV_Point2D32F__y_get(corner);
+    }
+
+    // Compute the 8 reference points for deciding whether the
+    // polygon is "tag like" in its borders:
+    CV_Point2D32F_Vector references = decode->references;
+    Fiducials__references_fill(corners, references);
+
+    // Now sample the periphery of the tag and looking for the
+    // darkest white value (i.e. minimum) and the lightest black
+    // value (i.e. maximum):
+    Integer white_darkest =
+      Fiducials__points_minimum(fiducials, references, 0, 3);
+    Integer black_lightest =
+      Fiducials__points_maximum(fiducials, references, 4, 7);
+
+    // {threshold} should be smack between the two:
+    Integer threshold = (white_darkest + black_lightest) / 2;
+
+    // For debugging, show the 8 points that are sampled around the
+    // the tag periphery to even decide whether to do further testing.
+    // Show "black" as green crosses, and "white" as green crosses:
+    if (debug_index == 9) {
+	CV_Scalar red = fiducials->red;
+	CV_Scalar green = fiducials->green;
+	for (Unsigned index = 0; index < 8; index++) {
+	    CV_Point2D32F reference =
+	      CV_Point2D32F_Vector__fetch1(references, index);
+	    Integer x = CV__round(CV_Point2D32F__x_get(reference));
+	    Integer y = CV__round(CV_Point2D32F__y_get(reference));
+	    Integer value =
+	      Fiducials__point_sample(fiducials, reference);
+	    CV_Scalar color = red;
+	    if (value < threshold) {
+		color = green;
+	    }
+	    CV_Image__cross_draw(debug_image, x, y, color);
+	    Logger__format(LOGGER__LEVEL_DEBUG, "ref[%d:%d]:%d\n", x, y, value);
+	}
+    }
+
+    // If we have enough contrast keep on trying for a tag match:
+    if (black_lightest < white_darkest) {
+	// We have a tag to try:
+
+	// Now it is time to read all the bits of the tag out:
+	CV_Point2D32F_Vector sample_points = decode->sample_points;
+
+	// Now compute the locations to sample for tag bits:
+	Fiducials__sample_points_compute(corners, sample_points);
+
+	// Extract all 64 tag bit values:
+	Logical *tag_bits = &decode->tag_bits[0];
+	if (debug_index == 0) {
+	    // Gather all 64 cell neighborhoods in one pass over the
+	    // gray image; the 4 direction trials below permute this
+	    // single bit pattern rather than resampling:
+	    Integer values[64];
+	    CV_Image__points_sample(gray_image, sample_points, 64,
+	      Fiducials__weights_select(fiducials), values);
+	    for (Unsigned index = 0; index < 64; index++) {
+		tag_bits[index] = (Logical)(values[index] < threshold);
+	    }
+	} else for (Unsigned index = 0; index < 64; index++) {
+	    // Grab the pixel value and convert into a {bit}:
+	    CV_Point2D32F sample_point =
+	      CV_Point2D32F_Vector__fetch1(sample_points, index);
+	    Integer value =
+	      Fiducials__point_sample(fiducials, sample_point);
+	    Logical bit = (value < threshold);
+	    tag_bits[index] = bit;
+
+	    // For debugging:
+	    if (debug_index == 10) {
+		CV_Scalar red = fiducials->red;
+		CV_Scalar green = fiducials->green;
+
+		// Show white bits as {red} and black bits as {green}:
+		CV_Scalar color = red;
+		if (bit) {
+		    color = green;
+		}
+
+		// Now splat a cross of {color} at ({x},{y}):
+		Integer x =
+		  CV__round(CV_Point2D32F__x_get(sample_point));
+		Integer y =
+		  CV__round(CV_Point2D32F__y_get(sample_point));
+		CV_Image__cross_draw(debug_image, x, y, color);
+	    }
+	}
+
+	// Temporal fast path: when this quad matched a prior frame tag,
+	// try only the mapping direction that decoded last frame.  A
+	// pristine codeword table hit (or an FEC + CRC correction) to
+	// the same tag id confirms the track; anything else falls
+	// through to the full 4-direction trial decode below:
+	if (prior != (Fiducials_Prior)0) {
+	    Unsigned prior_bytes[8];
+	    Fiducials__codeword_build(
+	      fiducials->mappings[prior->direction], tag_bits, prior_bytes);
+	    Unsigned prior_tag_id = 0;
+	    Logical prior_matched = Codeword_Table__lookup(
+	      fiducials->codeword_table, prior_bytes, &prior_tag_id);
+	    if (!prior_matched &&
+	      (FEC__correct_batch(fiducials->fec, prior_bytes, 1, 8) & 1)) {
+		Unsigned computed_crc = CRC__compute(prior_bytes, 2);
+		Unsigned tag_crc = (prior_bytes[3] << 8) | prior_bytes[2];
+		if (computed_crc == tag_crc) {
+		    prior_tag_id = (prior_bytes[1] << 8) | prior_bytes[0];
+		    prior_matched = (Logical)1;
+		}
+	    }
+	    if (prior_matched && prior_tag_id == prior->tag_id) {
+		candidate->direction = prior->direction;
+		candidate->matched = (Logical)1;
+		candidate->tag_id = prior_tag_id;
+		return;
+	    }
+	}
+
+	// Now we build the codewords for all 4 different mapping
+	// orientations to see if any one of the 4 mappings match:
+	Logical **mappings = fiducials->mappings;
+	Unsigned mappings_size = 4;
+	Unsigned direction_bytes[4 * 8];
+	for (Unsigned direction_index = 0;
+	  direction_index < mappings_size; direction_index++) {
+	    Unsigned *tag_bytes = &direction_bytes[direction_index * 8];
+	    Fiducials__codeword_build(
+	      mappings[direction_index], tag_bits, tag_bytes);
+	    if (debug_index == 11) {
+		Logger__format(LOGGER__LEVEL_DEBUG,
+		  "dir=%d Tag[0]=0x%x Tag[1]=0x%x\n",
+		  direction_index, tag_bytes[0], tag_bytes[1]);
+	    }
+	}
+
+	// First probe each direction's raw codeword against the
+	// precomputed codeword table.  An exact hit is a pristine
+	// read -- the overwhelmingly common case for well-lit tags --
+	// and decodes with one hash probe, skipping the Reed-Solomon
+	// and CRC machinery entirely:
+	Codeword_Table codeword_table = fiducials->codeword_table;
+	for (Unsigned direction_index = 0;
+	  direction_index < mappings_size; direction_index++) {
+	    Unsigned table_tag_id = 0;
+	    if (Codeword_Table__lookup(codeword_table,
+	      &direction_bytes[direction_index * 8], &table_tag_id)) {
+		if (debug_index == 11) {
+		    Logger__format(LOGGER__LEVEL_DEBUG,
+		      "codeword table hit, Tag=%d\n", table_tag_id);
+		}
+
+		// Record the match; the merge phase turns it into
+		// a *Camera_Tag*:
+		candidate->direction = direction_index;
+		candidate->matched = (Logical)1;
+		candidate->tag_id = table_tag_id;
+		return;
+	    }
+	}
+
+	// Now we need to do some FEC (Forward Error Correction).
+	// All 4 direction codewords go through one batch call that
+	// shares its scratch arena across the directions:
+	FEC fec = fiducials->fec;
+	Unsigned corrected_bitmap =
+	  FEC__correct_batch(fec, direction_bytes, mappings_size, 8);
+	for (Unsigned direction_index = 0;
+	  direction_index < mappings_size; direction_index++) {
+	    Unsigned *tag_bytes = &direction_bytes[direction_index * 8];
+	    if ((corrected_bitmap >> direction_index) & 1) {
+		// We passed FEC:
+		if (debug_index == 11) {
+		    Logger__format(LOGGER__LEVEL_DEBUG, "FEC correct\n");
+		}
+
+		// Now see if the two CRC's match:
+		Unsigned computed_crc = CRC__compute(tag_bytes, 2);
+		Unsigned tag_crc = (tag_bytes[3] << 8) | tag_bytes[2];
+		if (computed_crc == tag_crc) {
+		    // Yippee!!! We have a tag:
+		    // Compute {tag_id} from the the first two bytes
+		    // of {tag_bytes}:
+		    Unsigned tag_id =
+		      (tag_bytes[1] << 8) | tag_bytes[0];
+
+		    if (debug_index == 11) {
+			Logger__format(LOGGER__LEVEL_DEBUG,
+			  "CRC correct, Tag=%d\n", tag_id);
+		    }
+
+		    // Record the match; the merge phase turns it into
+		    // a *Camera_Tag*:
+		    candidate->direction = direction_index;
+		    candidate->matched = (Logical)1;
+		    candidate->tag_id = tag_id;
+		    break;
+		}
+	    }
+	}
+    }
+}
+
+// This routine is the decode worker thread entry point.  Each worker
+// strides through the candidates vector starting at its own
+// {worker_index}, so the workers cover disjoint candidates without
+// needing any locking.
+
+static void *Fiducials__decode_worker(void *memory) {
+    Fiducials_Decode decode = (Fiducials_Decode)memory;
+    Fiducials fiducials = decode->fiducials;
+    Unsigned stride = fiducials->decode_threads;
+    Unsigned candidates_size = fiducials->candidates_size;
+    for (Unsigned index = decode->worker_index;
+      index < candidates_size; index += stride) {
+	Fiducials__candidate_decode(fiducials,
+	  fiducials->candidates + index, decode);
+    }
+    return (void *)0;
+}
+
+// This routine will sweep {contours}, performing the polygon
+// approximation and the 4-sided/area/convexity test on each contour,
+// and harvesting the corners of each survivor into the {fiducials}
+// candidates vector for the later decode phase.  {debug_index} is 0
+// except when single stepping a full-frame sweep with the debugger
+// interface.  {scale} is the pyramid down scale factor of the image
+// the contours were traced on (1 for full resolution); the harvested
+// corners are mapped back to full resolution coordinates.
+
+static void Fiducials__contours_harvest(Fiducials fiducials,
+  CV_Sequence contours, CV_Memory_Storage storage, Unsigned debug_index,
+  Unsigned scale) {
+    CV_Image debug_image = fiducials->debug_image;
+    CV_Point origin = fiducials->origin;
+    Integer header_size = 128;
     Unsigned contours_count = 0;
     for (CV_Sequence contour = contours; contour != (CV_Sequence)0;
       contour = CV_Sequence__next_get(contour)) {
         // Keep a count of total countours:
         contours_count += 1;
         //File__format(stderr, "contours_count=%d\n", contours_count);
+        fiducials->contour_count += 1;
+        fiducials->stats.contours += 1;
+
+        // Cheap bounding rectangle pre-filter: a contour whose bounding
+        // rectangle is too small to enclose the 500 square pixel area
+        // floor, or whose aspect ratio is far from square, cannot
+        // survive the quad test below, so the arc length and polygon
+        // approximation are skipped entirely:
+        Integer rectangle_x = 0;
+        Integer rectangle_y = 0;
+        Integer rectangle_width = 0;
+        Integer rectangle_height = 0;
+        CV_Sequence__bounding_rectangle(contour, &rectangle_x, &rectangle_y,
+          &rectangle_width, &rectangle_height);
+        if ((Double)(rectangle_width * rectangle_height) <=
+          500.0 / (Double)(scale * scale) ||
+          rectangle_width > rectangle_height * 4 ||
+          rectangle_height > rectangle_width * 4) {
+            fiducials->contour_reject_count += 1;
+            continue;
+        }
 
         static CvSlice whole_sequence;
         CV_Slice CV__whole_seq = &whole_sequence;
@@ -504,7 +1339,7 @@ Unsigned Fiducials__process(Fiducials fiducials) {
         // pixels, we can explore to see if we have a tag:
         if (CV_Sequence__total_get(polygon_contour) == 4 &&
           fabs(CV_Sequence__contour_area(polygon_contour,
-          CV__whole_seq, 0)) > 500.0 &&
+          CV__whole_seq, 0)) > 500.0 / (Double)(scale * scale) &&
           CV_Sequence__check_contour_convexity(polygon_contour)) {
             // For debugging, display the polygons in red:
             //File__format(stderr, "Have 4 sides > 500i\n");
@@ -516,29 +1351,6 @@ Unsigned Fiducials__process(Fiducials fiducials) {
                   polygon_contour, red, red, 2, 2, 1, origin);
             }
 
-            // Copy the 4 corners from {poly_contour} to {corners}:
-            CV_Point2D32F_Vector corners = fiducials->corners;
-            for (Unsigned index = 0; index < 4; index++) {
-                CV_Point2D32F corner =
-                  CV_Point2D32F_Vector__fetch1(corners, index);
-                CV_Point point =
-                  CV_Sequence__point_fetch1(polygon_contour, index);
-                CV_Point2D32F__point_set(corner, point);
-
-                if (debug_index == 7) {
-                    //File__format(stderr,
-                    //  "point[%d] x:%f y:%f\n", index, point->x, point->y);
-                }
-            }
-
-            // Now find the sub pixel corners of {corners}:
-            CV_Image__find_corner_sub_pix(gray_image, corners, 4,
-              fiducials->size_5x5, fiducials->size_m1xm1,
-              fiducials->term_criteria);
-
-            // Ensure that the corners are in a counter_clockwise direction:
-            CV_Point2D32F_Vector__corners_normalize(corners);
-
             // For debugging show the 4 corners of the possible tag where
             //corner0=red, corner1=green, corner2=blue, corner3=purple:
             if (debug_index == 8) {
@@ -570,240 +1382,575 @@ Unsigned Fiducials__process(Fiducials fiducials) {
                         assert(0);
                     }
                     CV_Image__cross_draw(debug_image, x, y, color);
-                    File__format(stderr,
+                    Logger__format(LOGGER__LEVEL_DEBUG,
                       "poly_point[%d]=(%d:%d) %s\n", index, x, y, text);
                 }
             }
 
-            // Compute the 8 reference points for deciding whether the
-            // polygon is "tag like" in its borders:
-            CV_Point2D32F_Vector references =
-              Fiducials__references_compute(fiducials, corners);
-
-            // Now sample the periphery of the tag and looking for the
-            // darkest white value (i.e. minimum) and the lightest black
-            // value (i.e. maximum):
-            //Integer white_darkest =
-            //  CV_Image__points_minimum(gray_image, references, 0, 3);
-            //Integer black_lightest =
-            //  CV_Image__points_maximum(gray_image, references, 4, 7);
-            Integer white_darkest =
-              Fiducials__points_minimum(fiducials, references, 0, 3);
-            Integer black_lightest =
-              Fiducials__points_maximum(fiducials, references, 4, 7);
-
-            // {threshold} should be smack between the two:
-            Integer threshold = (white_darkest + black_lightest) / 2;
-            
-            // For debugging, show the 8 points that are sampled around the
-            // the tag periphery to even decide whether to do further testing.
-            // Show "black" as green crosses, and "white" as green crosses:
-            if (debug_index == 9) {
-                CV_Scalar red = fiducials->red;
-                CV_Scalar green = fiducials->green;
-                for (Unsigned index = 0; index < 8; index++) {
-                    CV_Point2D32F reference =
-                      CV_Point2D32F_Vector__fetch1(references, index);
-                    Integer x = CV__round(CV_Point2D32F__x_get(reference));
-                    Integer y = CV__round(CV_Point2D32F__y_get(reference));
-                    //Integer value =
-                    //  CV_Image__point_sample(gray_image, reference);
-                    Integer value =
-                      Fiducials__point_sample(fiducials, reference);
-                    CV_Scalar color = red;
-                    if (value < threshold) {
-                        color = green;
-                    }
-                    CV_Image__cross_draw(debug_image, x, y, color);
-                    File__format(stderr, "ref[%d:%d]:%d\n", x, y, value);
-                }
+            // Harvest the 4 corners of {polygon_contour} into a candidate
+            // quad for the decode phase below:
+            Unsigned candidates_size = fiducials->candidates_size;
+            if (candidates_size >= fiducials->candidates_limit) {
+                fiducials->candidates_limit <<= 1;
+                fiducials->candidates = (Fiducials_Candidate)
+                  Memory__reallocate((Memory)fiducials->candidates,
+                  fiducials->candidates_limit *
+                  sizeof(*fiducials->candidates));
             }
+            Fiducials_Candidate candidate =
+              fiducials->candidates + candidates_size;
+            candidate->matched = (Logical)0;
+            candidate->prior = 0;
+            for (Unsigned index = 0; index < 4; index++) {
+                CV_Point point =
+                  CV_Sequence__point_fetch1(polygon_contour, index);
+                candidate->corner_xs[index] =
+                  (Double)(CV_Point__x_get(point) * (Integer)scale);
+                candidate->corner_ys[index] =
+                  (Double)(CV_Point__y_get(point) * (Integer)scale);
+            }
+            fiducials->candidates_size = candidates_size + 1;
+        }
+    }
+}
 
-            // If we have enough contrast keep on trying for a tag match:
-            if (black_lightest < white_darkest) {
-                // We have a tag to try:
-
-                // Now it is time to read all the bits of the tag out:
-                CV_Point2D32F_Vector sample_points = fiducials->sample_points;
-
-                // Now compute the locations to sample for tag bits:
-                Fiducials__sample_points_compute(corners, sample_points);
-
-                // Extract all 64 tag bit values:
-                Logical *tag_bits = &fiducials->tag_bits[0];
-                for (Unsigned index = 0; index < 64; index++) {
-                    // Grab the pixel value and convert into a {bit}:
-                    CV_Point2D32F sample_point =
-                      CV_Point2D32F_Vector__fetch1(sample_points, index);
-                    //Integer value =
-                    //  CV_Image__point_sample(gray_image, sample_point);
-                    Integer value =
-                      Fiducials__point_sample(fiducials, sample_point);
-                    Logical bit = (value < threshold);
-                    tag_bits[index] = bit;
-
-                    // For debugging:
-                    if (debug_index == 10) {
-                        CV_Scalar red = fiducials->red;
-                        CV_Scalar green = fiducials->green;
-                        CV_Scalar cyan = fiducials->cyan;
-                        CV_Scalar blue = fiducials->blue;
-
-                        // Show white bits as {red} and black bits as {green}:
-                        CV_Scalar color = red;
-                        if (bit) {
-                            color = green;
-                        }
-
-                        // Show where bit 0 and 7 are:
-                        //if (index == 0) {
-                        //    // Bit 0 is {cyan}:
-                        //    color = cyan;
-                        //}
-                        //if (index == 7) {
-                        //    // Bit 7 is {blue}:
-                        //    color = blue;
-                        //}
-
-                        // Now splat a cross of {color} at ({x},{y}):
-                        Integer x =
-                          CV__round(CV_Point2D32F__x_get(sample_point));
-                        Integer y =
-                          CV__round(CV_Point2D32F__y_get(sample_point));
-                        CV_Image__cross_draw(debug_image, x, y, color);
-                    }
-                }
+Unsigned Fiducials__process(Fiducials fiducials) {
+    // Clear *storage* and recycle the previous frame's arena storage:
+    CV_Memory_Storage storage = fiducials->storage;
+    CV_Memory_Storage__clear(storage);
+    Memory__arena_reset(fiducials->frame_arena);
 
-                //tag_bits :@= extractor.tag_bits
-                //bit_field :@= extractor.bit_field
-                //tag_bytes :@= extractor.tag_bytes
-
-                // Now we iterate through the 4 different mapping
-                // orientations to see if any one of the 4 mappings match:
-                Logical **mappings = fiducials->mappings;
-                Unsigned mappings_size = 4;
-                for (Unsigned direction_index = 0;
-                  direction_index < mappings_size; direction_index++) {
-                    // Grab the mapping:
-                    Logical *mapping = mappings[direction_index];
-                    //File__format(stderr,
-                    //  "mappings[%d]:0x%x\n", direction_index, mapping);
-
-
-                    Logical mapped_bits[64];
-                    for (Unsigned i = 0; i < 64; i++) {
-                         mapped_bits[mapping[i]] = tag_bits[i];
-                    }
+    // Grab some values from *fiducials*.  In a release build
+    // *debug_index* is pinned to 0 so that the compiler can drop every
+    // debug stepping branch below; headless mode does the same at run
+    // time and additionally leaves the debug image unallocated:
+    CV_Image debug_image = fiducials->debug_image;
+#if defined(FIDUCIALS__RELEASE)
+    Unsigned debug_index = 0;
+#else
+    Unsigned debug_index = 0;
+    if (!fiducials->headless) {
+        debug_index = fiducials->debug_index;
+        debug_image = Fiducials__debug_image_obtain(fiducials);
+    }
+#endif
+    CV_Image edge_image = fiducials->edge_image;
+    CV_Image gray_image = fiducials->gray_image;
+    CV_Image temporary_gray_image = fiducials->temporary_gray_image;
+    CV_Image original_image = fiducials->original_image;
+    List /*<Location>*/ locations = fiducials->locations;
+    Fiducials_Stats stats = &fiducials->stats;
+    Double stage_mark = 0.0;
 
-                    // Fill in tag bytes;
-                    Unsigned tag_bytes[8];
-                    for (Unsigned i = 0; i < 8; i++) {
-                        Unsigned byte = 0;
-                        for (Unsigned j = 0; j < 8; j++) {
-                            if (mapped_bits[(i<<3) + j]) {
-                                //byte |= 1 << j;
-                                byte |= 1 << (7 - j);
-                            }
-                        }
-                        tag_bytes[i] = byte;
-                    }
-                    if (debug_index == 11) {
-                        File__format(stderr, "dir=%d Tag[0]=0x%x Tag[1]=0x%x\n",
-                          direction_index, tag_bytes[0], tag_bytes[1]);
-                    }
+#if !defined(FIDUCIALS__RELEASE)
+    // For *debug_level* 0, we show the original image in color (in
+    // headless mode there is no debug image to maintain):
+    if (debug_index == 0 && debug_image != (CV_Image)0) {
+        CV_Image__copy(original_image, debug_image, (CV_Image)0);
+    }
+#endif
 
-                    // Now we need to do some FEC (Forward Error Correction):
-                    FEC fec = fiducials->fec;
-                    if (FEC__correct(fec, tag_bytes, 8)) {
-                        // We passed FEC:
-                        if (debug_index == 11) {
-                            File__format(stderr, "FEC correct\n");
-                        }
-
-                        // Now see if the two CRC's match:
-                        Unsigned computed_crc = CRC__compute(tag_bytes, 2);
-                        Unsigned tag_crc = (tag_bytes[3] << 8) | tag_bytes[2];
-                        if (computed_crc == tag_crc) {
-                            // Yippee!!! We have a tag:
-                            // Compute {tag_id} from the the first two bytes
-                            // of {tag_bytes}:
-                            Unsigned tag_id =
-                              (tag_bytes[1] << 8) | tag_bytes[0];
-
-                            if (debug_index == 11) {
-                                File__format(stderr,
-                                  "CRC correct, Tag=%d\n", tag_id);
-                            }
-
-                            // Allocate a *camera_tag*:
-                            List /* <Camera_Tag> */ camera_tags_pool =
-                              fiducials->camera_tags_pool;
-                            Camera_Tag camera_tag = (Camera_Tag)0;
-                            if (List__size(camera_tags_pool) == 0) {
-                                 // *camera_tags_pool* is empty;
-                                // allocate a new one:
-                                camera_tag = Camera_Tag__new();
-                            } else {
-                                camera_tag =
-                                  (Camera_Tag)List__pop(camera_tags_pool);
-                            }
-
-                            // Load up *camera_tag* to get center, twist, etc.:
-                            Tag tag = Map__tag_lookup(map, tag_id);
-                            if (debug_index == 11) {
-                                Camera_Tag__initialize(camera_tag, tag,
-                                  direction_index, corners, debug_image);
-                            } else {
-                                Camera_Tag__initialize(camera_tag, tag,
-                                  direction_index, corners, (CV_Image)0);
-                            }
-
-                            // Record the maximum *camera_diagonal*:
-                            Double camera_diagonal = camera_tag->diagonal;
-                            Double diagonal =
-                               camera_diagonal * tag->distance_per_pixel;
-                            if (diagonal  > tag->diagonal) {
-                                tag->diagonal = diagonal;
-                            }
-
-                            // Append *camera_tag* to *camera_tags*:
-                            List__append(camera_tags, (Memory)camera_tag);
-                            //File__format(stderr,
-                            //  "Found %d\n", camera_tag->tag->id);
-                        }
-                    }
+    // Convert from color to gray scale:
+    Integer channels = CV_Image__channels_get(original_image);
+
+#if !defined(FIDUCIALS__RELEASE)
+    // Deal with *debug_index* 0:
+    if (debug_index == 0 && debug_image != (CV_Image)0) {
+        if (channels == 3) {
+            // Original image is color, so a simple copy will work:
+            CV_Image__copy(original_image, debug_image, (CV_Image)0);
+        } else if (channels == 1) {
+            // Original image is gray, so we have to convert back to "color":
+            CV_Image__convert_color(original_image,
+              debug_image, CV__gray_to_rgb);
+        }
+    }
+#endif
+
+    // Figure out whether this frame can be serviced by a tracked ROI
+    // sweep rather than a full-frame sweep:
+    List /* <Bounding_Box> */ track_boxes = fiducials->track_boxes;
+    Logical roi_sweep = (Logical)0;
+    if (fiducials->track_enable && debug_index == 0 &&
+      List__size(track_boxes) != 0 &&
+      (fiducials->track_frame % fiducials->track_interval) != 0) {
+        roi_sweep = (Logical)1;
+    }
+    fiducials->track_frame += 1;
+
+    // Decide whether the fused conversion + threshold kernel can service
+    // this frame.  The fused kernel only handles the common full-sweep
+    // path with no undistortion and no blur:
+    Logical fuse = fiducials->fuse && !roi_sweep && debug_index == 0 &&
+      !fiducials->blur && fiducials->map_x == (CV_Image)0 &&
+      fiducials->pyramid_scale == 1;
+
+    // Convert *original_image* to gray scale.  When undistortion is
+    // active the conversion writes into *temporary_gray_image*, so the
+    // LUT remap below can produce the undistorted frame straight into
+    // *gray_image* with no extra frame copy:
+    stage_mark = Fiducials__now();
+    CV_Image converted_image = gray_image;
+    if (fiducials->map_x != (CV_Image)0) {
+        converted_image = temporary_gray_image;
+    }
+    if (fuse) {
+        // CV_Image__fused_gray_threshold below does the conversion as
+        // part of its single pass:
+    } else if (channels == 3) {
+        // Original image is color, so we need to convert to gray scale:
+        CV_Image__convert_color(
+          original_image, converted_image, CV__rgb_to_gray);
+    } else if (channels == 1) {
+        // Original image is gray, so a simple copy will work:
+        CV_Image__copy(original_image, converted_image, (CV_Image)0);
+    } else {
+        assert(0);
+    }
+    stats->convert_seconds += Fiducials__now() - stage_mark;
+
+    // Show results of gray scale converion for *debug_index* 1:
+    if (debug_index == 1) {
+        CV_Image__convert_color(converted_image, debug_image, CV__gray_to_rgb);
+    }
+
+    // Decide whether the fixed-function remap + threshold pair can be
+    // handed to the configured backend as one unit.  Only the common
+    // full-sweep path qualifies; everything else needs to see the frame
+    // between the two stages:
+    Fiducials_Backend backend = fiducials->backend;
+    Logical offload = !fuse && !roi_sweep && debug_index == 0 &&
+      !fiducials->blur && fiducials->pyramid_scale == 1;
+
+    // Preform undistort if available.  The precompiled LUT gathers each
+    // destination pixel straight from its nearest-neighbor source byte,
+    // replacing the copy + two-map remap with a single pass.  (When the
+    // stages are offloaded, the backend call below does the remap so an
+    // accelerator can keep the frame resident across both stages):
+    if (fiducials->map_x != (CV_Image)0 && !offload) {
+        stage_mark = Fiducials__now();
+        CV_Image__remap_lut(temporary_gray_image, gray_image,
+          fiducials->remap_lut, fiducials->black);
+        stats->remap_seconds += Fiducials__now() - stage_mark;
+    }
+
+    // Show results of undistort:
+    if (debug_index == 2) {
+        CV_Image__convert_color(gray_image, debug_image, CV__gray_to_rgb);
+    }
+
+    // Perform Gaussian blur if requested:
+    if (fiducials->blur) {
+        CV_Image__smooth(gray_image, gray_image, CV__gaussian, 3, 0, 0.0, 0.0);
+    }
+
+    // Show results of Gaussian blur for *debug_index* 2:
+    if (debug_index == 3) {
+        CV_Image__convert_color(gray_image, debug_image, CV__gray_to_rgb);
+    }
+
+    // Snapshot the contour counter so the feedback controller below
+    // can see this frame's contour count:
+    Unsigned contours_mark = fiducials->stats.contours;
+
+    CV_Point origin = fiducials->origin;
+    Integer header_size = 128;
+    if (roi_sweep) {
+        // Threshold and contour-trace only inside an inflated region of
+        // interest around each tag found in the previous frame:
+        Integer image_width = CV_Image__width_get(gray_image);
+        Integer image_height = CV_Image__height_get(gray_image);
+        CV_Point track_origin = fiducials->track_origin;
+        Unsigned track_boxes_size = List__size(track_boxes);
+        for (Unsigned box_index = 0;
+          box_index < track_boxes_size; box_index++) {
+            Bounding_Box box = (Bounding_Box)List__fetch(track_boxes, box_index);
+
+            // Inflate the box by a quarter of its larger side plus a few
+            // pixels of slack to allow for inter-frame motion:
+            Double margin = 16.0 + 0.25 * Double__maximum(
+              box->maximum_x - box->minimum_x,
+              box->maximum_y - box->minimum_y);
+            Integer x1 = (Integer)(box->minimum_x - margin);
+            Integer y1 = (Integer)(box->minimum_y - margin);
+            Integer x2 = (Integer)(box->maximum_x + margin) + 1;
+            Integer y2 = (Integer)(box->maximum_y + margin) + 1;
+            if (x1 < 0) {
+                x1 = 0;
+            }
+            if (y1 < 0) {
+                y1 = 0;
+            }
+            if (x2 > image_width) {
+                x2 = image_width;
+            }
+            if (y2 > image_height) {
+                y2 = image_height;
+            }
+            Integer roi_width = x2 - x1;
+            Integer roi_height = y2 - y1;
+            if (roi_width < 16 || roi_height < 16) {
+                continue;
+            }
+
+            // Run the threshold and contour trace inside the ROI only.
+            // Passing ({x1},{y1}) as the contour offset puts the contour
+            // coordinates back into full image coordinates:
+            stage_mark = Fiducials__now();
+            CV_Image__roi_set(gray_image, x1, y1, roi_width, roi_height);
+            CV_Image__roi_set(edge_image, x1, y1, roi_width, roi_height);
+            CV_Image__adaptive_threshold(gray_image, edge_image, 255.0,
+              CV__adaptive_thresh_gaussian_c, CV__thresh_binary,
+              fiducials->threshold_block_size, fiducials->threshold_offset);
+            stats->threshold_seconds += Fiducials__now() - stage_mark;
+            stage_mark = Fiducials__now();
+            CV_Point__x_set(track_origin, x1);
+            CV_Point__y_set(track_origin, y1);
+            CV_Sequence contours = CV_Image__find_contours(edge_image,
+              storage, header_size, CV__retr_list, CV__chain_approx_simple,
+              track_origin);
+            CV_Image__roi_reset(gray_image);
+            CV_Image__roi_reset(edge_image);
+            Fiducials__contours_harvest(fiducials, contours, storage, 0, 1);
+            stats->contour_seconds += Fiducials__now() - stage_mark;
+        }
+    } else if (fiducials->pyramid_scale > 1 && debug_index == 0) {
+        // Discover candidate quads on the down scaled pyramid image.
+        // Only the corners of the surviving quads are mapped back to
+        // full resolution; sub-pixel refinement in the decode phase
+        // recovers the precision lost to the down scale:
+        Unsigned pyramid_scale = fiducials->pyramid_scale;
+        CV_Image pyramid_gray_image = fiducials->pyramid_gray_image;
+        CV_Image pyramid_edge_image = fiducials->pyramid_edge_image;
+        stage_mark = Fiducials__now();
+        CV_Image__decimate(gray_image,
+          pyramid_gray_image, (Integer)pyramid_scale);
+
+        // Scale the threshold window down with the image, keeping the
+        // block size odd as the adaptive threshold requires:
+        Integer block_size =
+          fiducials->threshold_block_size / (Integer)pyramid_scale;
+        if ((block_size & 1) == 0) {
+            block_size += 1;
+        }
+        CV_Image__adaptive_threshold(pyramid_gray_image, pyramid_edge_image,
+          255.0, CV__adaptive_thresh_gaussian_c, CV__thresh_binary,
+          block_size, fiducials->threshold_offset);
+        stats->threshold_seconds += Fiducials__now() - stage_mark;
+        stage_mark = Fiducials__now();
+        CV_Sequence contours = CV_Image__find_contours(pyramid_edge_image,
+          storage, header_size, CV__retr_list, CV__chain_approx_simple,
+          origin);
+        Fiducials__contours_harvest(fiducials,
+          contours, storage, 0, pyramid_scale);
+        stats->contour_seconds += Fiducials__now() - stage_mark;
+    } else {
+        // Perform adpative threshold:
+        stage_mark = Fiducials__now();
+        if (fuse) {
+            // Convert to gray and threshold in a single fused pass.  The
+            // integral image scratch lives in the detector so detectors
+            // sharing one map can process frames concurrently:
+            Integer fused_width = CV_Image__width_get(gray_image);
+            Integer fused_height = CV_Image__height_get(gray_image);
+            Unsigned fused_size_needed =
+              (Unsigned)((fused_width + 1) * (fused_height + 1));
+            if (fiducials->fused_integral_size < fused_size_needed) {
+                fiducials->fused_integral = (Unsigned *)Memory__reallocate(
+                  (Memory)fiducials->fused_integral,
+                  fused_size_needed * sizeof(Unsigned));
+                fiducials->fused_integral_size = fused_size_needed;
+            }
+            CV_Image__fused_gray_threshold(original_image, gray_image,
+              edge_image, fiducials->threshold_block_size,
+              fiducials->threshold_offset, fiducials->fused_integral);
+        } else if (offload) {
+            // Hand the remap + threshold pair to the backend as one
+            // unit.  The combined time is charged to the threshold
+            // stage:
+            backend->process_routine(backend->object, converted_image,
+              gray_image, edge_image,
+              (fiducials->map_x != (CV_Image)0) ?
+              fiducials->remap_lut : (Integer *)0, fiducials->black,
+              fiducials->threshold_block_size, fiducials->threshold_offset);
+        } else {
+            CV_Image__adaptive_threshold(gray_image, edge_image, 255.0,
+              CV__adaptive_thresh_gaussian_c, CV__thresh_binary,
+              fiducials->threshold_block_size, fiducials->threshold_offset);
+        }
+        stats->threshold_seconds += Fiducials__now() - stage_mark;
+
+        // Show results of adaptive threshold for *debug_index* 3:
+        if (debug_index == 4) {
+            CV_Image__convert_color(edge_image, debug_image, CV__gray_to_rgb);
+        }
+
+        // Find the *edge_image* *contours*:
+        stage_mark = Fiducials__now();
+        CV_Sequence contours = CV_Image__find_contours(edge_image, storage,
+          header_size, CV__retr_list, CV__chain_approx_simple, origin);
+        if (contours == (CV_Sequence)0) {
+            Logger__format(LOGGER__LEVEL_DEBUG, "no contours found\n");
+        }
+
+        // For *debug_index* 4, show the *edge_image* *contours*:
+        if (debug_index == 5) {
+            //File__format(stderr, "Draw red contours\n");
+            CV_Scalar red = fiducials->red;
+            CV_Image__convert_color(gray_image, debug_image, CV__gray_to_rgb);
+            CV_Image__draw_contours(debug_image,
+              contours, red, red, 2, 2, 8, origin);
+        }
+
+        // For the remaining debug steps, we use the original *gray_image*:
+        if (debug_index >= 5) {
+            CV_Image__convert_color(gray_image, debug_image, CV__gray_to_rgb);
+        }
+
+        Fiducials__contours_harvest(fiducials,
+          contours, storage, debug_index, 1);
+        stats->contour_seconds += Fiducials__now() - stage_mark;
+    }
+
+    List /* <Camera_Tag> */ camera_tags = fiducials->camera_tags;
+    Map map = fiducials->map;
+
+    // Decode the harvested candidates.  When more than one decode thread
+    // is configured (and we are not single stepping with the debugger
+    // interface), the candidates are fanned out across worker threads;
+    // otherwise they are decoded serially right here:
+    Unsigned candidates_size = fiducials->candidates_size;
+    Unsigned decode_threads = fiducials->decode_threads;
+    stats->candidates += candidates_size;
+    stage_mark = Fiducials__now();
+
+    // Match the harvested quads against the tags decoded in the
+    // previous frame, so the decode phase can take the temporal fast
+    // path.  A quad matches the prior tag whose center is nearest and
+    // within a few pixels -- close enough that the prior corners land
+    // inside the sub-pixel refiner's search window.  Both counts are
+    // small, so the quadratic sweep is negligible:
+    if (fiducials->temporal && debug_index == 0) {
+        Unsigned priors_size = fiducials->priors_size;
+        for (Unsigned candidate_index = 0;
+          candidate_index < candidates_size; candidate_index++) {
+            Fiducials_Candidate candidate =
+              fiducials->candidates + candidate_index;
+            Double candidate_x = (candidate->corner_xs[0] +
+              candidate->corner_xs[1] + candidate->corner_xs[2] +
+              candidate->corner_xs[3]) / 4.0;
+            Double candidate_y = (candidate->corner_ys[0] +
+              candidate->corner_ys[1] + candidate->corner_ys[2] +
+              candidate->corner_ys[3]) / 4.0;
+            Double best_distance = 16.0;	// I.e. 4 pixels, squared
+            for (Unsigned prior_index = 0;
+              prior_index < priors_size; prior_index++) {
+                Fiducials_Prior prior = fiducials->priors + prior_index;
+                Double prior_x = (prior->corner_xs[0] +
+                  prior->corner_xs[1] + prior->corner_xs[2] +
+                  prior->corner_xs[3]) / 4.0;
+                Double prior_y = (prior->corner_ys[0] +
+                  prior->corner_ys[1] + prior->corner_ys[2] +
+                  prior->corner_ys[3]) / 4.0;
+                Double dx = candidate_x - prior_x;
+                Double dy = candidate_y - prior_y;
+                Double distance = dx * dx + dy * dy;
+                if (distance < best_distance) {
+                    best_distance = distance;
+                    candidate->prior = prior_index + 1;
                 }
             }
         }
     }
 
+    // Build the per-frame integral images used by the contrast
+    // pre-filter at the front of the decode phase:
+    fiducials->integral_valid = (Logical)0;
+    if (fiducials->early_reject && candidates_size > 0 && debug_index == 0) {
+        Integer integral_width = CV_Image__width_get(gray_image);
+        Integer integral_height = CV_Image__height_get(gray_image);
+        Unsigned size_needed =
+          (Unsigned)((integral_width + 1) * (integral_height + 1));
+        if (fiducials->integral_size < size_needed) {
+            fiducials->integral_sums = (Unsigned *)Memory__reallocate(
+              (Memory)fiducials->integral_sums,
+              size_needed * sizeof(Unsigned));
+            fiducials->integral_squares = (Double *)Memory__reallocate(
+              (Memory)fiducials->integral_squares,
+              size_needed * sizeof(Double));
+            fiducials->integral_size = size_needed;
+        }
+        CV_Image__integrals_compute(gray_image,
+          fiducials->integral_sums, fiducials->integral_squares);
+        fiducials->integral_valid = (Logical)1;
+    }
+
+    if (decode_threads > 1 && debug_index == 0 && candidates_size > 1) {
+        pthread_t threads[FIDUCIALS__DECODE_THREADS_MAXIMUM];
+        for (Unsigned index = 1; index < decode_threads; index++) {
+            assert (pthread_create(&threads[index], (pthread_attr_t *)0,
+              Fiducials__decode_worker,
+              (void *)fiducials->decodes[index]) == 0);
+        }
+        Fiducials__decode_worker((void *)fiducials->decodes[0]);
+        for (Unsigned index = 1; index < decode_threads; index++) {
+            assert (pthread_join(threads[index], (void **)0) == 0);
+        }
+    } else {
+        Fiducials_Decode decode = fiducials->decodes[0];
+        decode->debugging = (Logical)1;
+        for (Unsigned index = 0; index < candidates_size; index++) {
+            Fiducials__candidate_decode(fiducials,
+              fiducials->candidates + index, decode);
+        }
+        decode->debugging = (Logical)0;
+    }
+    stats->decode_seconds += Fiducials__now() - stage_mark;
+
+    // Remember this frame's decoded quads (refined corners, direction,
+    // tag id) as the priors for the next frame's temporal fast path.
+    // Debug stepping frames clear the priors, so the following normal
+    // frame re-acquires everything through the full path:
+    fiducials->priors_size = 0;
+    if (fiducials->temporal && debug_index == 0) {
+        for (Unsigned candidate_index = 0;
+          candidate_index < candidates_size; candidate_index++) {
+            Fiducials_Candidate candidate =
+              fiducials->candidates + candidate_index;
+            if (!candidate->matched) {
+                continue;
+            }
+            Unsigned priors_size = fiducials->priors_size;
+            if (priors_size >= fiducials->priors_limit) {
+                fiducials->priors_limit <<= 1;
+                fiducials->priors = (Fiducials_Prior)Memory__reallocate(
+                  (Memory)fiducials->priors,
+                  fiducials->priors_limit * sizeof(*fiducials->priors));
+            }
+            Fiducials_Prior prior = fiducials->priors + priors_size;
+            for (Unsigned index = 0; index < 4; index++) {
+                prior->corner_xs[index] = candidate->corner_xs[index];
+                prior->corner_ys[index] = candidate->corner_ys[index];
+            }
+            prior->direction = candidate->direction;
+            prior->tag_id = candidate->tag_id;
+            fiducials->priors_size = priors_size + 1;
+        }
+    }
+
+    // Feed this frame's contour count and decode yield to the adaptive
+    // threshold controller.  ROI sweep frames are skipped -- their
+    // contour counts are artificially low:
+    if (fiducials->tune && debug_index == 0 && !roi_sweep) {
+        Unsigned matched = 0;
+        for (Unsigned candidate_index = 0;
+          candidate_index < candidates_size; candidate_index++) {
+            if (fiducials->candidates[candidate_index].matched) {
+                matched += 1;
+            }
+        }
+        Fiducials__threshold_tune(fiducials,
+          fiducials->stats.contours - contours_mark, matched);
+    }
+
+    // Everything from here through *Map__update*() touches the shared
+    // map (tag lookups and pose reads, arc updates, tree updates), so
+    // when several detectors share one map (*Fiducials__share*()) this
+    // whole stage is serialized.  The vision stages above run fully
+    // concurrently:
+    Map__lock(map);
+
+    // Merge the decoded candidates into *camera_tags* in harvest order,
+    // so the result is deterministic no matter how many decode threads
+    // were used:
+    for (Unsigned candidate_index = 0;
+      candidate_index < candidates_size; candidate_index++) {
+        Fiducials_Candidate candidate =
+          fiducials->candidates + candidate_index;
+        if (!candidate->matched) {
+            continue;
+        }
+
+        // Overlapping ROI sweeps can harvest the same quad twice; only
+        // the first decode of a given tag identifier is kept:
+        Unsigned merged_size = List__size(camera_tags);
+        Logical duplicate = (Logical)0;
+        for (Unsigned index = 0; index < merged_size; index++) {
+            Camera_Tag previous_camera_tag =
+              (Camera_Tag)List__fetch(camera_tags, index);
+            if (previous_camera_tag->tag->id == candidate->tag_id) {
+                duplicate = (Logical)1;
+                break;
+            }
+        }
+        if (duplicate) {
+            continue;
+        }
+
+        // Load the refined corners back into the shared {corners} vector:
+        CV_Point2D32F_Vector corners = fiducials->corners;
+        for (Unsigned index = 0; index < 4; index++) {
+            CV_Point2D32F corner =
+              CV_Point2D32F_Vector__fetch1(corners, index);
+            CV_Point2D32F__x_set(corner, candidate->corner_xs[index]);
+            CV_Point2D32F__y_set(corner, candidate->corner_ys[index]);
+        }
+
+        // Allocate a *camera_tag*:
+        List /* <Camera_Tag> */ camera_tags_pool =
+          fiducials->camera_tags_pool;
+        Camera_Tag camera_tag = (Camera_Tag)0;
+        if (List__size(camera_tags_pool) == 0) {
+            // *camera_tags_pool* is empty; allocate a new one:
+            camera_tag = Camera_Tag__new();
+        } else {
+            camera_tag = (Camera_Tag)List__pop(camera_tags_pool);
+        }
+
+        // Load up *camera_tag* to get center, twist, etc.:
+        Tag tag = Map__tag_lookup(map, candidate->tag_id);
+        if (debug_index == 11) {
+            Camera_Tag__initialize(camera_tag, tag,
+              candidate->direction, corners, debug_image);
+        } else {
+            Camera_Tag__initialize(camera_tag, tag,
+              candidate->direction, corners, (CV_Image)0);
+        }
+
+        // Record the maximum *camera_diagonal*:
+        Double camera_diagonal = camera_tag->diagonal;
+        Double diagonal = camera_diagonal * tag->distance_per_pixel;
+        if (diagonal > tag->diagonal) {
+            tag->diagonal = diagonal;
+        }
+
+        // Append *camera_tag* to *camera_tags*:
+        List__append(camera_tags, (Memory)camera_tag);
+        //File__format(stderr, "Found %d\n", camera_tag->tag->id);
+    }
+
+    // The candidates vector is per-frame; empty it for the next frame:
+    fiducials->candidates_size = 0;
+    stats->tags += List__size(camera_tags);
+
     // Just for consistency sort *camera_tags*:
     List__sort(camera_tags, (List__Compare__Routine)Camera_Tag__compare);
 
-    // Sweep through all *camera_tag* pairs to generat associated *Arc*'s:
+    // Sweep through all *camera_tag* pairs to generat associated *Arc*'s.
+    // The batched kernel computes the per tag polar/floor geometry once
+    // instead of once per pair:
     Unsigned camera_tags_size = List__size(camera_tags);
+    stage_mark = Fiducials__now();
     if (camera_tags_size >= 2) {
-        // Iterate through all pairs, using a "triangle" scan:
-        for (Unsigned tag1_index = 0;
-          tag1_index < camera_tags_size - 1; tag1_index++) {
-            Camera_Tag camera_tag1 =
-              (Camera_Tag)List__fetch(camera_tags, tag1_index);
-        
-            for (Unsigned tag2_index = tag1_index + 1;
-              tag2_index < camera_tags_size; tag2_index++) {
-                Camera_Tag camera_tag2 =
-                  (Camera_Tag)List__fetch(camera_tags, tag2_index);
-                assert (camera_tag1->tag->id != camera_tag2->tag->id);
-                Map__arc_update(map, camera_tag1, camera_tag2, gray_image);
-            }
-        }
+        Map__arc_updates(map, camera_tags, gray_image);
     }
+    stats->arc_seconds += Fiducials__now() - stage_mark;
 
     if (camera_tags_size > 0) {
         Double pi = 3.14159265358979323846264;
         Unsigned half_width = CV_Image__width_get(gray_image) >> 1;
         Unsigned half_height = CV_Image__height_get(gray_image) >> 1;
-        File__format(stderr,
+        Fiducials__debug_format(stderr,
           "half_width=d half_height=%d\n", half_width, half_height);
         Location closest_location = (Location)0;
         for (Unsigned index = 0; index < camera_tags_size; index++) {
@@ -833,11 +1980,14 @@ Unsigned Fiducials__process(Fiducials fiducials) {
             Double y = tag->y + floor_distance * Double__sine(angle);
             Double bearing =
               Double__angle_normalize(camera_tag->twist + tag->twist);
-            File__format(stderr,
-              "[%d]:x=%f:y=%f:bearing=%f\n", index, x, y, bearing * 180.0 / pi);
+            Fiducials__debug_format(stderr,
+              "[%d]:x=%f:y=%f:bearing=%f\n", index, x, y,
+              bearing * 180.0 / pi);
             Unsigned location_index = List__size(locations);
-            Location location =
-              Location__create(x, y, bearing, floor_distance, location_index);
+            Location location = Location__initialize(
+              (Location)Memory__arena_allocate(fiducials->frame_arena,
+              sizeof(*location)),
+              x, y, bearing, floor_distance, location_index);
             if (closest_location == (Location)0) {
                 closest_location = location;
             } else {
@@ -847,7 +1997,42 @@ Unsigned Fiducials__process(Fiducials fiducials) {
             }
         }
         if (closest_location != (Location)0) {
-            List__append(locations, (Memory)closest_location);
+            // The arena storage is recycled at the start of the next
+            // frame, so the surviving location is copied into heap
+            // storage before it lands in *locations*.  In ring mode
+            // (*locations_limit* > 0) a full history overwrites its
+            // oldest entry in place, so the steady state performs no
+            // allocator calls; otherwise the heap object comes from
+            // *locations_pool* when one is available (mirroring
+            // *camera_tags_pool*):
+            Unsigned locations_limit = fiducials->locations_limit;
+            Location heap_location = (Location)0;
+            if (locations_limit > 0 &&
+              List__size(locations) >= locations_limit) {
+                Unsigned locations_head = fiducials->locations_head;
+                heap_location = (Location)List__fetch(locations,
+                  locations_head);
+                fiducials->locations_head =
+                  (locations_head + 1) % locations_limit;
+                closest_location = Location__initialize(heap_location,
+                  closest_location->x, closest_location->y,
+                  closest_location->bearing, closest_location->goodness,
+                  closest_location->index);
+            } else {
+                List /* <Location> */ locations_pool =
+                  fiducials->locations_pool;
+                if (List__size(locations_pool) == 0) {
+                    heap_location = Memory__new(Location);
+                } else {
+                    heap_location = (Location)List__pop(locations_pool);
+                }
+                closest_location = Location__initialize(heap_location,
+                  closest_location->x, closest_location->y,
+                  closest_location->bearing, closest_location->goodness,
+                  closest_location->index);
+                List__append(locations, (Memory)closest_location);
+            }
+            fiducials->location_latest = closest_location;
             //File__format(stderr,
             //  "Location: x=%f y=%f bearing=%f goodness=%f index=%d\n",
             //  closest_location->x, closest_location->y,
@@ -859,24 +2044,93 @@ Unsigned Fiducials__process(Fiducials fiducials) {
               closest_location->x, closest_location->y, 0.0,
               closest_location->bearing);
         }
-        File__format(stderr, "\n");
+        Fiducials__debug_format(stderr, "\n");
+    }
+
+    // When tracking is enabled, remember where each tag landed so that
+    // the next frame can get away with an ROI sweep.  A frame with no
+    // tags empties *track_boxes*, which forces a full sweep next time:
+    if (fiducials->track_enable) {
+        List /* <Bounding_Box> */ track_boxes_pool =
+          fiducials->track_boxes_pool;
+        List__all_append(track_boxes_pool, track_boxes);
+        List__trim(track_boxes, 0);
+        for (Unsigned index = 0; index < camera_tags_size; index++) {
+            Camera_Tag camera_tag = (Camera_Tag)List__fetch(camera_tags, index);
+            Bounding_Box box = (Bounding_Box)0;
+            if (List__size(track_boxes_pool) == 0) {
+                box = Bounding_Box__new();
+            } else {
+                box = (Bounding_Box)List__pop(track_boxes_pool);
+            }
+            Bounding_Box__reset(box);
+            Double half_diagonal = camera_tag->diagonal / 2.0;
+            Bounding_Box__update(box,
+              camera_tag->x - half_diagonal, camera_tag->y - half_diagonal);
+            Bounding_Box__update(box,
+              camera_tag->x + half_diagonal, camera_tag->y + half_diagonal);
+            List__append(track_boxes, (Memory)box);
+        }
     }
 
     // Clean out *camera_tags*:
     List__all_append(fiducials->camera_tags_pool, camera_tags);
     List__trim(camera_tags, 0);
 
+#if !defined(FIDUCIALS__RELEASE)
     // Flip the debug image:
-    if (fiducials->y_flip) {
+    if (fiducials->y_flip && debug_image != (CV_Image)0) {
         CV_Image__flip(debug_image, debug_image, 0);
     }
+#endif
 
     // Update the map:
+    stage_mark = Fiducials__now();
     Map__update(map);
+    Map__unlock(map);
+    stats->map_update_seconds += Fiducials__now() - stage_mark;
+    stats->frames += 1;
 
     return 0;
 }
 
+// The 3 x 3 sample weight tables selected by {weights_index} (scanned
+// row major):
+
+static Integer Fiducials__weights0[9] = {
+  0,   0,  0,
+  0, 100,  0,
+  0,  0,   0};
+
+static Integer Fiducials__weights1[9] = {
+   0,  15,  0,
+  15,  40,  15,
+   0,  15,  0};
+
+static Integer Fiducials__weights2[9] = {
+   5,  10,  5,
+  10,  40, 10,
+   5,  10,  5};
+
+// This routine returns the 3 x 3 sample weight table selected by the
+// {weights_index} of {fiducials}:
+
+static Integer *Fiducials__weights_select(Fiducials fiducials) {
+    Integer *weights = (Integer *)0;
+    switch (fiducials->weights_index) {
+      case 1:
+        weights = Fiducials__weights1;
+        break;
+      case 2:
+        weights = Fiducials__weights2;
+        break;
+      default:
+        weights = Fiducials__weights0;
+        break;
+    }
+    return weights;
+}
+
 Integer Fiducials__point_sample(Fiducials fiducials, CV_Point2D32F point) {
     // This routine will return a sample *fiducials* at *point*.
 
@@ -885,21 +2139,6 @@ Integer Fiducials__point_sample(Fiducials fiducials, CV_Point2D32F point) {
     Integer y = CV__round(CV_Point2D32F__y_get(point));
     CV_Image image = fiducials->gray_image;
 
-    static Integer weights0[9] = {
-      0,   0,  0,
-      0, 100,  0,
-      0,  0,   0};
-
-    static Integer weights1[9] = {
-       0,  15,  0,
-      15,  40,  15,
-       0,  15,  0};
-
-    static Integer weights2[9] = {
-       5,  10,  5,
-      10,  40, 10,
-       5,  10,  5};
-
     // Sample *image*:
     static Integer x_offsets[9] = {
       -1,  0,  1,
@@ -911,18 +2150,7 @@ Integer Fiducials__point_sample(Fiducials fiducials, CV_Point2D32F point) {
        1,  1,  1};
 
     // Select sample *weights*:
-    Integer *weights = (Integer *)0;
-    switch (fiducials->weights_index) {
-      case 1:
-        weights = weights1;
-        break;
-      case 2:
-        weights = weights2;
-        break;
-      default:
-        weights = weights0;
-        break;
-    }
+    Integer *weights = Fiducials__weights_select(fiducials);
 
     // Interate across sample point;
     Integer numerator = 0;
@@ -1005,8 +2233,17 @@ CV_Point2D32F_Vector Fiducials__references_compute(
     // (i.e. the white bounding box) and the last 4 reference points are
     // on the inside (i.e. the black bounding box).
 
-    // Extract the 8 references from {references}:
     CV_Point2D32F_Vector references = fiducials->references;
+    Fiducials__references_fill(corners, references);
+    return references;
+}
+
+// This routine does the actual reference point computation for
+// {Fiducials__references_compute}, but into a caller supplied
+// {references} vector so that each decode worker can use its own:
+
+static void Fiducials__references_fill(
+  CV_Point2D32F_Vector corners, CV_Point2D32F_Vector references) {
     CV_Point2D32F reference0 = CV_Point2D32F_Vector__fetch1(references, 0);
     CV_Point2D32F reference1 = CV_Point2D32F_Vector__fetch1(references, 1);
     CV_Point2D32F reference2 = CV_Point2D32F_Vector__fetch1(references, 2);
@@ -1076,8 +2313,6 @@ CV_Point2D32F_Vector Fiducials__references_compute(
     CV_Point2D32F__y_set(reference3, yy2 + dyy32 * 21.0 / 20.0);
     CV_Point2D32F__x_set(reference7, xx2 + dxx32 * 19.0 / 20.0);
     CV_Point2D32F__y_set(reference7, yy2 + dyy32 * 19.0 / 20.0);
-
-    return references;
 }
 
 Integer Fiducials__points_maximum(Fiducials fiducials,
@@ -1243,7 +2478,8 @@ void Fiducials__sample_points_helper(
     Double corner_y = CV_Point2D32F__y_get(corner);
     Double sample_point_x = CV_Point2D32F__x_get(sample_point);
     Double sample_point_y = CV_Point2D32F__y_get(sample_point);
-    File__format(stderr, "Label: %s corner: %f:%f sample_point %f:%f\n",
+    Logger__format(LOGGER__LEVEL_DEBUG,
+      "Label: %s corner: %f:%f sample_point %f:%f\n",
       label, (Integer)corner_x, (Integer)corner_y,
       (Integer)sample_point_x, (Integer)sample_point_y);
 }
@@ -1419,13 +2655,14 @@ void Fiducials__tag_record(Unsigned direction, CV_Point2D32F_Vector vector) {
                   
 void Fiducials__tag_heights_xml_read(
   Fiducials fiducials, const char * xml_file_name) {
-    File xml_in_file = File__open(xml_file_name, "r");
-    if (xml_in_file == (File)0) {
-        File__format(stderr, "Could not open '%s'\n", xml_file_name);
+    File_Reader xml_in_file = File_Reader__open((String)xml_file_name);
+    if (xml_in_file == (File_Reader)0) {
+        Logger__format(LOGGER__LEVEL_ERROR,
+          "Could not open '%s'\n", xml_file_name);
         assert(0);
     }
     Map map = fiducials->map;
     assert(map != (Map)0);
     Map__tag_heights_xml_read(map, xml_in_file);
-    File__close(xml_in_file);
+    File_Reader__close(xml_in_file);
 }
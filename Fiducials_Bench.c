@@ -0,0 +1,314 @@
+// Copyright (c) 2013 by Wayne C. Gramlich.  All rights reserved.
+
+// Fiducials_Bench runs the full *Fiducials__process*() pipeline over
+// the checked in .tga corpus for a fixed number of iterations and
+// reports per stage timing distributions, so detection performance is
+// comparable across machines and commits:
+//
+//        Fiducials_Bench [iterations] [lens.txt] [*.tga]
+//
+// *iterations* defaults to 10 passes over the corpus and the corpus
+// defaults to image-01.tga ... image-20.tga.  Every stage result goes
+// to standard output as one machine readable line:
+//
+//        fiducials_bench stage=<name> frames=<n> median_ms=<m> p99_ms=<p>
+//
+// so CI can grep the lines and chart per stage latency.  When a
+// Fiducials_Bench.golden file is present in the current directory the
+// observed tag ids are verified against its stored id list and the
+// median total frame time is verified against its stored threshold;
+// either mismatch makes the program exit nonzero.  When the file is
+// absent, a "golden" line in the file's format is printed so a known
+// good run can be captured:
+//
+//        threshold <milliseconds>
+//        tags <count> <id> ... <id>
+//
+// A *threshold* of 0.0 disables the timing check.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "CV.h"
+#include "Double.h"
+#include "Fiducials.h"
+#include "File.h"
+#include "Integer.h"
+#include "List.h"
+#include "Logical.h"
+#include "Map.h"
+#include "Memory.h"
+#include "String.h"
+#include "Tag.h"
+#include "Unsigned.h"
+
+/// @brief The number of timed stages (7 pipeline stages plus the total.)
+#define FIDUCIALS_BENCH__STAGES_SIZE 8
+
+// The per stage sample arrays are indexed by these constants; the
+// total is kept last so the stage loop reports it last:
+#define FIDUCIALS_BENCH__STAGE_CONVERT 0
+#define FIDUCIALS_BENCH__STAGE_REMAP 1
+#define FIDUCIALS_BENCH__STAGE_THRESHOLD 2
+#define FIDUCIALS_BENCH__STAGE_CONTOUR 3
+#define FIDUCIALS_BENCH__STAGE_DECODE 4
+#define FIDUCIALS_BENCH__STAGE_ARC 5
+#define FIDUCIALS_BENCH__STAGE_MAP_UPDATE 6
+#define FIDUCIALS_BENCH__STAGE_TOTAL 7
+
+// The stage names, in the same order as the stage constants:
+static const char * Fiducials_Bench__stage_names[
+  FIDUCIALS_BENCH__STAGES_SIZE] = {
+    "convert",
+    "remap",
+    "threshold",
+    "contour",
+    "decode",
+    "arc",
+    "map_update",
+    "total",
+};
+
+// *Fiducials_Bench__location_announce*() and
+// *Fiducials_Bench__tag_announce*() are silent announce routines; the
+// default announce routines would print every fix and tag move and
+// swamp the result lines:
+
+static void Fiducials_Bench__location_announce(void *object, Integer id,
+  Double x, Double y, Double z, Double bearing) {
+}
+
+static void Fiducials_Bench__tag_announce(void *object, Integer id,
+  Double x, Double y, Double z, Double twist,
+  Double dx, Double dy, Double dz) {
+}
+
+// *Fiducials_Bench__double_compare*() is the *qsort*() comparator for
+// the sample arrays:
+
+static int Fiducials_Bench__double_compare(
+  const void *left_pointer, const void *right_pointer) {
+    Double left = *(Double *)left_pointer;
+    Double right = *(Double *)right_pointer;
+    if (left < right) {
+	return -1;
+    }
+    if (left > right) {
+	return 1;
+    }
+    return 0;
+}
+
+// *Fiducials_Bench__percentile*() returns the *percent* percentile of
+// the *samples_size* sorted *samples* in milliseconds:
+
+static Double Fiducials_Bench__percentile(
+  Double *samples, Unsigned samples_size, Unsigned percent) {
+    assert (samples_size > 0);
+    Unsigned index = samples_size * percent / 100;
+    if (index >= samples_size) {
+	index = samples_size - 1;
+    }
+    return samples[index] * 1000.0;
+}
+
+// *Fiducials_Bench__unsigned_compare*() is the *qsort*() comparator
+// for the observed tag id array:
+
+static int Fiducials_Bench__unsigned_compare(
+  const void *left_pointer, const void *right_pointer) {
+    Unsigned left = *(Unsigned *)left_pointer;
+    Unsigned right = *(Unsigned *)right_pointer;
+    if (left < right) {
+	return -1;
+    }
+    if (left > right) {
+	return 1;
+    }
+    return 0;
+}
+
+int main(int arguments_size, char * arguments[]) {
+    Unsigned iterations = 10;
+    String lens_calibrate_file_name = (String)0;
+    List /* <String> */ image_file_names = List__new();
+
+    // Parse the command line; a bare number is the iteration count,
+    // a .txt file is the lens calibration, and .tga files replace the
+    // default corpus:
+    for (Unsigned index = 1; index < (Unsigned)arguments_size; index++) {
+	String argument = arguments[index];
+	Unsigned size = String__size(argument);
+	if (size > 4 && String__equal(argument + size - 4, ".txt")) {
+	    lens_calibrate_file_name = argument;
+	} else if (size > 4 && String__equal(argument + size - 4, ".tga")) {
+	    List__append(image_file_names, argument);
+	} else {
+	    iterations = String__to_unsigned(argument);
+	}
+    }
+    assert (iterations >= 1);
+
+    // Default to the checked in camera corpus when no images were
+    // listed:
+    if (List__size(image_file_names) == 0) {
+	for (Unsigned index = 1; index <= 20; index++) {
+	    List__append(image_file_names,
+	      String__format("image-%02d.tga", index));
+	}
+    }
+    Unsigned images_size = List__size(image_file_names);
+    Unsigned frames_size = images_size * iterations;
+
+    // Load the corpus up front so disk reads never land inside the
+    // timed region.  Every frame must match the first frame's
+    // geometry, since the pipeline buffers are sized once:
+    CV_Image *images =
+      (CV_Image *)Memory__allocate(images_size * sizeof(CV_Image));
+    for (Unsigned index = 0; index < images_size; index++) {
+	String image_file_name =
+	  (String)List__fetch(image_file_names, index);
+	CV_Image image = CV_Image__tga_read((CV_Image)0, image_file_name);
+	assert (image != (CV_Image)0);
+	assert (index == 0 || image->width == images[0]->width);
+	assert (index == 0 || image->height == images[0]->height);
+	images[index] = image;
+    }
+
+    Fiducials fiducials = Fiducials__create(images[0],
+      lens_calibrate_file_name, (void *)0,
+      Fiducials_Bench__location_announce, Fiducials_Bench__tag_announce);
+    Fiducials__headless_set(fiducials, (Logical)1);
+    Fiducials__tag_heights_xml_read(fiducials, "Tag_Heights.xml");
+
+    // One warm up pass over the corpus, so one-time costs (lazy table
+    // initialization, page faults on the pipeline buffers) stay out of
+    // the distributions:
+    for (Unsigned index = 0; index < images_size; index++) {
+	Fiducials__image_set(fiducials, images[index]);
+	Fiducials__process(fiducials);
+    }
+
+    // The timed passes.  The stats accumulators are reset before each
+    // frame, so each snapshot afterwards is that frame's per stage
+    // cost:
+    Double *samples[FIDUCIALS_BENCH__STAGES_SIZE];
+    for (Unsigned stage = 0; stage < FIDUCIALS_BENCH__STAGES_SIZE; stage++) {
+	samples[stage] =
+	  (Double *)Memory__allocate(frames_size * sizeof(Double));
+    }
+    Unsigned frame = 0;
+    for (Unsigned iteration = 0; iteration < iterations; iteration++) {
+	for (Unsigned index = 0; index < images_size; index++) {
+	    Fiducials__image_set(fiducials, images[index]);
+	    Fiducials__stats_reset(fiducials);
+	    Fiducials__process(fiducials);
+	    Fiducials_Stats stats = Fiducials__stats_get(fiducials);
+	    samples[FIDUCIALS_BENCH__STAGE_CONVERT][frame] =
+	      stats->convert_seconds;
+	    samples[FIDUCIALS_BENCH__STAGE_REMAP][frame] =
+	      stats->remap_seconds;
+	    samples[FIDUCIALS_BENCH__STAGE_THRESHOLD][frame] =
+	      stats->threshold_seconds;
+	    samples[FIDUCIALS_BENCH__STAGE_CONTOUR][frame] =
+	      stats->contour_seconds;
+	    samples[FIDUCIALS_BENCH__STAGE_DECODE][frame] =
+	      stats->decode_seconds;
+	    samples[FIDUCIALS_BENCH__STAGE_ARC][frame] = stats->arc_seconds;
+	    samples[FIDUCIALS_BENCH__STAGE_MAP_UPDATE][frame] =
+	      stats->map_update_seconds;
+	    samples[FIDUCIALS_BENCH__STAGE_TOTAL][frame] =
+	      stats->convert_seconds + stats->remap_seconds +
+	      stats->threshold_seconds + stats->contour_seconds +
+	      stats->decode_seconds + stats->arc_seconds +
+	      stats->map_update_seconds;
+	    frame += 1;
+	}
+    }
+    assert (frame == frames_size);
+
+    // Report the per stage medians and 99th percentiles:
+    for (Unsigned stage = 0; stage < FIDUCIALS_BENCH__STAGES_SIZE; stage++) {
+	qsort(samples[stage], frames_size, sizeof(Double),
+	  Fiducials_Bench__double_compare);
+	File__format(stdout,
+	  "fiducials_bench stage=%s frames=%d median_ms=%f p99_ms=%f\n",
+	  Fiducials_Bench__stage_names[stage], frames_size,
+	  Fiducials_Bench__percentile(samples[stage], frames_size, 50),
+	  Fiducials_Bench__percentile(samples[stage], frames_size, 99));
+    }
+    Double total_median_milliseconds = Fiducials_Bench__percentile(
+      samples[FIDUCIALS_BENCH__STAGE_TOTAL], frames_size, 50);
+
+    // Collect the sorted ids of every tag the corpus decoded into the
+    // map:
+    Map map = fiducials->map;
+    Unsigned tags_size = List__size(map->all_tags);
+    Unsigned *tag_ids =
+      (Unsigned *)Memory__allocate((tags_size + 1) * sizeof(Unsigned));
+    for (Unsigned index = 0; index < tags_size; index++) {
+	Tag tag = (Tag)List__fetch(map->all_tags, index);
+	tag_ids[index] = tag->id;
+    }
+    qsort(tag_ids, tags_size, sizeof(Unsigned),
+      Fiducials_Bench__unsigned_compare);
+
+    // Verify against the golden file, or print its replacement when
+    // there is none yet:
+    Unsigned failures = 0;
+    File golden_file = File__open("Fiducials_Bench.golden", "r");
+    if (golden_file == (File)0) {
+	File__format(stdout, "fiducials_bench golden file contents:\n");
+	File__format(stdout, "threshold 0.0\n");
+	File__format(stdout, "tags %d", tags_size);
+	for (Unsigned index = 0; index < tags_size; index++) {
+	    File__format(stdout, " %d", tag_ids[index]);
+	}
+	File__format(stdout, "\n");
+    } else {
+	double threshold_milliseconds = 0.0;
+	unsigned int golden_tags_size = 0;
+	assert (fscanf(golden_file,
+	  "threshold %lf\n", &threshold_milliseconds) == 1);
+	assert (fscanf(golden_file, "tags %u", &golden_tags_size) == 1);
+
+	// Verify the decoded tag ids:
+	if (golden_tags_size != tags_size) {
+	    File__format(stderr,
+	      "fiducials_bench FAIL: decoded %d tags, golden has %d\n",
+	      tags_size, golden_tags_size);
+	    failures += 1;
+	}
+	for (Unsigned index = 0; index < golden_tags_size; index++) {
+	    unsigned int golden_id = 0;
+	    assert (fscanf(golden_file, "%u", &golden_id) == 1);
+	    if (index < tags_size && (Unsigned)golden_id != tag_ids[index]) {
+		File__format(stderr,
+		  "fiducials_bench FAIL: tag id %d decoded where"
+		  " golden has %d\n", tag_ids[index], golden_id);
+		failures += 1;
+	    }
+	}
+	File__close(golden_file);
+
+	// Verify the timing threshold:
+	if (threshold_milliseconds > 0.0 &&
+	  total_median_milliseconds > threshold_milliseconds) {
+	    File__format(stderr,
+	      "fiducials_bench FAIL: median frame %f ms exceeds"
+	      " threshold %f ms\n",
+	      total_median_milliseconds, threshold_milliseconds);
+	    failures += 1;
+	}
+    }
+
+    if (failures != 0) {
+	File__format(stderr, "fiducials_bench %d failure(s)\n", failures);
+	return 1;
+    }
+    File__format(stdout, "fiducials_bench PASS\n");
+    return 0;
+}
@@ -1,11 +1,14 @@
 // Copyright (c) 2013 by Wayne C. Gramlich all rights reserved.
 
 #include <assert.h>
+#include <string.h>
 
 #include "Character.h"
 #include "File.h"
 #include "Float.h"
 #include "Integer.h"
+#include "Logical.h"
+#include "Memory.h"
 #include "String.h"
 #include "Unsigned.h"
 
@@ -103,7 +106,7 @@ Float File__float_attribute_read(File in_file, String attribute_name) {
 	} else if (character == '"') {
 	    break;
 	} else if (character == '.') {
-	    have_decimal_point;
+	    have_decimal_point = (Logical)1;
 	} else if (character == '-') {
 	    negative = (Logical)1;
 	} else {
@@ -230,3 +233,191 @@ void File__tag_match(File in_file, String tag_name) {
     File__string_match(in_file, tag_name);
 }
 
+// *File_Reader* routines:
+
+/// @brief *File_Reader__Struct* holds an entire file slurped into one
+/// memory buffer.  The parse routines below mirror their *File*
+/// counterparts but serve characters, matches, and attribute values
+/// straight out of the buffer, so parsers like *Map__read*() that make
+/// millions of one character reads are no longer bottlenecked on per
+/// character stdio call overhead.
+struct File_Reader__Struct {
+    char *buffer;
+    Unsigned offset;
+    Unsigned size;
+};
+
+/// @brief Returns the next character from *reader*.
+/// @param reader to read from.
+/// @returns character read, or (*Character*)(-1) at end of file.
+///
+/// *File_Reader__character_read*() will return the next character from
+/// *reader*'s buffer.
+
+Character File_Reader__character_read(File_Reader reader) {
+    if (reader->offset >= reader->size) {
+	return (Character)(-1);
+    }
+    Character character = reader->buffer[reader->offset];
+    reader->offset += 1;
+    return character;
+}
+
+/// @brief Closes *reader* and releases its buffer.
+/// @param reader to close.
+///
+/// *File_Reader__close*() will release the storage associated with
+/// *reader*.
+
+void File_Reader__close(File_Reader reader) {
+    Memory__free((Memory)reader->buffer);
+    Memory__free((Memory)reader);
+}
+
+/// @brief Reads in an XML attribute with a floating point value.
+/// @param reader is the reader to read from.
+/// @param attribute_name is the attribute name.
+/// @returns the floating point value.
+///
+/// *File_Reader__float_attribute_read*() will read in a pattern that
+/// matches ' ATTRIBUTE_NAME="VALUE"', where ATTRIBUTE_NAME matches
+/// *attribute_name* and VALUE is an optionally signed floating point
+/// number.  An assertion failure occurs if the input does not parse
+/// properly.
+
+Float File_Reader__float_attribute_read(
+  File_Reader reader, String attribute_name) {
+    File_Reader__string_match(reader, " ");
+    File_Reader__string_match(reader, attribute_name);
+    File_Reader__string_match(reader, "=\"");
+    Float fraction = (Float)1.0;
+    Logical have_decimal_point = (Logical)0;
+    Logical negative = (Logical)0;
+    Float result = (Float)0.0;
+    while (1) {
+	Character character = File_Reader__character_read(reader);
+	if (Character__is_decimal_digit(character)) {
+	    if (have_decimal_point) {
+		fraction /= (Float)10.0;
+		result += fraction * (Float)(character - '0');
+	    } else {
+		result = result * 10.0 + (Float)(character - '0');
+	    }
+	} else if (character == '"') {
+	    break;
+	} else if (character == '.') {
+	    have_decimal_point = (Logical)1;
+	} else if (character == '-') {
+	    negative = (Logical)1;
+	} else {
+	    assert(0);
+	}
+    }
+    if (negative) {
+	result = -result;
+    }
+    return result;
+}
+
+/// @brief Reads in an XML attribute with an integer value.
+/// @param reader is the reader to read from.
+/// @param attribute_name is the attribute name.
+/// @returns the integer value.
+///
+/// *File_Reader__integer_attribute_read*() will read in a pattern that
+/// matches ' ATTRIBUTE_NAME="VALUE"', where ATTRIBUTE_NAME matches
+/// *attribute_name* and VALUE is an optionally signed integer number.
+/// An assertion failure occurs if the input does not parse properly.
+
+Integer File_Reader__integer_attribute_read(
+  File_Reader reader, String attribute_name) {
+    File_Reader__string_match(reader, " ");
+    File_Reader__string_match(reader, attribute_name);
+    File_Reader__string_match(reader, "=\"");
+    Logical negative = (Logical)0;
+    Integer result = 0;
+    while (1) {
+	Character character = File_Reader__character_read(reader);
+	if (Character__is_decimal_digit(character)) {
+	    result = result * 10 + (character - '0');
+	} else if (character == '"') {
+	    break;
+	} else if (character == '-') {
+	    negative = (Logical)1;
+	} else {
+	    assert(0);
+	}
+    }
+    if (negative) {
+	result = -result;
+    }
+    return result;
+}
+
+/// @brief Opens *file_name* and slurps it into a *File_Reader*.
+/// @param file_name is the file to read in.
+/// @returns the new *File_Reader*, or (*File_Reader*)0 if the open failed.
+///
+/// *File_Reader__open*() will read the entire contents of *file_name*
+/// into memory and return a *File_Reader* that serves all subsequent
+/// parsing from that buffer.
+
+File_Reader File_Reader__open(String file_name) {
+    File file = File__open(file_name, "rb");
+    if (file == (File)0) {
+	return (File_Reader)0;
+    }
+    assert (fseek(file, 0L, SEEK_END) == 0);
+    long size = ftell(file);
+    assert (size >= 0L);
+    rewind(file);
+
+    File_Reader reader = Memory__new(File_Reader);
+    reader->buffer = (char *)Memory__allocate((Unsigned)size + 1);
+    reader->offset = 0;
+    reader->size = (Unsigned)size;
+    assert (fread(reader->buffer, 1, (size_t)size, file) == (size_t)size);
+    reader->buffer[size] = '\0';
+    File__close(file);
+    return reader;
+}
+
+/// @brief Exactly matches *pattern* read from *reader*.
+/// @param reader to read from.
+/// @param pattern to match.
+///
+/// *File_Reader__string_match*() will match *pattern* against the next
+/// characters of *reader* in one *memcmp*() rather than a character at
+/// a time.  An assertion failure occurs if *pattern* does not match
+/// exactly.
+
+void File_Reader__string_match(File_Reader reader, String pattern) {
+    Unsigned size = String__size(pattern);
+    assert (reader->offset + size <= reader->size);
+    assert (memcmp(reader->buffer + reader->offset, pattern, size) == 0);
+    reader->offset += size;
+}
+
+/// @brief Matches an "XML" start tag.
+/// @param reader is the reader to read from.
+/// @param tag_name is the name of the tag to match.
+///
+/// *File_Reader__tag_match*() parses "WHITESPACE<TAG" where WHITESPACE
+/// is zero or more spaces and TAG matches *tag_name*.  The '<' is
+/// located with one *memchr*() scan.  An assertion failure occurs if
+/// the pattern does not parse properly.
+
+void File_Reader__tag_match(File_Reader reader, String tag_name) {
+    char *open_angle = (char *)memchr(reader->buffer + reader->offset,
+      '<', reader->size - reader->offset);
+    assert (open_angle != (char *)0);
+
+    // Only spaces may precede the '<':
+    Unsigned open_offset = (Unsigned)(open_angle - reader->buffer);
+    for (Unsigned offset = reader->offset; offset < open_offset; offset++) {
+	assert (reader->buffer[offset] == ' ');
+    }
+    reader->offset = open_offset + 1;
+    File_Reader__string_match(reader, tag_name);
+}
+
@@ -2,7 +2,18 @@
 
 // This program will display a grey scale image on the screen in real time.
 
+// _GNU_SOURCE (a superset of _POSIX_C_SOURCE 200809L) is needed for
+// the O_DIRECT flag used by the raw frame recorder:
+#define _GNU_SOURCE
+
 #include <assert.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 // If *PTGREY* is not defined, we make sure it is defined as 0:
 #if !defined(PTGREY)
@@ -21,17 +32,619 @@
 #include "Fiducials.h"
 #include "High_GUI2.h"
 #include "Integer.h"
+#include "Logger.h"
 #include "Memory.h"
 #include "String.h"
 #include "Unsigned.h"
 
+// The pipelined mode runs capture, detection, and announce/display as
+// three overlapping stages on separate threads.  Capture and detection
+// share a ring of three pre-registered frame buffers; each {FC2_Image}
+// buffer is permanently wrapped by a {CV_Image} header, so no frame data
+// is ever copied between capture and detection.  The two stages trade
+// buffers through a single lock-free "exchange" word that holds the
+// newest complete frame slot plus a fresh bit:
+//
+//     [capture] <=> exchange <=> [detect]
+//
+// When the capture stage finishes a frame it atomically swaps the slot
+// into the exchange and takes back whatever slot was there; if the old
+// slot was still fresh (never seen by the detect stage), that stale
+// frame is reclaimed without copying and counted as dropped.  The
+// detect stage swaps its spent slot for the exchange slot whenever the
+// fresh bit is set, so it always works on the freshest complete frame.
+// Display snapshots still circulate through small bounded queues:
+//
+//     free_queue -> [detect] -> display_queue -> [announce/display]
+
+// The number of frame slots circulating through the pipeline:
+#define FLY_CAPTURE__SLOTS 3
+
+// A slot value that tells a stage to shut down:
+#define FLY_CAPTURE__SLOT_DONE FLY_CAPTURE__SLOTS
+
+// The exchange word bit that marks its slot as not yet seen by the
+// detect stage (the slot index lives in the bits below it):
+#define FLY_CAPTURE__FRESH 4
+
+typedef struct Frame_Queue__Struct *Frame_Queue;
+typedef struct Fly_Capture_Pipeline__Struct *Fly_Capture_Pipeline;
+
+// {Frame_Queue__Struct} is a tiny bounded queue of slot indices:
+struct Frame_Queue__Struct {
+    Unsigned head;
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    Unsigned size;
+    Unsigned slots[FLY_CAPTURE__SLOTS + 1];
+};
+
+// {Fly_Capture_Pipeline__Struct} bundles up the shared pipeline state:
+struct Fly_Capture_Pipeline__Struct {
+    FC2_Camera camera;
+    FC2_Image camera_image;
+    FC2_Image converted_images[FLY_CAPTURE__SLOTS];
+    CV_Image detect_images[FLY_CAPTURE__SLOTS];
+    CV_Image display_images[FLY_CAPTURE__SLOTS];
+    struct Frame_Queue__Struct display_queue;
+    volatile Logical done;
+    Unsigned dropped;
+    atomic_uint exchange;
+    Fiducials fiducials;
+    struct Frame_Queue__Struct free_queue;
+    struct Fly_Capture_Recorder__Struct *recorder;
+};
+
+// This routine will initialize the {queue} to be empty:
+
+static void Frame_Queue__initialize(Frame_Queue queue) {
+    queue->head = 0;
+    queue->size = 0;
+    assert (pthread_mutex_init(&queue->mutex, (pthread_mutexattr_t *)0) == 0);
+    assert (pthread_cond_init(&queue->not_empty, (pthread_condattr_t *)0) == 0);
+    assert (pthread_cond_init(&queue->not_full, (pthread_condattr_t *)0) == 0);
+}
+
+// This routine will append {slot} to {queue}, blocking while {queue} is full:
+
+static void Frame_Queue__put(Frame_Queue queue, Unsigned slot) {
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->size > FLY_CAPTURE__SLOTS) {
+	pthread_cond_wait(&queue->not_full, &queue->mutex);
+    }
+    queue->slots[(queue->head + queue->size) % (FLY_CAPTURE__SLOTS + 1)] = slot;
+    queue->size += 1;
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+// This routine will remove and return the oldest slot in {queue},
+// blocking while {queue} is empty:
+
+static Unsigned Frame_Queue__get(Frame_Queue queue) {
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->size == 0) {
+	pthread_cond_wait(&queue->not_empty, &queue->mutex);
+    }
+    Unsigned slot = queue->slots[queue->head];
+    queue->head = (queue->head + 1) % (FLY_CAPTURE__SLOTS + 1);
+    queue->size -= 1;
+    pthread_cond_signal(&queue->not_full);
+    pthread_mutex_unlock(&queue->mutex);
+    return slot;
+}
+
+// This routine will remove the oldest slot in {queue} into {slot} and
+// return 1, or return 0 immediately when {queue} is empty.  The frame
+// recorder uses it so that a writer thread that has fallen behind the
+// disk never blocks the detect stage:
+
+static Logical Frame_Queue__try_get(Frame_Queue queue, Unsigned *slot) {
+    Logical got = (Logical)0;
+    pthread_mutex_lock(&queue->mutex);
+    if (queue->size > 0) {
+	*slot = queue->slots[queue->head];
+	queue->head = (queue->head + 1) % (FLY_CAPTURE__SLOTS + 1);
+	queue->size -= 1;
+	got = (Logical)1;
+	pthread_cond_signal(&queue->not_full);
+    }
+    pthread_mutex_unlock(&queue->mutex);
+    return got;
+}
+
+// The raw frame recorder (-record) appends the exact raw frames the
+// detector saw to a preallocated on-disk ring file so that field
+// failures can be replayed offline.  Encoding each frame through
+// {CV_Image__tga_write} from the frame loop would cost far more than a
+// camera period; instead the frame loop memcpy's the frame into one of
+// a small ring of page aligned staging buffers and hands it to a
+// dedicated writer thread, which streams each frame to the ring file
+// as one large aligned sequential {pwrite} (O_DIRECT when the file
+// system supports it, so the copies bypass the page cache.)  The ring
+// file holds the newest {FLY_CAPTURE__RECORD_FRAMES} frames; a frame's
+// byte offset is just its slot number times the frame stride.  A
+// sidecar index file records one fixed layout record per written frame
+// (wall clock timestamp, frame number, ring slot, and the tag ids
+// decoded in that frame.)  When the writer thread falls behind the
+// disk, new frames are dropped (and counted) rather than ever stalling
+// detection.
+
+// The number of page aligned staging buffers circulating between the
+// frame loop and the writer thread (reusing the {Frame_Queue} slot
+// capacity and the {FLY_CAPTURE__SLOT_DONE} shutdown sentinel):
+#define FLY_CAPTURE__RECORD_SLOTS FLY_CAPTURE__SLOTS
+
+// The ring file capacity in frames; the newest frames overwrite the
+// oldest (about 17 seconds of 640x480 BGR at 30 frames per second,
+// using 450 megabytes of disk):
+#define FLY_CAPTURE__RECORD_FRAMES 512
+
+// Staging buffers, frame strides, and hence every {pwrite} offset and
+// length are multiples of this, as O_DIRECT requires:
+#define FLY_CAPTURE__RECORD_ALIGNMENT 4096
+
+// The maximum number of decoded tag ids kept in one index record:
+#define FLY_CAPTURE__RECORD_TAGS_MAXIMUM 12
+
+// The index file magic number and format version:
+#define FLY_CAPTURE__RECORD_MAGIC 0x52434552	// "RECR"
+#define FLY_CAPTURE__RECORD_VERSION 1
+
+typedef struct Fly_Capture_Record__Struct *Fly_Capture_Record;
+typedef struct Fly_Capture_Record_Header__Struct *Fly_Capture_Record_Header;
+typedef struct Fly_Capture_Recorder__Struct *Fly_Capture_Recorder;
+
+// {Fly_Capture_Record_Header__Struct} is the fixed layout header at
+// the front of the index file; it carries the frame geometry needed to
+// interpret the ring file:
+struct Fly_Capture_Record_Header__Struct {
+    Unsigned magic;
+    Unsigned version;
+    Unsigned columns;
+    Unsigned rows;
+    Unsigned channels;
+    Unsigned frame_stride;
+    Unsigned ring_frames;
+    Unsigned pad;
+};
+
+// {Fly_Capture_Record__Struct} is one fixed layout index record,
+// appended to the index file after its frame reaches the ring file:
+struct Fly_Capture_Record__Struct {
+    Double timestamp;
+    Unsigned frame_number;
+    Unsigned ring_slot;
+    Unsigned tag_ids_size;
+    Unsigned tag_ids[FLY_CAPTURE__RECORD_TAGS_MAXIMUM];
+    Unsigned pad;
+};
+
+// {Fly_Capture_Recorder__Struct} bundles up the recorder state shared
+// by the frame loop and the writer thread:
+struct Fly_Capture_Recorder__Struct {
+    Memory buffers[FLY_CAPTURE__RECORD_SLOTS];
+    Unsigned columns;
+    Logical direct;
+    Unsigned dropped;
+    Unsigned frame_number;
+    Unsigned frame_size;
+    Unsigned frame_stride;
+    struct Frame_Queue__Struct free_queue;
+    struct Frame_Queue__Struct full_queue;
+    Integer index_fd;
+    struct Fly_Capture_Record__Struct records[FLY_CAPTURE__RECORD_SLOTS];
+    Integer ring_fd;
+    Unsigned rows;
+    pthread_t writer_thread;
+};
+
+// This routine will return the wall clock in seconds.  The index
+// records use the wall clock (rather than the monotonic clock) so that
+// recorded frames can be correlated with external logs:
+
+static Double Fly_Capture_Recorder__now(void) {
+    struct timespec now;
+    assert (clock_gettime(CLOCK_REALTIME, &now) == 0);
+    return (Double)now.tv_sec + (Double)now.tv_nsec * 1e-9;
+}
+
+// The writer thread: stream each full staging buffer to the ring file
+// as one large aligned sequential write, append the frame's index
+// record, and recycle the buffer:
+
+static void *Fly_Capture_Recorder__writer(void *memory) {
+    Fly_Capture_Recorder recorder = (Fly_Capture_Recorder)memory;
+    while (1) {
+	Unsigned slot = Frame_Queue__get(&recorder->full_queue);
+	if (slot == FLY_CAPTURE__SLOT_DONE) {
+	    break;
+	}
+	Fly_Capture_Record record = &recorder->records[slot];
+
+	// One large sequential write per frame.  The frame stride (not
+	// just the frame size) is written so that the offset and length
+	// both stay aligned for O_DIRECT:
+	off_t offset = (off_t)record->ring_slot * recorder->frame_stride;
+	ssize_t written = pwrite(recorder->ring_fd,
+	  recorder->buffers[slot], recorder->frame_stride, offset);
+	if (written < 0 && recorder->direct) {
+	    // This file system rejects O_DIRECT writes after all; drop
+	    // back to page cached writes and retry:
+	    Integer flags = fcntl(recorder->ring_fd, F_GETFL);
+	    assert (flags >= 0);
+	    assert (fcntl(recorder->ring_fd,
+	      F_SETFL, flags & ~O_DIRECT) == 0);
+	    recorder->direct = (Logical)0;
+	    written = pwrite(recorder->ring_fd,
+	      recorder->buffers[slot], recorder->frame_stride, offset);
+	}
+	assert (written == (ssize_t)recorder->frame_stride);
+
+	// The index record goes out only after its frame data, so a
+	// truncated recording never indexes an unwritten frame:
+	assert (write(recorder->index_fd,
+	  (Memory)record, sizeof(*record)) == sizeof(*record));
+
+	Frame_Queue__put(&recorder->free_queue, slot);
+    }
+    return (void *)0;
+}
+
+// This routine will create a recorder writing {columns} x {rows} BGR
+// frames to {base_name}.ring with its index in {base_name}.index:
+
+static Fly_Capture_Recorder Fly_Capture_Recorder__create(
+  String base_name, Unsigned columns, Unsigned rows) {
+    Fly_Capture_Recorder recorder = Memory__new(Fly_Capture_Recorder);
+    recorder->columns = columns;
+    recorder->dropped = 0;
+    recorder->frame_number = 0;
+    recorder->frame_size = columns * rows * 3;
+    recorder->frame_stride =
+      (recorder->frame_size + FLY_CAPTURE__RECORD_ALIGNMENT - 1) &
+      ~(Unsigned)(FLY_CAPTURE__RECORD_ALIGNMENT - 1);
+    recorder->rows = rows;
+    Frame_Queue__initialize(&recorder->free_queue);
+    Frame_Queue__initialize(&recorder->full_queue);
+
+    // Open the ring file, preferring O_DIRECT so that the sustained
+    // frame stream does not churn the page cache:
+    String ring_file_name = String__format("%s.ring", base_name);
+    recorder->direct = (Logical)1;
+    Integer ring_fd = open(ring_file_name,
+      O_CREAT | O_WRONLY | O_TRUNC | O_DIRECT, 0644);
+    if (ring_fd < 0) {
+	recorder->direct = (Logical)0;
+	ring_fd = open(ring_file_name, O_CREAT | O_WRONLY | O_TRUNC, 0644);
+    }
+    assert (ring_fd >= 0);
+    recorder->ring_fd = ring_fd;
+    String__free(ring_file_name);
+
+    // Preallocate the full ring up front, so recording never stalls on
+    // block allocation and the layout stays sequential:
+    off_t ring_size =
+      (off_t)FLY_CAPTURE__RECORD_FRAMES * recorder->frame_stride;
+    if (posix_fallocate(ring_fd, 0, ring_size) != 0) {
+	assert (ftruncate(ring_fd, ring_size) == 0);
+    }
+
+    // Open the index sidecar and write its header:
+    String index_file_name = String__format("%s.index", base_name);
+    Integer index_fd =
+      open(index_file_name, O_CREAT | O_WRONLY | O_TRUNC, 0644);
+    assert (index_fd >= 0);
+    recorder->index_fd = index_fd;
+    String__free(index_file_name);
+    struct Fly_Capture_Record_Header__Struct header;
+    header.magic = FLY_CAPTURE__RECORD_MAGIC;
+    header.version = FLY_CAPTURE__RECORD_VERSION;
+    header.columns = columns;
+    header.rows = rows;
+    header.channels = 3;
+    header.frame_stride = recorder->frame_stride;
+    header.ring_frames = FLY_CAPTURE__RECORD_FRAMES;
+    header.pad = 0;
+    assert (write(index_fd, (Memory)&header, sizeof(header)) ==
+      sizeof(header));
+
+    // Allocate the page aligned staging buffers (zeroed once, so the
+    // alignment padding written after each frame is not heap garbage):
+    for (Unsigned slot = 0; slot < FLY_CAPTURE__RECORD_SLOTS; slot++) {
+	assert (posix_memalign(&recorder->buffers[slot],
+	  FLY_CAPTURE__RECORD_ALIGNMENT, recorder->frame_stride) == 0);
+	(void)memset(recorder->buffers[slot], 0, recorder->frame_stride);
+	Frame_Queue__put(&recorder->free_queue, slot);
+    }
+
+    assert (pthread_create(&recorder->writer_thread, (pthread_attr_t *)0,
+      Fly_Capture_Recorder__writer, (void *)recorder) == 0);
+    return recorder;
+}
+
+// This routine will queue {image} (the frame just processed through
+// {fiducials}) for recording.  It never blocks: when every staging
+// buffer is waiting on the disk the frame is dropped and counted:
+
+static void Fly_Capture_Recorder__submit(
+  Fly_Capture_Recorder recorder, CV_Image image, Fiducials fiducials) {
+    Unsigned slot;
+    if (!Frame_Queue__try_get(&recorder->free_queue, &slot)) {
+	recorder->dropped += 1;
+	return;
+    }
+
+    // Compact the frame rows into the staging buffer (the only copy on
+    // the recording path):
+    Unsigned row_size = recorder->columns * 3;
+    char *buffer = (char *)recorder->buffers[slot];
+    for (Unsigned row = 0; row < recorder->rows; row++) {
+	(void)memcpy(buffer + row * row_size,
+	  image->imageData + row * image->widthStep, row_size);
+    }
+
+    // Fill in the index record, harvesting the tag ids this frame
+    // decoded from the candidate quads:
+    Fly_Capture_Record record = &recorder->records[slot];
+    record->timestamp = Fly_Capture_Recorder__now();
+    record->frame_number = recorder->frame_number;
+    record->ring_slot =
+      recorder->frame_number % FLY_CAPTURE__RECORD_FRAMES;
+    record->tag_ids_size = 0;
+    record->pad = 0;
+    Unsigned candidates_size = fiducials->candidates_size;
+    for (Unsigned index = 0; index < candidates_size; index++) {
+	Fiducials_Candidate candidate = &fiducials->candidates[index];
+	if (candidate->matched &&
+	  record->tag_ids_size < FLY_CAPTURE__RECORD_TAGS_MAXIMUM) {
+	    record->tag_ids[record->tag_ids_size] = candidate->tag_id;
+	    record->tag_ids_size += 1;
+	}
+    }
+    recorder->frame_number += 1;
+
+    Frame_Queue__put(&recorder->full_queue, slot);
+}
+
+// This routine will drain and shut down {recorder}, reporting how many
+// frames reached the ring file and how many were dropped:
+
+static void Fly_Capture_Recorder__free(Fly_Capture_Recorder recorder) {
+    Frame_Queue__put(&recorder->full_queue, FLY_CAPTURE__SLOT_DONE);
+    assert (pthread_join(recorder->writer_thread, (void **)0) == 0);
+    Logger__format(LOGGER__LEVEL_INFO,
+      "Recorded %d frame(s) (%d dropped behind the disk)\n",
+      recorder->frame_number, recorder->dropped);
+    assert (close(recorder->ring_fd) == 0);
+    assert (close(recorder->index_fd) == 0);
+    for (Unsigned slot = 0; slot < FLY_CAPTURE__RECORD_SLOTS; slot++) {
+	free(recorder->buffers[slot]);
+    }
+    Memory__free((Memory)recorder);
+}
+
+// The frame skip governor of the serial loop (the -pipeline mode needs
+// none: its exchange word always hands the detect stage the newest
+// complete frame.)  When a frame takes longer to process than one
+// camera period (a contour storm, a map update spike), frames queue
+// inside the FlyCapture driver and every subsequent localization fix
+// is computed on ever staler imagery.  The governor estimates the
+// camera period from the retrieve-to-retrieve intervals -- when the
+// loop keeps up, each retrieve blocks until the next exposure, so the
+// smallest intervals track the true period -- and after an expensive
+// frame retrieves and discards the frames that queued during it.  That
+// bounds worst case localization staleness at about one camera period
+// instead of letting it grow.  Skips are counted in the detection
+// stats (*skips*) and reported at exit.
+
+// *Fly_Capture__now*() returns the monotonic clock in seconds:
+
+static Double Fly_Capture__now(void) {
+    struct timespec now;
+    assert (clock_gettime(CLOCK_MONOTONIC, &now) == 0);
+    return (Double)now.tv_sec + (Double)now.tv_nsec * 1e-9;
+}
+
+// The capture stage: retrieve frames into the stage's current buffer
+// as fast as the camera will go, publishing each completed frame
+// through the exchange word:
+
+static void *Fly_Capture__capture_stage(void *memory) {
+    Fly_Capture_Pipeline pipeline = (Fly_Capture_Pipeline)memory;
+    Unsigned slot = 0;
+    while (!pipeline->done) {
+	// Retrieve and convert the next frame into the slot:
+	FC2_Camera__image_retrieve(pipeline->camera, pipeline->camera_image);
+	FC2_Image__convert(pipeline->camera_image,
+	  pipeline->converted_images[slot], FC2_PIXEL_FORMAT_BGR);
+
+	// Rebind the slot's {CV_Image} header in case the FC2 library
+	// moved the image data buffer:
+	pipeline->detect_images[slot]->imageData =
+	  FC2_Image__data_get(pipeline->converted_images[slot]);
+
+	// Publish the completed frame and take back the slot that was
+	// in the exchange.  If that slot was still fresh, the detect
+	// stage never got to it; it is reclaimed without any copy:
+	Unsigned previous =
+	  atomic_exchange(&pipeline->exchange, slot | FLY_CAPTURE__FRESH);
+	if ((previous & FLY_CAPTURE__FRESH) != 0) {
+	    pipeline->dropped += 1;
+	}
+	slot = previous & (FLY_CAPTURE__FRESH - 1);
+    }
+    return (void *)0;
+}
+
+// The detect stage: swap for the freshest complete frame, run
+// {Fiducials__process} over it, and copy the resulting debug image out
+// for the display stage:
+
+static void *Fly_Capture__detect_stage(void *memory) {
+    Fly_Capture_Pipeline pipeline = (Fly_Capture_Pipeline)memory;
+    Fiducials fiducials = pipeline->fiducials;
+    Unsigned slot = 1;
+    while (!pipeline->done) {
+	// Wait until the capture stage has published a fresh frame.
+	// The handoff itself never blocks; this is just a polite poll:
+	if ((atomic_load(&pipeline->exchange) & FLY_CAPTURE__FRESH) == 0) {
+	    struct timespec pause = {0, 1000000};	// 1 millisecond
+	    (void)nanosleep(&pause, (struct timespec *)0);
+	    continue;
+	}
+
+	// Trade the spent slot for the freshest complete one:
+	slot = atomic_exchange(&pipeline->exchange, slot) &
+	  (FLY_CAPTURE__FRESH - 1);
+
+	// Detect tags in the slot image.  The location/tag announce
+	// callbacks fire from this thread:
+	Fiducials__image_set(fiducials, pipeline->detect_images[slot]);
+	Fiducials__process(fiducials);
+
+	// Hand the raw frame and its decode results to the recorder
+	// (if recording); the submit never blocks:
+	if (pipeline->recorder != (Fly_Capture_Recorder)0) {
+	    Fly_Capture_Recorder__submit(pipeline->recorder,
+	      pipeline->detect_images[slot], fiducials);
+	}
+
+	// Snapshot the debug image so the next frame can start before
+	// the display stage is finished with this one:
+	Unsigned display_slot = Frame_Queue__get(&pipeline->free_queue);
+	if (display_slot == FLY_CAPTURE__SLOT_DONE) {
+	    break;
+	}
+	CV_Image__copy(fiducials->debug_image,
+	  pipeline->display_images[display_slot], (CV_Image)0);
+
+	Frame_Queue__put(&pipeline->display_queue, display_slot);
+    }
+
+    // Pass the shutdown along to the display stage:
+    Frame_Queue__put(&pipeline->display_queue, FLY_CAPTURE__SLOT_DONE);
+    return (void *)0;
+}
+
+// This routine runs the 3-stage pipeline.  The calling thread becomes
+// the announce/display stage (the GUI must run on the main thread.)
+
+static void Fly_Capture__pipeline_run(FC2_Camera camera,
+  FC2_Image camera_image, FC2_Image converted_image, String window_name,
+  String record_base_name) {
+    struct Fly_Capture_Pipeline__Struct pipeline_struct;
+    Fly_Capture_Pipeline pipeline = &pipeline_struct;
+    pipeline->camera = camera;
+    pipeline->camera_image = camera_image;
+    pipeline->done = (Logical)0;
+    pipeline->dropped = 0;
+    pipeline->recorder = (Fly_Capture_Recorder)0;
+    Frame_Queue__initialize(&pipeline->display_queue);
+    Frame_Queue__initialize(&pipeline->free_queue);
+
+    // The capture stage starts owning slot 0 and the detect stage slot 1;
+    // slot 2 sits in the exchange (with no fresh bit set):
+    atomic_init(&pipeline->exchange, 2);
+
+    // Prime the pump with one frame to learn the image geometry:
+    FC2_Camera__image_retrieve(camera, camera_image);
+    FC2_Image__convert(camera_image, converted_image, FC2_PIXEL_FORMAT_BGR);
+    Unsigned columns = converted_image->cols;
+    Unsigned rows = converted_image->rows;
+    Logger__format(LOGGER__LEVEL_INFO, "columns: %d\n", columns);
+    Logger__format(LOGGER__LEVEL_INFO, "rows: %d\n", rows);
+
+    // Start the raw frame recorder now that the frame geometry is known:
+    if (record_base_name != (String)0) {
+	pipeline->recorder =
+	  Fly_Capture_Recorder__create(record_base_name, columns, rows);
+    }
+
+    // Allocate the frame slots.  Each {FC2_Image} buffer is registered
+    // once with a {CV_Image} header here; only the header's data pointer
+    // is ever touched again, so frames move through the pipeline without
+    // being copied.  The *free_queue* only circulates display snapshots:
+    CV_Size image_size = CV_Size__create(columns, rows);
+    for (Unsigned slot = 0; slot < FLY_CAPTURE__SLOTS; slot++) {
+	pipeline->converted_images[slot] = FC2_Image__create();
+	pipeline->detect_images[slot] =
+	  CV_Image__header_create(image_size, IPL_DEPTH_8U, 3);
+	pipeline->detect_images[slot]->imageData =
+	  FC2_Image__data_get(converted_image);
+	pipeline->display_images[slot] =
+	  CV_Image__create(image_size, IPL_DEPTH_8U, 3);
+	Frame_Queue__put(&pipeline->free_queue, slot);
+    }
+
+    // Create the *Fiducials* object used by the detect stage:
+    Fiducials fiducials = Fiducials__create(pipeline->detect_images[0],
+      (String)0, (void *)0, Fiducials__location_announce, Map__tag_announce);
+    fiducials->debug_index = 11;
+    pipeline->fiducials = fiducials;
+
+    // Spin up the capture and detect stages:
+    pthread_t capture_thread;
+    pthread_t detect_thread;
+    assert (pthread_create(&capture_thread, (pthread_attr_t *)0,
+      Fly_Capture__capture_stage, (void *)pipeline) == 0);
+    assert (pthread_create(&detect_thread, (pthread_attr_t *)0,
+      Fly_Capture__detect_stage, (void *)pipeline) == 0);
+
+    // The calling thread is the announce/display stage:
+    while (1) {
+	Unsigned slot = Frame_Queue__get(&pipeline->display_queue);
+	if (slot == FLY_CAPTURE__SLOT_DONE) {
+	    break;
+	}
+	CV_Image__show(pipeline->display_images[slot], window_name);
+	Frame_Queue__put(&pipeline->free_queue, slot);
+
+	// Deal with character input key stroke:
+	Character character = CV__wait_key(1) & 0xff;
+	if (character == '\033') {
+	    // [Esc] key causes the pipeline to drain and stop:
+	    pipeline->done = (Logical)1;
+	    Frame_Queue__put(&pipeline->free_queue, FLY_CAPTURE__SLOT_DONE);
+	} else if (character == '+') {
+	    fiducials->debug_index += 1;
+	    Logger__format(LOGGER__LEVEL_INFO,
+	      "debug_index=%d\n", fiducials->debug_index);
+	} else if (character == '-') {
+	    fiducials->debug_index -= 1;
+	    Logger__format(LOGGER__LEVEL_INFO,
+	      "debug_index=%d\n", fiducials->debug_index);
+	}
+    }
+
+    // Wait for the stages to finish:
+    assert (pthread_join(capture_thread, (void **)0) == 0);
+    assert (pthread_join(detect_thread, (void **)0) == 0);
+    Logger__format(LOGGER__LEVEL_INFO,
+      "Pipeline dropped %d stale frame(s) without copying\n",
+      pipeline->dropped);
+    if (pipeline->recorder != (Fly_Capture_Recorder)0) {
+	Fly_Capture_Recorder__free(pipeline->recorder);
+    }
+
+    // Release the frame slots:
+    for (Unsigned slot = 0; slot < FLY_CAPTURE__SLOTS; slot++) {
+	FC2_Image__free(pipeline->converted_images[slot]);
+	CV__release_image(pipeline->display_images[slot]);
+    }
+}
+
 /// @brief A video display routine that can capture images.
 /// @param arguments_size is the number of command line arguments (plus 1.)
 /// @param arguments is the command line arguments vector.
 /// @returns 0 for success and 1 for failure.
 ///
 /// *main*() opens a camera (or video file) and allows the user to capture
-/// images by typing the [space] key.
+/// images by typing the [space] key.  The *-pipeline* option runs capture,
+/// detection, and announce/display as overlapping pipeline stages.  The
+/// *-record* option streams every raw frame the detector sees (plus an
+/// index of timestamps and decoded tag ids) to an on-disk ring file.
 
 int main(int arguments_size, char * arguments[]) {
     if (arguments_size <= 1) {
@@ -42,11 +655,36 @@ int main(int arguments_size, char * arguments[]) {
     } else {
         // Deal with the command line *arguments*:
 	String capture_base_name = "video_capture";
-	String argument1 = arguments[1];
-	if (arguments_size > 2) {
-	    // Override *capture_base_name*:
-	    capture_base_name = arguments[2];
+	String argument1 = (String)0;
+	Logical headless = (Logical)0;
+	Logical pipeline = (Logical)0;
+	Logical record = (Logical)0;
+	for (Unsigned index = 1; index < (Unsigned)arguments_size; index++) {
+	    String argument = arguments[index];
+	    if (String__equal(argument, "-pipeline")) {
+		// Run the pipelined capture/detect/announce stages:
+		pipeline = (Logical)1;
+	    } else if (String__equal(argument, "-record")) {
+		// Record every raw frame the detector sees to the
+		// {capture_base_name}.ring/.index pair:
+		record = (Logical)1;
+	    } else if (String__equal(argument, "-headless")) {
+		// Run detection with no display support at all:
+		headless = (Logical)1;
+	    } else if (argument1 == (String)0) {
+		argument1 = argument;
+	    } else {
+		// Override *capture_base_name*:
+		capture_base_name = argument;
+	    }
 	}
+	if (argument1 == (String)0) {
+	    argument1 = "0";
+	}
+
+	// Route diagnostics through the asynchronous logger so that a
+	// slow or redirected *stderr* never stalls the frame loop:
+	Logger__start(stderr);
 
 	// Figure whether to open a video file or a camera;
 	Unsigned camera_number = 0;
@@ -57,7 +695,8 @@ int main(int arguments_size, char * arguments[]) {
 
 	// Print FlyCapture2 Library version:
 	FC2_Version version = FC2__library_version_get();
-	File__format(stderr, "FlyCapture2 Library Version: %d.%d.%d.%d\n",
+	Logger__format(LOGGER__LEVEL_INFO,
+	  "FlyCapture2 Library Version: %d.%d.%d.%d\n",
 	  version->major, version->minor, version->type, version->build);
 
 	// Get a camera camera:
@@ -78,18 +717,19 @@ int main(int arguments_size, char * arguments[]) {
 	    // Print out some *camera_information*:
 	    FC2_Camera_Information camera_information =
 	      FC2_Camera__information_get(camera);
-	    File__format(stderr,
+	    Logger__format(LOGGER__LEVEL_INFO,
 	      "Serial number %u\n", camera_information->serialNumber);
-	    File__format(stderr,
+	    Logger__format(LOGGER__LEVEL_INFO,
 	      "Camera model %s\n", camera_information->modelName);
-	    File__format(stderr,
+	    Logger__format(LOGGER__LEVEL_INFO,
 	      "Camera vendor %s\n", camera_information->vendorName);
-	    File__format(stderr, "Sensor %s\n", camera_information->sensorInfo);
-	    File__format(stderr,
+	    Logger__format(LOGGER__LEVEL_INFO,
+	      "Sensor %s\n", camera_information->sensorInfo);
+	    Logger__format(LOGGER__LEVEL_INFO,
 	      "Resolution %s\n", camera_information->sensorResolution);
-	    File__format(stderr,
+	    Logger__format(LOGGER__LEVEL_INFO,
 	      "Firmware version %s\n", camera_information->firmwareVersion);
-	    File__format(stderr,
+	    Logger__format(LOGGER__LEVEL_INFO,
 	      "Firmware build time %s\n",
 	      camera_information->firmwareBuildTime);
 
@@ -100,20 +740,66 @@ int main(int arguments_size, char * arguments[]) {
 	    FC2_Image camera_image = FC2_Image__create();
 	    FC2_Image converted_image = FC2_Image__create();
 
-	    // Create the window to display the video into:
+	    // The pipeline mode displays from the main thread, so it gets
+	    // a plain window; the serial loop hands frames to a decoupled
+	    // *CV_Viewer* that refreshes at its own throttled rate, so
+	    // detection never blocks on GUI event pumping.  Headless mode
+	    // gets no display support at all:
 	    String window_name = "Video_Capture";
-	    CV__named_window(window_name, CV__window_auto_size);
-	    //cvResizeWindow(window_name, 1000, 800);
+	    CV_Viewer viewer = (CV_Viewer)0;
+	    if (pipeline) {
+		CV__named_window(window_name, CV__window_auto_size);
+		//cvResizeWindow(window_name, 1000, 800);
+	    } else if (!headless) {
+		viewer = CV_Viewer__create(window_name, 33);
+	    }
 
 	    Fiducials fiducials = (Fiducials)0;
 
 	    // Do a video loop:
 	    CV_Image display_image = (CV_Image)0;
 	    Unsigned capture_number = 0;
-	    while (1) {
+
+	    // Captured frames are handed to a background writer thread,
+	    // so saving a frame does not stall the video loop behind
+	    // the disk:
+	    CV_Image_Dumper image_dumper = CV_Image_Dumper__create();
+	    Fly_Capture_Recorder recorder = (Fly_Capture_Recorder)0;
+
+	    // Frame skip governor state (see the comment above
+	    // *Fly_Capture__now*()).  *governor_debt* carries the
+	    // fractional backlog, so a loop running at (say) 1.5x the
+	    // camera period still skips every other frame instead of
+	    // rounding its backlog down to zero forever:
+	    Double governor_debt = 0.0;
+	    Double governor_period = 0.0;
+	    Unsigned governor_skips = 0;
+	    Double previous_arrival = 0.0;
+	    if (pipeline) {
+		// Run the 3-stage pipeline in place of the serial loop:
+		Fly_Capture__pipeline_run(camera, camera_image,
+		  converted_image, window_name,
+		  record ? capture_base_name : (String)0);
+	    } else while (1) {
 		// Retrieve *camera_image* from *camera*:
 		FC2_Camera__image_retrieve(camera, camera_image);
 
+		// Fold the arrival interval into the governor's camera
+		// period estimate, drifting slowly upward so a camera
+		// that slows down is tracked too:
+		Double arrival = Fly_Capture__now();
+		if (previous_arrival > 0.0) {
+		    Double interval = arrival - previous_arrival;
+		    if (governor_period == 0.0 ||
+		      interval < governor_period) {
+			governor_period = interval;
+		    } else {
+			governor_period +=
+			  (interval - governor_period) * 0.05;
+		    }
+		}
+		previous_arrival = arrival;
+
 		// For some reason, converting the image from grey to color
 		// causes the frame rate to dramatically increase.  This is
 		// a mystery to us, but since it works, we do it:
@@ -130,11 +816,14 @@ int main(int arguments_size, char * arguments[]) {
 		    Memory image_data = FC2_Image__data_get(converted_image);
 
 		    // Print some stuff for debugging:
-		    File__format(stderr, "columns: %d\n", columns);
-		    File__format(stderr, "rows: %d\n", rows);
-		    File__format(stderr, "stride: %d\n", stride);
-		    File__format(stderr, "data_size: %d\n", data_size);
-		    File__format(stderr, "image_data: 0x%x\n", image_data);
+		    Logger__format(LOGGER__LEVEL_DEBUG,
+		      "columns: %d\n", columns);
+		    Logger__format(LOGGER__LEVEL_DEBUG, "rows: %d\n", rows);
+		    Logger__format(LOGGER__LEVEL_DEBUG, "stride: %d\n", stride);
+		    Logger__format(LOGGER__LEVEL_DEBUG,
+		      "data_size: %d\n", data_size);
+		    Logger__format(LOGGER__LEVEL_DEBUG,
+		      "image_data: 0x%x\n", image_data);
 
 		    // Allocate *display_image* and make it share *image_data*
 		    // with the ...
@@ -147,53 +836,117 @@ int main(int arguments_size, char * arguments[]) {
 		    fiducials = Fiducials__create(display_image, (String)0,
 		      (void *)0, Fiducials__location_announce,
 		      Map__tag_announce);
-		    fiducials->debug_index = 11;
+		    if (headless) {
+			Fiducials__headless_set(fiducials, (Logical)1);
+		    } else {
+			fiducials->debug_index = 11;
+		    }
+		    if (record) {
+			recorder = Fly_Capture_Recorder__create(
+			  capture_base_name, columns, rows);
+		    }
 		}
 
-		// Show the image:
-		//CV_Image__show(display_image, window_name);
+		// Process the image and hand the debug view (if any) to
+		// the viewer; detection does not wait for the display:
 		Fiducials__process(fiducials);
-		CV_Image__show(fiducials->debug_image, window_name);
+		if (recorder != (Fly_Capture_Recorder)0) {
+		    Fly_Capture_Recorder__submit(recorder,
+		      display_image, fiducials);
+		}
+		if (viewer != (CV_Viewer)0) {
+		    CV_Viewer__submit(viewer, fiducials->debug_image);
+		}
 
-		// Deal with character input key stroke:
-		Character character = CV__wait_key(1) & 0xff;
+		// Deal with character input key stroke (headless mode
+		// has no keyboard; it runs until the process is killed):
+		Character character = '\0';
+		if (viewer != (CV_Viewer)0) {
+		    character = CV_Viewer__key_get(viewer);
+		}
 		if (character == '\033') {
 		    // [Esc] key causes program to escape:
 		    break;
 		} else if (character == '+') {
 		    fiducials->debug_index += 1;
-		    File__format(stderr,
+		    Logger__format(LOGGER__LEVEL_INFO,
 		      "debug_index=%d\n", fiducials->debug_index);
 		} else if (character == '-') {
 		    fiducials->debug_index -= 1;
-		    File__format(stderr,
+		    Logger__format(LOGGER__LEVEL_INFO,
 		      "debug_index=%d\n", fiducials->debug_index);
 		} else if (character == '>') {
 		    fiducials->weights_index += 1;
-		    File__format(stderr,
+		    Logger__format(LOGGER__LEVEL_INFO,
 		      "weights_index=%d\n", fiducials->weights_index);
 		} else if (character == '<') {
 		    fiducials->weights_index -= 1;
-		    File__format(stderr,
+		    Logger__format(LOGGER__LEVEL_INFO,
 		      "weights_index=%d\n", fiducials->weights_index);
 		} else if (character == ' ') {
 		    // Write out image out to file system as a .pnm file:
 
-		    // For some reason String__format() does not work
-		    // on CygWin running on Windows 7 right now:
 		    char file_name[200];
-		    (void)sprintf(file_name, "%s-%02d.pnm",
-		      capture_base_name, capture_number);
-		    CV_Image__pnm_write(display_image, file_name);
-		    File__format(stderr,
-		      "Wrote display_image out to file '%s'\n", file_name);
+		    (void)String__format_into(file_name, sizeof(file_name),
+		      "%s-%02d.pnm", capture_base_name, capture_number);
+		    if (CV_Image_Dumper__submit(image_dumper,
+		      display_image, file_name)) {
+			Logger__format(LOGGER__LEVEL_INFO,
+			  "Queued display_image for file '%s'\n", file_name);
+		    } else {
+			Logger__format(LOGGER__LEVEL_INFO,
+			  "Dropped an older capture for file '%s'\n",
+			  file_name);
+		    }
 		    capture_number += 1;
 		    //String__free(file_name);
 		}
+
+		// Frame skip governor: when this frame ran longer than
+		// the camera period, retrieve and discard the frames
+		// that queued in the driver meanwhile, so the next
+		// processed frame is the newest one:
+		Double frame_seconds = Fly_Capture__now() - arrival;
+		if (governor_period > 0.0 &&
+		  frame_seconds > governor_period) {
+		    governor_debt +=
+		      frame_seconds / governor_period - 1.0;
+		    Unsigned behind = (Unsigned)governor_debt;
+		    if (behind > 8) {
+			behind = 8;
+		    }
+		    governor_debt -= (Double)behind;
+		    if (behind > 0) {
+			for (Unsigned skip = 0; skip < behind; skip++) {
+			    FC2_Camera__image_retrieve(camera, camera_image);
+			}
+			governor_skips += behind;
+			fiducials->stats.skips += behind;
+
+			// The next arrival interval is distorted by
+			// the discards; keep it out of the estimate:
+			previous_arrival = 0.0;
+		    }
+		} else {
+		    // A frame that kept up pays off any leftover debt:
+		    governor_debt = 0.0;
+		}
 	    }
 
 	    // Release unneeded storage:
-	    CV__destroy_window(window_name);
+	    CV_Image_Dumper__free(image_dumper);
+	    if (recorder != (Fly_Capture_Recorder)0) {
+		Fly_Capture_Recorder__free(recorder);
+	    }
+	    if (governor_skips > 0) {
+		Logger__format(LOGGER__LEVEL_INFO,
+		  "Governor skipped %d stale frame(s)\n", governor_skips);
+	    }
+	    if (viewer != (CV_Viewer)0) {
+		CV_Viewer__free(viewer);
+	    } else if (pipeline) {
+		CV__destroy_window(window_name);
+	    }
 	    //FIXME: Release *display_image*:
 	    //FC2_Camera__free(camera);
 	    Memory__free((Memory)camera_information);
@@ -201,8 +954,10 @@ int main(int arguments_size, char * arguments[]) {
 	    FC2_Image__free(camera_image);
 	    FC2_Image__free(converted_image);
 	} else {
-	    File__format(stderr, "Camera %d is not availble.\n", camera_number);
+	    Logger__format(LOGGER__LEVEL_ERROR,
+	      "Camera %d is not availble.\n", camera_number);
 	}
+	Logger__stop();
     }
 
     return 0;
@@ -0,0 +1,148 @@
+// Copyright (c) 2013 by Wayne C. Gramlich.  All rights reserved.
+
+#include <assert.h>
+#include "Heap.h"
+#include "List.h"
+#include "Memory.h"
+#include "Unsigned.h"
+
+// The initial number of item slots allocated by *Heap__new*():
+#define HEAP__INITIAL_LIMIT 16
+
+/// @brief Grows the item storage of *heap* to hold *limit* items.
+/// @param heap to grow.
+/// @param limit is the new item limit.
+
+static void Heap__limit_set(Heap heap, Unsigned limit) {
+    heap->items = (Memory *)Memory__reallocate(
+      (Memory)heap->items, limit * sizeof(Memory));
+    heap->limit = limit;
+}
+
+// *Heap__sift_up*() restores the heap ordering along the path from the
+// just appended item at *index* up to the root.  The item that
+// *compare_routine* sorts last bubbles toward the root:
+
+static void Heap__sift_up(Heap heap, Unsigned index) {
+    Heap__Compare__Routine compare_routine = heap->compare_routine;
+    Memory *items = heap->items;
+    Memory item = items[index];
+    while (index > 0) {
+	Unsigned parent_index = (index - 1) >> 1;
+	Memory parent_item = items[parent_index];
+	if (compare_routine(item, parent_item) <= 0) {
+	    break;
+	}
+	items[index] = parent_item;
+	index = parent_index;
+    }
+    items[index] = item;
+}
+
+// *Heap__sift_down*() restores the heap ordering below the root after
+// a pop moved the last item there:
+
+static void Heap__sift_down(Heap heap) {
+    Heap__Compare__Routine compare_routine = heap->compare_routine;
+    Memory *items = heap->items;
+    Unsigned size = heap->size;
+    Unsigned index = 0;
+    Memory item = items[0];
+    while (1) {
+	// Pick whichever child *compare_routine* sorts later:
+	Unsigned child_index = (index << 1) + 1;
+	if (child_index >= size) {
+	    break;
+	}
+	if (child_index + 1 < size && compare_routine(
+	  items[child_index + 1], items[child_index]) > 0) {
+	    child_index += 1;
+	}
+	if (compare_routine(items[child_index], item) <= 0) {
+	    break;
+	}
+	items[index] = items[child_index];
+	index = child_index;
+    }
+    items[index] = item;
+}
+
+/// @brief Push every item of *list* onto *heap*.
+/// @param heap to push onto.
+/// @param list of items to push.
+///
+/// *Heap__all_push*() will push every item of *list* onto *heap*.
+
+void Heap__all_push(Heap heap, List list) {
+    Unsigned list_size = List__size(list);
+    for (Unsigned index = 0; index < list_size; index++) {
+	Heap__push(heap, List__fetch(list, index));
+    }
+}
+
+/// @brief Return a new empty *Heap* object ordered by *compare_routine*.
+/// @param compare_routine defines the heap order.
+/// @returns the new empty *Heap* object.
+///
+/// *Heap__new*() will return a new empty *Heap* object.  *Heap__pop*()
+/// returns the item that *compare_routine* sorts last, exactly as if
+/// the items were kept on a *List* sorted with *compare_routine* and
+/// popped from the end.
+
+Heap Heap__new(Heap__Compare__Routine compare_routine) {
+    Heap heap = Memory__new(Heap);
+    heap->compare_routine = compare_routine;
+    heap->items =
+      (Memory *)Memory__allocate(HEAP__INITIAL_LIMIT * sizeof(Memory));
+    heap->limit = HEAP__INITIAL_LIMIT;
+    heap->size = 0;
+    return heap;
+}
+
+/// @brief Pop the item that *compare_routine* sorts last from *heap*.
+/// @param heap to pop from.
+/// @returns the popped item.
+///
+/// *Heap__pop*() will remove and return the item of *heap* that its
+/// *compare_routine* sorts last.  An assertion failure occurs if
+/// *heap* is empty.
+
+Memory Heap__pop(Heap heap) {
+    Unsigned size = heap->size;
+    assert (size > 0);
+    Memory *items = heap->items;
+    Memory item = items[0];
+    size -= 1;
+    heap->size = size;
+    if (size > 0) {
+	items[0] = items[size];
+	Heap__sift_down(heap);
+    }
+    return item;
+}
+
+/// @brief Push *item* onto *heap*.
+/// @param heap to push onto.
+/// @param item to push onto *heap*.
+///
+/// *Heap__push*() will push *item* onto *heap*.
+
+void Heap__push(Heap heap, Memory item) {
+    Unsigned size = heap->size;
+    if (size >= heap->limit) {
+	Heap__limit_set(heap, heap->limit << 1);
+    }
+    heap->items[size] = item;
+    heap->size = size + 1;
+    Heap__sift_up(heap, size);
+}
+
+/// @brief Return the number of items in *heap*.
+/// @param heap to measure.
+/// @returns the number of items.
+///
+/// *Heap__size*() will return the number of items currently in *heap*.
+
+Unsigned Heap__size(Heap heap) {
+    return heap->size;
+}
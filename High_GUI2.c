@@ -2,12 +2,19 @@
 
 //#include "opencv/cv.h"
 
+#include <assert.h>
 #include <opencv2/highgui/highgui_c.h>
+#include <pthread.h>
 
+#include "Character.h"
 #include "CV.h"
 #include "Double.h"
 #include "High_GUI2.h"
 #include "Integer.h"
+#include "Logical.h"
+#include "Memory.h"
+#include "String.h"
+#include "Unsigned.h"
 
 Integer CV_Capture__property_pos_msec = CV_CAP_PROP_POS_MSEC;
 Integer CV_Capture__property_frames = CV_CAP_PROP_POS_FRAMES;
@@ -126,5 +133,160 @@ Integer CV__wait_key(Integer delay) {
     return cvWaitKey(delay);
 }
 
+// *CV_Viewer* routines:
+
+/// @brief *CV_Viewer__Struct* is a decoupled display viewer.  The
+/// detection thread drops a frame snapshot into the single-slot
+/// mailbox with *CV_Viewer__submit*() and keeps running; a dedicated
+/// viewer thread owns the window and shows the newest mailbox frame at
+/// its own throttled rate, so the detector never blocks on
+/// *CV__wait_key*() event pumping.  An unconsumed mailbox frame is
+/// simply replaced by the next submission.
+struct CV_Viewer__Struct {
+    CV_Image buffer;
+    Unsigned interval;
+    Character key;
+    pthread_mutex_t mutex;
+    Logical pending;
+    Logical shutdown;
+    pthread_t thread;
+    String window_name;
+};
+
+// *CV_Viewer__display*() is the viewer thread entry point.  It owns
+// the window, swaps the mailbox frame out whenever one is pending, and
+// pumps GUI events for {interval} milliseconds per lap:
+
+static void *CV_Viewer__display(void *memory) {
+    CV_Viewer viewer = (CV_Viewer)memory;
+    CV__named_window(viewer->window_name, CV__window_auto_size);
+    CV_Image display_image = (CV_Image)0;
+    while (1) {
+	// Trade our spent frame for the newest mailbox frame, if any:
+	assert (pthread_mutex_lock(&viewer->mutex) == 0);
+	Logical shutdown = viewer->shutdown;
+	if (viewer->pending) {
+	    CV_Image swap_image = display_image;
+	    display_image = viewer->buffer;
+	    viewer->buffer = swap_image;
+	    viewer->pending = (Logical)0;
+	}
+	assert (pthread_mutex_unlock(&viewer->mutex) == 0);
+	if (shutdown) {
+	    break;
+	}
+
+	if (display_image != (CV_Image)0) {
+	    CV_Image__show(display_image, viewer->window_name);
+	}
+
+	// Pump the GUI events and throttle to the display interval:
+	Integer key = CV__wait_key((Integer)viewer->interval);
+	if (key != -1) {
+	    assert (pthread_mutex_lock(&viewer->mutex) == 0);
+	    viewer->key = (Character)(key & 0xff);
+	    assert (pthread_mutex_unlock(&viewer->mutex) == 0);
+	}
+    }
+    CV__destroy_window(viewer->window_name);
+    if (display_image != (CV_Image)0) {
+	CV__release_image(display_image);
+    }
+    return (void *)0;
+}
+
+/// @brief Creates a decoupled viewer with its own display thread.
+/// @param window_name is the window to display frames into.
+/// @param interval_milliseconds is the display refresh period.
+/// @returns the new *CV_Viewer* object.
+///
+/// *CV_Viewer__create*() starts the viewer thread, which creates the
+/// window and refreshes it every *interval_milliseconds* from the
+/// newest submitted frame.  *window_name* must outlive the viewer.
+
+CV_Viewer CV_Viewer__create(
+  String window_name, Unsigned interval_milliseconds) {
+    CV_Viewer viewer = Memory__new(CV_Viewer);
+    viewer->buffer = (CV_Image)0;
+    viewer->interval = interval_milliseconds;
+    viewer->key = '\0';
+    viewer->pending = (Logical)0;
+    viewer->shutdown = (Logical)0;
+    viewer->window_name = window_name;
+    assert (pthread_mutex_init(&viewer->mutex, (void *)0) == 0);
+    assert (pthread_create(&viewer->thread,
+      (pthread_attr_t *)0, CV_Viewer__display, (void *)viewer) == 0);
+    return viewer;
+}
+
+/// @brief Returns the most recent key press, or '\0' when none.
+/// @param viewer to poll.
+/// @returns the latest key character since the previous call.
+///
+/// *CV_Viewer__key_get*() lets the detection thread poll the window's
+/// keyboard input without ever calling *CV__wait_key*() itself.
+
+Character CV_Viewer__key_get(CV_Viewer viewer) {
+    assert (pthread_mutex_lock(&viewer->mutex) == 0);
+    Character key = viewer->key;
+    viewer->key = '\0';
+    assert (pthread_mutex_unlock(&viewer->mutex) == 0);
+    return key;
+}
+
+/// @brief Submits a snapshot of *image* for display.
+/// @param viewer to submit to.
+/// @param image to snapshot and display.
+/// @returns true if queued, false if it replaced an unshown frame.
+///
+/// *CV_Viewer__submit*() copies *image* into the mailbox and returns
+/// immediately; the caller's *image* can be reused as soon as this
+/// returns.  When the viewer has not consumed the previous frame yet,
+/// that stale frame is replaced.
+
+Logical CV_Viewer__submit(CV_Viewer viewer, CV_Image image) {
+    assert (pthread_mutex_lock(&viewer->mutex) == 0);
+    Logical replaced = viewer->pending;
+
+    // Make sure the mailbox buffer matches *image* and copy into it:
+    CV_Image buffer = viewer->buffer;
+    if (buffer != (CV_Image)0 &&
+      (buffer->width != image->width || buffer->height != image->height ||
+      buffer->depth != image->depth ||
+      buffer->nChannels != image->nChannels)) {
+	CV__release_image(buffer);
+	buffer = (CV_Image)0;
+    }
+    if (buffer == (CV_Image)0) {
+	buffer = CV__clone_image(image);
+    } else {
+	CV_Image__copy(image, buffer, (CV_Image)0);
+    }
+    viewer->buffer = buffer;
+    viewer->pending = (Logical)1;
+
+    assert (pthread_mutex_unlock(&viewer->mutex) == 0);
+    return !replaced;
+}
+
+/// @brief Stops and releases *viewer*.
+/// @param viewer to free.
+///
+/// *CV_Viewer__free*() stops the viewer thread (which closes the
+/// window) and releases all storage.
+
+void CV_Viewer__free(CV_Viewer viewer) {
+    assert (pthread_mutex_lock(&viewer->mutex) == 0);
+    viewer->shutdown = (Logical)1;
+    assert (pthread_mutex_unlock(&viewer->mutex) == 0);
+    assert (pthread_join(viewer->thread, (void **)0) == 0);
+
+    if (viewer->buffer != (CV_Image)0) {
+	CV__release_image(viewer->buffer);
+    }
+    assert (pthread_mutex_destroy(&viewer->mutex) == 0);
+    Memory__free((Memory)viewer);
+}
+
 
 
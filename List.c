@@ -5,6 +5,31 @@
 #include "Memory.h"
 #include "Unsigned.h"
 
+/// @brief Grows the item storage of *list* to hold *limit* items.
+/// @param list to grow.
+/// @param limit is the new item limit.
+///
+/// *List__limit_set*() will grow the item storage of *list* to hold
+/// *limit* items.  The first growth out of the inline buffer copies the
+/// items into freshly allocated heap storage; heap backed storage is
+/// simply resized.
+
+static void List__limit_set(List list, Unsigned limit) {
+    Memory *items = list->items;
+    if (items == list->inline_items) {
+	items = (Memory *)Memory__allocate(limit * sizeof(Memory));
+	Unsigned size = list->size;
+	for (Unsigned index = 0; index < size; index++) {
+	    items[index] = list->inline_items[index];
+	}
+    } else {
+	items =
+	  (Memory *)Memory__reallocate((Memory)items, limit * sizeof(Memory));
+    }
+    list->limit = limit;
+    list->items = items;
+}
+
 /// @brief Append *item* to the end of *list*.
 /// @param list to append to.
 /// @param itme to append to *list*
@@ -12,17 +37,11 @@
 /// *List__append*() will append *item* to the end of *list*.
 
 void List__append(List list, Memory item) {
-    Memory *items = list->items;
     Unsigned size = list->size;
-    Unsigned limit = list->limit;
-    if (size >= limit) {
-	limit <<= 1;
-	items =
-	  (Memory *)Memory__reallocate((Memory)items, limit * sizeof(Memory));
-	list->limit = limit;
-	list->items = items;
+    if (size >= list->limit) {
+	List__limit_set(list, list->limit << 1);
     }
-    items[size] = item;
+    list->items[size] = item;
     list->size = size + 1;
 }
 
@@ -55,13 +74,33 @@ Memory List__fetch(List list, Unsigned index) {
 
 /// @brief Return a new empty *List* object.
 ///
-/// *List__new*() will return a new empty *List* object.
+/// *List__new*() will return a new empty *List* object.  The first
+/// *LIST__INLINE_LIMIT* items live in the inline buffer, so no heap
+/// storage is touched until the list grows past that.
 
 List List__new(void) {
+    return List__new_with_capacity(0);
+}
+
+/// @brief Return a new empty *List* object that can hold *capacity*
+/// items without resizing.
+/// @param capacity is the number of items to make room for up front.
+/// @returns the new empty *List* object.
+///
+/// *List__new_with_capacity*() will return a new empty *List* object
+/// with room for *capacity* items.  When *capacity* fits in the inline
+/// buffer, no heap storage is allocated for the items.
+
+List List__new_with_capacity(Unsigned capacity) {
     List list = Memory__new(List);
-    list->items = (Memory *)Memory__allocate(sizeof(Memory));
     list->size = 0;
-    list->limit = 1;
+    if (capacity <= LIST__INLINE_LIMIT) {
+	list->items = list->inline_items;
+	list->limit = LIST__INLINE_LIMIT;
+    } else {
+	list->items = (Memory *)Memory__allocate(capacity * sizeof(Memory));
+	list->limit = capacity;
+    }
     return list;
 }
 
@@ -80,6 +119,24 @@ Memory List__pop(List list) {
     return list->items[size];
 }
 
+/// @brief Make sure *list* can hold *capacity* items without resizing.
+/// @param list to reserve room in.
+/// @param capacity is the number of items to make room for.
+///
+/// *List__reserve*() will grow the item storage of *list* (if needed)
+/// so that it can hold *capacity* items without any further resizing.
+/// The size of *list* is unchanged.
+
+void List__reserve(List list, Unsigned capacity) {
+    Unsigned limit = list->limit;
+    if (capacity > limit) {
+	while (limit < capacity) {
+	    limit <<= 1;
+	}
+	List__limit_set(list, limit);
+    }
+}
+
 /// @brief Return the the *size* of *list.
 /// @param list to return size of.
 /// @returns the size of *list.
@@ -90,112 +147,181 @@ Unsigned List__size(List list) {
     return list->size;
 }
 
-/// @brief Sort *list* using *compare_routine* to compare elements.
-/// @param list to sort.
-/// @param compare_routine is a comparison routine that is called each
-///        time to values in *list* need to be compared.
-///
-/// This routine will sort the contents of *list* using *compare_routine*
-/// to compare values in *list*.  This algorithm takes O(N log N) time
-/// to execute.
+// Runs at or below this size are finished off with insertion sort:
+#define LIST__SORT_SMALL 16
 
-void List__sort(List list, List__Compare__Routine compare_routine) {
-    Unsigned size = list->size;
-    Unsigned power = 0;
-    Unsigned temp = 1;
-    while (temp < size) {
-	power++;
-	temp <<= 1;
+/// @brief Insertion sort *items*.
+/// @param items to sort.
+/// @param size is the number of items.
+/// @param compare_routine is used to compare two items.
+
+static void List__insertion_sort(Memory *items, Unsigned size,
+  List__Compare__Routine compare_routine) {
+    for (Unsigned index = 1; index < size; index++) {
+	Memory item = items[index];
+	Unsigned to = index;
+	while (to > 0 && compare_routine(items[to - 1], item) > 0) {
+	    items[to] = items[to - 1];
+	    to--;
+	}
+	items[to] = item;
     }
+}
+
+/// @brief Restore the max-heap property from *root* downward.
+/// @param items is the heap storage.
+/// @param root is the index to sift down from.
+/// @param size is the number of items in the heap.
+/// @param compare_routine is used to compare two items.
 
-    // We need a temporary area, so stash them on the end of *list*:
-    Unsigned index = 0;
-    while (index < size) {
-	Memory mem = list->items[index];
-	(void)List__append(list, mem);
-	index++;
+static void List__sift_down(Memory *items, Unsigned root, Unsigned size,
+  List__Compare__Routine compare_routine) {
+    while (1) {
+	Unsigned child = 2 * root + 1;
+	if (child >= size) {
+	    break;
+	}
+	if (child + 1 < size &&
+	  compare_routine(items[child], items[child + 1]) < 0) {
+	    child++;
+	}
+	if (compare_routine(items[root], items[child]) >= 0) {
+	    break;
+	}
+	Memory temporary = items[root];
+	items[root] = items[child];
+	items[child] = temporary;
+	root = child;
     }
+}
 
-    // Figure out where to start sorting:
-    Unsigned mem1 = 0;
-    Unsigned mem2 = 0;
-    if ((power & 1) == 1) {
-	mem1 = size;
-	mem2 = 0;
-    } else {
-	mem1 = 0;
-	mem2 = size;
+/// @brief Heap sort *items*.
+/// @param items to sort.
+/// @param size is the number of items.
+/// @param compare_routine is used to compare two items.
+///
+/// *List__heap_sort*() is the O(N log N) worst case fallback used by
+/// *List__introsort*() when quick sort partitioning goes badly.
+
+static void List__heap_sort(Memory *items, Unsigned size,
+  List__Compare__Routine compare_routine) {
+    for (Unsigned start = size / 2; start > 0; start--) {
+	List__sift_down(items, start - 1, size, compare_routine);
+    }
+    for (Unsigned end = size; end > 1; end--) {
+	Memory temporary = items[0];
+	items[0] = items[end - 1];
+	items[end - 1] = temporary;
+	List__sift_down(items, 0, end - 1, compare_routine);
     }
+}
 
-    // Now sort pairs, then quads, then octettes, etc.:
-    Unsigned step1 = 1;
-    Unsigned step2 = 2;
-    index = power;
-    while (index != 0) {
-	Unsigned index2 = mem2;
-	Unsigned index1a = mem1;
-	Unsigned index1b = mem1 + step1;
-	Unsigned offset = 0;
-	while (offset < size) {
-	    Unsigned count1a = step1;
-	    Unsigned count1b = step1;
-	    temp = size - offset;
-	    if (temp < step1) {
-		count1a = temp;
-		count1b = 0;
-	    } else {
-		temp = temp - step1;
-		if (temp < step1) {
-		    count1b = temp;
-		}
-	    }
+/// @brief Intro sort *items*.
+/// @param items to sort.
+/// @param size is the number of items.
+/// @param depth_limit is the remaining quick sort recursion budget.
+/// @param compare_routine is used to compare two items.
+///
+/// *List__introsort*() quick sorts with a median-of-three pivot,
+/// recursing only into the smaller partition, falls back to heap sort
+/// when *depth_limit* runs out, and finishes small runs with insertion
+/// sort.  Everything happens in place; no auxiliary storage is used.
 
-	    while (count1a != 0 && count1b != 0) {
-		Memory mem1a = list->items[index1a];
-		Memory mem1b = list->items[index1b];
-		if (compare_routine(mem1a, mem1b) < 0) {
-		    list->items[index2] = mem1a;
-		    index1a++;
-		    count1a--;
-		} else {
-		    list->items[index2] = mem1b;
-		    index1b++;
-		    count1b--;
-		}
-		index2++;
-	    }
+static void List__introsort(Memory *items, Unsigned size,
+  Unsigned depth_limit, List__Compare__Routine compare_routine) {
+    while (size > LIST__SORT_SMALL) {
+	if (depth_limit == 0) {
+	    List__heap_sort(items, size, compare_routine);
+	    return;
+	}
+	depth_limit--;
+
+	// Order first/middle/last so that the ends act as partition
+	// sentinels and the median lands in the middle as the pivot:
+	Unsigned middle = size >> 1;
+	Memory temporary;
+	if (compare_routine(items[middle], items[0]) < 0) {
+	    temporary = items[0];
+	    items[0] = items[middle];
+	    items[middle] = temporary;
+	}
+	if (compare_routine(items[size - 1], items[0]) < 0) {
+	    temporary = items[0];
+	    items[0] = items[size - 1];
+	    items[size - 1] = temporary;
+	}
+	if (compare_routine(items[size - 1], items[middle]) < 0) {
+	    temporary = items[middle];
+	    items[middle] = items[size - 1];
+	    items[size - 1] = temporary;
+	}
+	Memory pivot = items[middle];
 
-	    while (count1a != 0) {
-		list->items[index2] = list->items[index1a];
-		index1a++;
-		count1a--;
-		index2++;
-	    } while (count1b != 0) {
-		list->items[index2] = list->items[index1b];
-		index1b++;
-		count1b--;
-		index2++;
+	// Hoare partition around *pivot*:
+	Unsigned low = 0;
+	Unsigned high = size - 1;
+	while (1) {
+	    do {
+		low++;
+	    } while (compare_routine(items[low], pivot) < 0);
+	    do {
+		high--;
+	    } while (compare_routine(pivot, items[high]) < 0);
+	    if (low >= high) {
+		break;
 	    }
-	    index1a += step1;
-	    index1b += step1;
-	    offset += step2;
+	    temporary = items[low];
+	    items[low] = items[high];
+	    items[high] = temporary;
+	}
+
+	// Recurse into the smaller partition and loop on the larger:
+	Unsigned left_size = high + 1;
+	Unsigned right_size = size - left_size;
+	if (left_size < right_size) {
+	    List__introsort(items, left_size, depth_limit, compare_routine);
+	    items += left_size;
+	    size = right_size;
+	} else {
+	    List__introsort(items + left_size, right_size, depth_limit,
+	      compare_routine);
+	    size = left_size;
 	}
-	Unsigned mem_temp = mem1;
-	mem1 = mem2;
-	mem2 = mem_temp;
-	step1 <<= 1;
-	step2 <<= 1;
-	index--;
     }
+    List__insertion_sort(items, size, compare_routine);
+}
 
-    list->size = size;
- 
+/// @brief Sort *list* using *compare_routine* to compare elements.
+/// @param list to sort.
+/// @param compare_routine is a comparison routine that is called each
+///        time to values in *list* need to be compared.
+///
+/// This routine will sort the contents of *list* using *compare_routine*
+/// to compare values in *list*.  This algorithm takes O(N log N) time
+/// to execute and sorts in place, so *list* never grows.  Debug builds
+/// verify the result with a final O(N) sweep; release builds
+/// (-DFIDUCIALS__RELEASE=1) compile the sweep out.
+
+void List__sort(List list, List__Compare__Routine compare_routine) {
+    Unsigned size = list->size;
+    if (size > 1) {
+	// Allow roughly 2 * log2(*size*) levels of quick sort before
+	// the heap sort fallback kicks in:
+	Unsigned depth_limit = 0;
+	for (Unsigned temp = size; temp > 1; temp >>= 1) {
+	    depth_limit += 2;
+	}
+	List__introsort(list->items, size, depth_limit, compare_routine);
+    }
+
+#if !defined(FIDUCIALS__RELEASE)
     // Verify that we are properly sorted:
-    for (index = 1; index < size; index++) {
+    for (Unsigned index = 1; index < size; index++) {
 	Memory mem_before = list->items[index - 1];
 	Memory mem_after = list->items[index];
 	assert (compare_routine(mem_before, mem_after) <= 0);
     }
+#endif // !defined(FIDUCIALS__RELEASE)
 }
 
 /// @brief Trims *list* to be *new_size* in length.
@@ -11,7 +11,15 @@
 
 Location Location__create(
   Double x, Double y, Double bearing, Double goodness, Unsigned index) {
-    Location location = Memory__new(Location);
+    return Location__initialize(
+      Memory__new(Location), x, y, bearing, goodness, index);
+}
+
+// *Location__initialize*() fills in caller provided *location* storage
+// (e.g. from an arena or a pool) and returns it:
+
+Location Location__initialize(Location location,
+  Double x, Double y, Double bearing, Double goodness, Unsigned index) {
     location->x = x;
     location->y = y;
     location->bearing = bearing;
@@ -0,0 +1,208 @@
+// Copyright (c) 2013 by Wayne C. Gramlich.  All rights reserved.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "File.h"
+#include "Integer.h"
+#include "Logger.h"
+#include "Logical.h"
+#include "Unsigned.h"
+
+// *Logger* routines:
+//
+// The logger decouples diagnostic output from the threads that produce
+// it.  *Logger__format*() formats the message into a slot of a fixed
+// lock-free ring buffer and returns without performing any system call;
+// a background drainer thread writes the slots out in order.  This
+// keeps a slow or redirected stderr from adding latency jitter to the
+// detection frame loop.  When the logger has not been started (e.g. in
+// the small test programs), *Logger__format*() simply degenerates to a
+// synchronous *File__format*() onto *stderr*.
+
+/// @brief The number of message slots in the ring (must be a power of 2.)
+#define LOGGER__SLOTS_SIZE 256
+
+/// @brief The maximum formatted message size; longer messages truncate.
+#define LOGGER__TEXT_SIZE 232
+
+/// @brief *Logger_Slot__Struct* is one message slot of the ring buffer.
+/// The *sequence* field implements the usual bounded queue protocol:
+/// a slot is free for producer {position} when *sequence* == {position}
+/// and ready for the drainer when *sequence* == {position} + 1.
+typedef struct Logger_Slot__Struct {
+    Unsigned level;
+    atomic_uint sequence;
+    char text[LOGGER__TEXT_SIZE];
+} Logger_Slot;
+
+// The logger is a per process singleton:
+
+static atomic_uint Logger__dropped;
+static File Logger__file = (File)0;
+static Unsigned Logger__head = 0;
+static Unsigned Logger__level = LOGGER__LEVEL_DEBUG;
+static Logical Logger__running = (Logical)0;
+static volatile Logical Logger__shutdown = (Logical)0;
+static Logger_Slot Logger__slots[LOGGER__SLOTS_SIZE];
+static atomic_uint Logger__tail;
+static pthread_t Logger__thread;
+
+// *Logger__drain*() is the drainer thread entry point.  It writes out
+// ready slots in sequence order and sleeps briefly when the ring is
+// empty.  It is the only thread that touches *Logger__file*:
+
+static void *Logger__drain(void *memory) {
+    while (1) {
+	Logical drained = (Logical)0;
+	while (1) {
+	    Logger_Slot *slot =
+	      &Logger__slots[Logger__head & (LOGGER__SLOTS_SIZE - 1)];
+	    Unsigned sequence =
+	      atomic_load_explicit(&slot->sequence, memory_order_acquire);
+	    if ((Integer)(sequence - (Logger__head + 1)) < 0) {
+		// The next slot is not ready yet:
+		break;
+	    }
+	    fputs(slot->text, Logger__file);
+
+	    // Recycle the slot for the producer one lap ahead:
+	    atomic_store_explicit(&slot->sequence,
+	      Logger__head + LOGGER__SLOTS_SIZE, memory_order_release);
+	    Logger__head += 1;
+	    drained = (Logical)1;
+	}
+	if (drained) {
+	    fflush(Logger__file);
+	} else {
+	    if (Logger__shutdown) {
+		break;
+	    }
+	    struct timespec pause = {0, 1000000};
+	    nanosleep(&pause, (struct timespec *)0);
+	}
+    }
+    return (void *)0;
+}
+
+/// @brief Formats and logs a message at severity *level*.
+/// @param level is one of the LOGGER__LEVEL_ constants.
+/// @param format is a printf style format string.
+///
+/// *Logger__format*() will format the remaining arguments using
+/// *format* and log the result.  Messages below the current severity
+/// threshold are discarded before any formatting occurs.  When the
+/// logger is running the message goes into the ring buffer and this
+/// routine never blocks on output; if the ring is full the message is
+/// dropped (and counted) rather than stalling the caller.  When the
+/// logger is not running the message is written synchronously to
+/// *stderr*.
+
+void Logger__format(Unsigned level, const char * format, ...) {
+    if (level < Logger__level) {
+	return;
+    }
+    va_list variadic_arguments;
+    va_start(variadic_arguments, format);
+    if (!Logger__running) {
+	vfprintf(stderr, format, variadic_arguments);
+	va_end(variadic_arguments);
+	return;
+    }
+
+    // Claim a slot using the bounded queue protocol.  Several threads
+    // can be producing at once, so the claim is a compare and swap on
+    // *Logger__tail*:
+    Logger_Slot *slot = (Logger_Slot *)0;
+    Unsigned position =
+      atomic_load_explicit(&Logger__tail, memory_order_relaxed);
+    while (1) {
+	Logger_Slot *try_slot =
+	  &Logger__slots[position & (LOGGER__SLOTS_SIZE - 1)];
+	Unsigned sequence =
+	  atomic_load_explicit(&try_slot->sequence, memory_order_acquire);
+	Integer difference = (Integer)(sequence - position);
+	if (difference == 0) {
+	    if (atomic_compare_exchange_weak_explicit(&Logger__tail,
+	      &position, position + 1,
+	      memory_order_relaxed, memory_order_relaxed)) {
+		slot = try_slot;
+		break;
+	    }
+	} else if (difference < 0) {
+	    // The ring is full; drop the message rather than block:
+	    atomic_fetch_add(&Logger__dropped, 1);
+	    va_end(variadic_arguments);
+	    return;
+	} else {
+	    position =
+	      atomic_load_explicit(&Logger__tail, memory_order_relaxed);
+	}
+    }
+
+    // Format into the slot and publish it to the drainer:
+    slot->level = level;
+    vsnprintf(slot->text, LOGGER__TEXT_SIZE, format, variadic_arguments);
+    va_end(variadic_arguments);
+    atomic_store_explicit(&slot->sequence, position + 1,
+      memory_order_release);
+}
+
+/// @brief Sets the minimum severity that is logged.
+/// @param level is one of the LOGGER__LEVEL_ constants.
+///
+/// *Logger__level_set*() will discard subsequent messages below
+/// *level*.  The default threshold is LOGGER__LEVEL_DEBUG (log
+/// everything.)
+
+void Logger__level_set(Unsigned level) {
+    Logger__level = level;
+}
+
+/// @brief Starts asynchronous logging to *file*.
+/// @param file to drain log messages to.
+///
+/// *Logger__start*() will initialize the ring buffer and start the
+/// background drainer thread.  From this point on *Logger__format*()
+/// never blocks on *file*.
+
+void Logger__start(File file) {
+    assert (!Logger__running);
+    Logger__file = file;
+    Logger__head = 0;
+    Logger__shutdown = (Logical)0;
+    atomic_init(&Logger__dropped, 0);
+    atomic_init(&Logger__tail, 0);
+    for (Unsigned index = 0; index < LOGGER__SLOTS_SIZE; index++) {
+	atomic_init(&Logger__slots[index].sequence, index);
+    }
+    Logger__running = (Logical)1;
+    assert (pthread_create(&Logger__thread,
+      (pthread_attr_t *)0, Logger__drain, (void *)0) == 0);
+}
+
+/// @brief Stops asynchronous logging.
+///
+/// *Logger__stop*() will drain any remaining messages, stop the
+/// drainer thread, and revert *Logger__format*() to synchronous
+/// *stderr* output.  The number of messages dropped due to a full
+/// ring (if any) is reported on the way out.
+
+void Logger__stop(void) {
+    assert (Logger__running);
+    Logger__shutdown = (Logical)1;
+    assert (pthread_join(Logger__thread, (void **)0) == 0);
+    Logger__running = (Logical)0;
+    Unsigned dropped = atomic_load(&Logger__dropped);
+    if (dropped != 0) {
+	File__format(Logger__file,
+	  "Logger dropped %d message(s) due to a full ring\n", dropped);
+    }
+    fflush(Logger__file);
+}
@@ -9,15 +9,26 @@
 
 typedef struct Map__Struct *Map_Doxygen_Fake_Out;
 
+// Expose open/fstat/mmap/munmap/close for the binary snapshot code
+// (must come before the first #include):
+#define _POSIX_C_SOURCE 200809L
+
 #include <assert.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include "Arc.h"
+#include "CRC.h"
 #include "CV.h"
 #include "Camera_Tag.h"
 #include "Integer.h"
 #include "File.h"
 #include "List.h"
 #include "Location.h"
+#include "Logger.h"
 #include "Map.h"
 #include "Tag.h"
 #include "Table.h"
@@ -25,6 +36,9 @@ typedef struct Map__Struct *Map_Doxygen_Fake_Out;
 
 // *Map* routines:
 
+static void Map__journal_record(Map map, Arc arc);
+static void Map__share_refresh(Map map);
+
 /// @brief Appends *arc* to *map*.
 /// @param map to append to.
 /// @param arc to append
@@ -34,6 +48,23 @@ typedef struct Map__Struct *Map_Doxygen_Fake_Out;
 void Map__arc_append(Map map, Arc arc) {
     List__append(map->all_arcs, arc);
     map->is_changed = (Logical)1;
+    Map__checksum_arc(map, arc);
+    Map__journal_record(map, arc);
+}
+
+/// @brief Records that the geometry of an existing *arc* was refined.
+/// @param map that contains *arc*.
+/// @param arc whose distance/twist/goodness changed.
+///
+/// *Map__arc_changed*() queues *arc* for the incremental propagation
+/// path of *Map__update*().  Unlike *Map__arc_append*(), it does not
+/// set *is_changed*, so a refined arc re-propagates only its own
+/// spanning subtree instead of triggering a full map rebuild.
+
+void Map__arc_changed(Map map, Arc arc) {
+    List__append(map->changed_arcs, (Memory)arc);
+    Map__checksum_arc(map, arc);
+    Map__journal_record(map, arc);
 }
 
 /// @brief Returns the *Arc* that contains *from_tag* and *to_tag*.
@@ -53,18 +84,25 @@ Arc Map__arc_lookup(Map map, Tag from_tag, Tag to_tag) {
 	to_tag = temporary_tag;
     }
 
-    // See whether or not an *Arc* with these two tags preexists:
-    Arc temporary_arc = map->temporary_arc;
-    temporary_arc->from_tag = from_tag;
-    temporary_arc->to_tag = to_tag;
-    Table /* <Arc, Arc> */ arcs_table = map->arcs_table;
-    Arc arc = (Arc)Table__lookup(arcs_table, (Memory)temporary_arc);
-    if (arc == (Arc)0) {
-	// No preexisting *Arc*; create one:
-        arc = Arc__create(from_tag, 0.0, 0.0, to_tag, 0.0, 123456789.0);
-	Table__insert(arcs_table, (Memory)arc, (Memory)arc);
+    // See whether or not an *Arc* with these two tags preexists.  Every
+    // *Arc* is already on the *arcs* list of both of its tags (see
+    // *Arc__create*()), so a short scan of the *from_tag* adjacency
+    // replaces the old global hash probe.  Tags only ever have a
+    // handful of neighbors, and during the camera tag pair sweep the
+    // *from_tag* adjacency stays hot in the cache across the whole
+    // inner loop:
+    List /* <Arc> */ from_arcs = from_tag->arcs;
+    Unsigned from_arcs_size = List__size(from_arcs);
+    for (Unsigned index = 0; index < from_arcs_size; index++) {
+	Arc arc = (Arc)List__fetch(from_arcs, index);
+	if (arc->from_tag == from_tag && arc->to_tag == to_tag) {
+	    return arc;
+	}
     }
-    return arc;
+
+    // No preexisting *Arc*; create one (which appends it to the
+    // adjacency lists of both tags):
+    return Arc__create(from_tag, 0.0, 0.0, to_tag, 0.0, 123456789.0);
 }
 
 /// @brief Makes sure the *Arc* connecting *from* to *to* is up to date.
@@ -82,52 +120,52 @@ Unsigned Map__arc_update(
     // Get the *width* and *height*:
     Integer rows = CV_Image__height_get(image);
     Integer columns = CV_Image__width_get(image);
-    Double height = (Double)rows;
-    Double width = (Double)columns;
+    Fiducials_Real height = (Double)rows;
+    Fiducials_Real width = (Double)columns;
 
     // Compute some constants:
-    Double half_width = width / 2.0;
-    Double half_height = height / 2.0;
-    Double pi = 3.14159265358979323846264;
-    Double r2d = 180.0 / pi;
+    Fiducials_Real half_width = width / 2.0;
+    Fiducials_Real half_height = height / 2.0;
+    Fiducials_Real pi = 3.14159265358979323846264;
+    Fiducials_Real r2d = 180.0 / pi;
 
     // Extract some field values from *camera_from*:
     Tag from_tag = camera_from->tag;
-    Double camera_from_twist = camera_from->twist;
-    Double camera_from_x = camera_from->x;
-    Double camera_from_y = camera_from->y;
+    Fiducials_Real camera_from_twist = camera_from->twist;
+    Fiducials_Real camera_from_x = camera_from->x;
+    Fiducials_Real camera_from_y = camera_from->y;
 
     // Extract some values from *from_tag*:
     Tag to_tag = camera_to->tag;
-    Double camera_to_twist = camera_to->twist;
-    Double camera_to_x = camera_to->x;
-    Double camera_to_y = camera_to->y;
+    Fiducials_Real camera_to_twist = camera_to->twist;
+    Fiducials_Real camera_to_x = camera_to->x;
+    Fiducials_Real camera_to_y = camera_to->y;
 
     // Find associated *Arc* that contains *from_tag* and *to_tag*:
     Arc arc = Map__arc_lookup(map, from_tag, to_tag);
 
     // Compute the polar distance (in pixels) and angle from the camera
     // center to the *from_tag* center:
-    Double camera_from_dx = camera_from->x - half_width;
-    Double camera_from_dy = camera_from->y - half_height;
-    Double camera_from_polar_distance = Double__square_root(
+    Fiducials_Real camera_from_dx = camera_from->x - half_width;
+    Fiducials_Real camera_from_dy = camera_from->y - half_height;
+    Fiducials_Real camera_from_polar_distance = Double__square_root(
       camera_from_dx * camera_from_dx + camera_from_dy * camera_from_dy);
-    Double camera_from_polar_angle =
+    Fiducials_Real camera_from_polar_angle =
       Double__arc_tangent2(camera_from_dy, camera_from_dx);
 
     // Compute the polar_distance (in pixels) and angle from the camera
     // center to the *to_tag* center:
-    Double camera_to_dx = camera_to_x - half_width;
-    Double camera_to_dy = camera_to_y - half_height;
-    Double camera_to_polar_distance = Double__square_root(
+    Fiducials_Real camera_to_dx = camera_to_x - half_width;
+    Fiducials_Real camera_to_dy = camera_to_y - half_height;
+    Fiducials_Real camera_to_polar_distance = Double__square_root(
      camera_to_dx * camera_to_dx + camera_to_dy * camera_to_dy);
-    Double camera_to_polar_angle =
+    Fiducials_Real camera_to_polar_angle =
       Double__arc_tangent2(camera_to_dy, camera_to_dx);
 
     // To minimize camera distortion effects, we want to use images where
     // *from* and *to* are about equidistant from the image center.  Thus,
     // we want to minimum the absolute value of the distance difference:
-    Double goodness =
+    Fiducials_Real goodness =
       Double__absolute(camera_from_polar_distance - camera_to_polar_distance);
 
     // Now see if the new *goodness* is better than the previous one:
@@ -140,35 +178,35 @@ Unsigned Map__arc_update(
 
 	// Get two *distance_from_pixel* values which may not be
 	// the same because the fiducials are at different heights:
-        Double from_distance_per_pixel = from_tag->distance_per_pixel;
-        Double to_distance_per_pixel = to_tag->distance_per_pixel;
+        Fiducials_Real from_distance_per_pixel = from_tag->distance_per_pixel;
+        Fiducials_Real to_distance_per_pixel = to_tag->distance_per_pixel;
 
 	// Now compute floor to/from X/Y's that coorrespond to the (X,Y)
 	// projection of each tag center onto the floor as if the camera
 	// is located at the floor origin:
-	Double from_floor_x = from_distance_per_pixel *
+	Fiducials_Real from_floor_x = from_distance_per_pixel *
 	  camera_from_polar_distance * Double__cosine(camera_from_polar_angle);
-	Double from_floor_y = from_distance_per_pixel *
+	Fiducials_Real from_floor_y = from_distance_per_pixel *
 	  camera_from_polar_distance * Double__sine(camera_from_polar_angle);
-	Double to_floor_x = to_distance_per_pixel *
+	Fiducials_Real to_floor_x = to_distance_per_pixel *
 	  camera_to_polar_distance * Double__cosine(camera_to_polar_angle);
-	Double to_floor_y = to_distance_per_pixel *
+	Fiducials_Real to_floor_y = to_distance_per_pixel *
 	  camera_to_polar_distance * Double__sine(camera_to_polar_angle);
 
 	// Now we can compute the floor distance between the two two
 	// projected points:
-	Double floor_dx = from_floor_x - to_floor_x;
-	Double floor_dy = from_floor_y - to_floor_y;
-	Double floor_distance =
+	Fiducials_Real floor_dx = from_floor_x - to_floor_x;
+	Fiducials_Real floor_dy = from_floor_y - to_floor_y;
+	Fiducials_Real floor_distance =
 	  Double__square_root(floor_dx * floor_dx + floor_dy * floor_dy);
 
 	// Compute *angle* to line segment connecting both tags:
-	Double camera_dx = camera_to_x - camera_from_x;
-	Double camera_dy = camera_to_y - camera_from_y;
- 	Double arc_angle = Double__arc_tangent2(camera_dy, camera_dx);
-	Double from_twist =
+	Fiducials_Real camera_dx = camera_to_x - camera_from_x;
+	Fiducials_Real camera_dy = camera_to_y - camera_from_y;
+ 	Fiducials_Real arc_angle = Double__arc_tangent2(camera_dy, camera_dx);
+	Fiducials_Real from_twist =
 	  Double__angle_normalize(camera_from_twist - arc_angle);
-	Double to_twist =
+	Fiducials_Real to_twist =
 	  Double__angle_normalize(camera_to_twist + pi - arc_angle);
 
 	// OLD: Compute the distance between *origin* and *to*:
@@ -186,14 +224,370 @@ Unsigned Map__arc_update(
 	//  "Map__arc_update: arc_angle=%.2f from_twist=%.2f to_twist=%.2f\n",
 	//  arc_angle * r2d, from_twist * r2d, to_twist * r2d);
 
-	// Finally, upate *arc*:
+	// Finally, upate *arc* and queue it for incremental propagation:
 	Arc__update(arc, from_twist, floor_distance, to_twist, goodness);
+	Map__arc_changed(map, arc);
 
 	changed = 1;
     }
     return changed;
 }
 
+/// @brief The largest batch the flat arrays in *Map__arc_updates*()
+/// can hold; larger camera tag lists fall back to the per pair path.
+#define MAP__ARC_BATCH_LIMIT 64
+
+/// @brief Updates the *Arc*'s for every pair of *camera_tags*.
+/// @param map to use for *Arc* updating.
+/// @param camera_tags are the *Camera_Tag*'s seen in the frame.
+/// @param image is the image that the *Camera_Tag*'s came from.
+/// @returns the number of *Arc*'s updated.
+///
+/// *Map__arc_updates*() runs the same computation as calling
+/// *Map__arc_update*() on every pair of *camera_tags*, but batched:
+/// the per tag polar distances, polar angles, and floor projections
+/// are gathered into flat arrays and computed in simple elementwise
+/// loops (one square root / arc tangent chain per tag instead of one
+/// per pair, and in a shape the compiler can vectorize.)  The per pair
+/// work that remains is the goodness comparison plus, only when an arc
+/// actually improves, one arc tangent for the connecting angle.
+
+Unsigned Map__arc_updates(
+  Map map, List /* <Camera_Tag> */ camera_tags, CV_Image image) {
+    Unsigned camera_tags_size = List__size(camera_tags);
+    Unsigned changed = 0;
+
+    // More tags in view than the batch arrays can hold is absurd for a
+    // ceiling camera, but fall back to the per pair path just in case:
+    if (camera_tags_size > MAP__ARC_BATCH_LIMIT) {
+	for (Unsigned from_index = 0;
+	  from_index + 1 < camera_tags_size; from_index++) {
+	    Camera_Tag camera_from =
+	      (Camera_Tag)List__fetch(camera_tags, from_index);
+	    for (Unsigned to_index = from_index + 1;
+	      to_index < camera_tags_size; to_index++) {
+		Camera_Tag camera_to =
+		  (Camera_Tag)List__fetch(camera_tags, to_index);
+		changed += Map__arc_update(map, camera_from, camera_to, image);
+	    }
+	}
+	return changed;
+    }
+
+    // Compute some constants:
+    Integer rows = CV_Image__height_get(image);
+    Integer columns = CV_Image__width_get(image);
+    Fiducials_Real half_width = (Fiducials_Real)columns / 2.0;
+    Fiducials_Real half_height = (Fiducials_Real)rows / 2.0;
+    Fiducials_Real pi = 3.14159265358979323846264;
+
+    // Gather the per tag inputs into flat arrays:
+    Fiducials_Real xs[MAP__ARC_BATCH_LIMIT];
+    Fiducials_Real ys[MAP__ARC_BATCH_LIMIT];
+    Fiducials_Real twists[MAP__ARC_BATCH_LIMIT];
+    Fiducials_Real distances_per_pixel[MAP__ARC_BATCH_LIMIT];
+    for (Unsigned index = 0; index < camera_tags_size; index++) {
+	Camera_Tag camera_tag = (Camera_Tag)List__fetch(camera_tags, index);
+	xs[index] = camera_tag->x;
+	ys[index] = camera_tag->y;
+	twists[index] = camera_tag->twist;
+	distances_per_pixel[index] = camera_tag->tag->distance_per_pixel;
+    }
+
+    // Compute the polar distance (in pixels) and angle from the camera
+    // center to each tag center, for the whole batch at once:
+    Fiducials_Real polar_distances[MAP__ARC_BATCH_LIMIT];
+    Fiducials_Real polar_angles[MAP__ARC_BATCH_LIMIT];
+    for (Unsigned index = 0; index < camera_tags_size; index++) {
+	Fiducials_Real dx = xs[index] - half_width;
+	Fiducials_Real dy = ys[index] - half_height;
+	polar_distances[index] = Double__square_root(dx * dx + dy * dy);
+	polar_angles[index] = Double__arc_tangent2(dy, dx);
+    }
+
+    // Project each tag center onto the floor as if the camera were at
+    // the floor origin (see *Map__arc_update*() for the discussion):
+    Fiducials_Real floor_xs[MAP__ARC_BATCH_LIMIT];
+    Fiducials_Real floor_ys[MAP__ARC_BATCH_LIMIT];
+    for (Unsigned index = 0; index < camera_tags_size; index++) {
+	Fiducials_Real reach = distances_per_pixel[index] *
+	  polar_distances[index];
+	floor_xs[index] = reach * Double__cosine(polar_angles[index]);
+	floor_ys[index] = reach * Double__sine(polar_angles[index]);
+    }
+
+    // Now apply the arc update decisions serially over the pairs:
+    for (Unsigned from_index = 0;
+      from_index + 1 < camera_tags_size; from_index++) {
+	Camera_Tag camera_from =
+	  (Camera_Tag)List__fetch(camera_tags, from_index);
+	Tag from_tag = camera_from->tag;
+	for (Unsigned to_index = from_index + 1;
+	  to_index < camera_tags_size; to_index++) {
+	    Camera_Tag camera_to =
+	      (Camera_Tag)List__fetch(camera_tags, to_index);
+	    Tag to_tag = camera_to->tag;
+
+	    // See whether this frame beats the best previous *goodness*:
+	    Arc arc = Map__arc_lookup(map, from_tag, to_tag);
+	    Fiducials_Real goodness = Double__absolute(
+	      polar_distances[from_index] - polar_distances[to_index]);
+	    if (goodness < arc->goodness) {
+		// Floor distance between the two projected points:
+		Fiducials_Real floor_dx =
+		  floor_xs[from_index] - floor_xs[to_index];
+		Fiducials_Real floor_dy =
+		  floor_ys[from_index] - floor_ys[to_index];
+		Fiducials_Real floor_distance = Double__square_root(
+		  floor_dx * floor_dx + floor_dy * floor_dy);
+
+		// Compute the twists relative to the connecting segment:
+		Fiducials_Real camera_dx = xs[to_index] - xs[from_index];
+		Fiducials_Real camera_dy = ys[to_index] - ys[from_index];
+		Fiducials_Real arc_angle =
+		  Double__arc_tangent2(camera_dy, camera_dx);
+		Fiducials_Real from_twist =
+		  Double__angle_normalize(twists[from_index] - arc_angle);
+		Fiducials_Real to_twist =
+		  Double__angle_normalize(twists[to_index] + pi - arc_angle);
+
+		// Finally, update *arc* and queue it for incremental
+		// propagation:
+		Arc__update(arc, from_twist, floor_distance, to_twist,
+		  goodness);
+		Map__arc_changed(map, arc);
+		changed += 1;
+	    }
+	}
+    }
+    return changed;
+}
+
+// Binary snapshot format (*Map__binary_save*()/*Map__binary_restore*()):
+// one fixed layout header followed by all of the tag records and then
+// all of the arc records.  Angles are stored in radians and everything
+// is written in host byte order; the magic and version in the header
+// catch foreign or stale snapshot files.  The record layouts below must
+// never change without bumping MAP__BINARY_VERSION.
+
+/// @brief Magic number at the front of a binary map snapshot ("FIDM").
+#define MAP__BINARY_MAGIC 0x4649444d
+
+/// @brief Version number of the binary map snapshot layout.
+#define MAP__BINARY_VERSION 2
+
+typedef struct Map_Binary_Header__Struct *Map_Binary_Header;
+
+/// @brief The fixed layout snapshot file header.  *crc* is the 16-bit
+/// CCITT CRC of every record byte after the header, so a truncated or
+/// corrupted snapshot is caught before it is trusted.
+struct Map_Binary_Header__Struct {
+    Unsigned magic;
+    Unsigned version;
+    Unsigned tags_size;
+    Unsigned arcs_size;
+    Unsigned crc;
+};
+
+/// @brief Restores a *Map* from the binary snapshot at *file_name*.
+/// @param file_name is the snapshot to restore from.
+/// @returns the restored *Map*.
+///
+/// *Map__binary_restore*() will map the snapshot file into memory
+/// read-only and rebuild the *Map* in a single pass over the fixed
+/// layout records, which is much faster than parsing the XML-ish
+/// format character by character.  Use *Map__restore*() for files in
+/// the interchange format.
+
+Map Map__binary_restore(const char * file_name) {
+    // Map the whole snapshot into memory read-only:
+    int fd = open(file_name, O_RDONLY);
+    assert (fd >= 0);
+    struct stat status;
+    assert (fstat(fd, &status) == 0);
+    Unsigned bytes = (Unsigned)status.st_size;
+    char *data =
+      (char *)mmap((void *)0, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    assert (data != (char *)MAP_FAILED);
+
+    // Validate the header and the file size:
+    Map_Binary_Header header = (Map_Binary_Header)data;
+    assert (bytes >= sizeof(*header));
+    assert (header->magic == MAP__BINARY_MAGIC);
+    assert (header->version == MAP__BINARY_VERSION);
+    Unsigned tags_size = header->tags_size;
+    Unsigned arcs_size = header->arcs_size;
+    assert (bytes == sizeof(*header) +
+      tags_size * sizeof(struct Map_Binary_Tag__Struct) +
+      arcs_size * sizeof(struct Map_Binary_Arc__Struct));
+
+    // Verify the record CRC in one slice-by-8 pass over the payload:
+    assert (CRC__finish(CRC__update(CRC__begin(),
+      (Memory)(data + sizeof(*header)),
+      bytes - sizeof(*header))) == header->crc);
+
+    // Rebuild the map in one pass over the tag and arc records:
+    Map map = Map__new((void *)0, Map__tag_announce);
+    Map_Binary_Tag binary_tags = (Map_Binary_Tag)(data + sizeof(*header));
+    for (Unsigned index = 0; index < tags_size; index++) {
+	Map_Binary_Tag binary_tag = &binary_tags[index];
+	Tag tag = Map__tag_lookup(map, binary_tag->id);
+	Tag__initialize(tag, binary_tag->twist, binary_tag->x,
+	  binary_tag->y, binary_tag->diagonal, map->visit);
+	tag->hop_count = binary_tag->hop_count;
+    }
+    Map_Binary_Arc binary_arcs = (Map_Binary_Arc)&binary_tags[tags_size];
+    List__reserve(map->all_arcs, arcs_size);
+    for (Unsigned index = 0; index < arcs_size; index++) {
+	Map_Binary_Arc binary_arc = &binary_arcs[index];
+	Tag from_tag = Map__tag_lookup(map, binary_arc->from_tag_id);
+	Tag to_tag = Map__tag_lookup(map, binary_arc->to_tag_id);
+	Arc arc = Arc__create(from_tag, binary_arc->from_twist,
+	  binary_arc->distance, to_tag, binary_arc->to_twist,
+	  binary_arc->goodness);
+	arc->in_tree = (Logical)binary_arc->in_tree;
+	Map__checksum_arc(map, arc);
+    }
+
+    // Release the mapping and return:
+    assert (munmap((void *)data, bytes) == 0);
+    assert (close(fd) == 0);
+    return map;
+}
+
+/// @brief Saves *map* as a binary snapshot to *file_name*.
+/// @param map to save.
+/// @param file_name to save to.
+///
+/// *Map__binary_save*() will write *map* to *file_name* in the fixed
+/// layout binary snapshot format.  The tags and arcs are sorted first,
+/// so snapshots of equal maps are byte for byte identical.
+
+void Map__binary_save(Map map, const char * file_name) {
+    File out_file = File__open((String)file_name, "wb");
+    assert (out_file != (File)0);
+
+    // Sort so that snapshots of equal maps are identical:
+    Map__sort(map);
+
+    // Write the header:
+    List all_tags = map->all_tags;
+    List all_arcs = map->all_arcs;
+    struct Map_Binary_Header__Struct header;
+    header.magic = MAP__BINARY_MAGIC;
+    header.version = MAP__BINARY_VERSION;
+    header.tags_size = List__size(all_tags);
+    header.arcs_size = List__size(all_arcs);
+    header.crc = 0;
+    assert (fwrite(&header, sizeof(header), 1, out_file) == 1);
+
+    // The record CRC accumulates incrementally as the records stream
+    // out; the header is rewritten with the final value at the end:
+    Unsigned crc = CRC__begin();
+
+    // Write one fixed layout record per tag:
+    for (Unsigned index = 0; index < header.tags_size; index++) {
+	Tag tag = (Tag)List__fetch(all_tags, index);
+	struct Map_Binary_Tag__Struct binary_tag;
+	binary_tag.diagonal = tag->diagonal;
+	binary_tag.twist = tag->twist;
+	binary_tag.x = tag->x;
+	binary_tag.y = tag->y;
+	binary_tag.hop_count = tag->hop_count;
+	binary_tag.id = tag->id;
+	crc = CRC__update(crc, (Memory)&binary_tag, sizeof(binary_tag));
+	assert (fwrite(&binary_tag, sizeof(binary_tag), 1, out_file) == 1);
+    }
+
+    // Write one fixed layout record per arc:
+    for (Unsigned index = 0; index < header.arcs_size; index++) {
+	Arc arc = (Arc)List__fetch(all_arcs, index);
+	struct Map_Binary_Arc__Struct binary_arc;
+	binary_arc.distance = arc->distance;
+	binary_arc.from_twist = arc->from_twist;
+	binary_arc.goodness = arc->goodness;
+	binary_arc.to_twist = arc->to_twist;
+	binary_arc.from_tag_id = arc->from_tag->id;
+	binary_arc.to_tag_id = arc->to_tag->id;
+	binary_arc.in_tree = (Unsigned)arc->in_tree;
+	binary_arc.pad = 0;
+	crc = CRC__update(crc, (Memory)&binary_arc, sizeof(binary_arc));
+	assert (fwrite(&binary_arc, sizeof(binary_arc), 1, out_file) == 1);
+    }
+
+    // Seek back and rewrite the header with the final record CRC:
+    header.crc = CRC__finish(crc);
+    assert (fseek(out_file, 0L, SEEK_SET) == 0);
+    assert (fwrite(&header, sizeof(header), 1, out_file) == 1);
+    File__close(out_file);
+}
+
+// Incremental checksum: the map maintains an XOR of one content hash
+// per tag and per arc.  Each tag and arc remembers the contribution it
+// last folded into the checksum, so refreshing it after a mutation is
+// XOR out the old value, XOR in the new one -- O(1) regardless of map
+// size and independent of update order.  Equal checksums mean equal
+// map content, so the test harness divergence check and the "has the
+// map changed since the last save" decision become one comparison.
+
+// *Map__checksum_mix*() folds the bit pattern of *value* into
+// *checksum* FNV-1a style, 32 bits at a time.  The value is widened to
+// *Double* first so the checksum does not depend on whether
+// *Fiducials_Real* is float or double:
+
+static Unsigned Map__checksum_mix(Unsigned checksum, Double value) {
+    union {
+	Double double_value;
+	Unsigned unsigneds[2];
+    } bits;
+    bits.unsigneds[0] = 0;
+    bits.unsigneds[1] = 0;
+    bits.double_value = value;
+    checksum = (checksum ^ bits.unsigneds[0]) * 0x01000193;
+    checksum = (checksum ^ bits.unsigneds[1]) * 0x01000193;
+    return checksum;
+}
+
+/// @brief Refreshes the contribution of *arc* to the *map* checksum.
+/// @param map whose checksum to update.
+/// @param arc whose contribution to refresh.
+///
+/// *Map__checksum_arc*() recomputes the content hash of *arc*, XOR's
+/// out the contribution previously folded into the *map* checksum, and
+/// XOR's the new one in.  Call it after any mutation of the persisted
+/// *arc* fields.  Refreshing an unchanged *arc* is harmless.
+
+void Map__checksum_arc(Map map, Arc arc) {
+    Unsigned checksum = (0x811c9dc5 ^ arc->from_tag->id) * 0x01000193;
+    checksum = (checksum ^ arc->to_tag->id) * 0x01000193;
+    checksum = (checksum ^ (Unsigned)arc->in_tree) * 0x01000193;
+    checksum = Map__checksum_mix(checksum, (Double)arc->distance);
+    checksum = Map__checksum_mix(checksum, (Double)arc->from_twist);
+    checksum = Map__checksum_mix(checksum, (Double)arc->goodness);
+    checksum = Map__checksum_mix(checksum, (Double)arc->to_twist);
+    map->checksum ^= arc->checksum ^ checksum;
+    arc->checksum = checksum;
+}
+
+/// @brief Refreshes the contribution of *tag* to the *map* checksum.
+/// @param map whose checksum to update.
+/// @param tag whose contribution to refresh.
+///
+/// *Map__checksum_tag*() is the *Tag* counterpart of
+/// *Map__checksum_arc*().  *Tag__initialize*() and
+/// *Tag__update_via_arc*() call it after every pose write.
+
+void Map__checksum_tag(Map map, Tag tag) {
+    Unsigned checksum = (0x811c9dc5 ^ tag->id) * 0x01000193;
+    checksum = (checksum ^ tag->hop_count) * 0x01000193;
+    checksum = Map__checksum_mix(checksum, (Double)tag->diagonal);
+    checksum = Map__checksum_mix(checksum, (Double)tag->twist);
+    checksum = Map__checksum_mix(checksum, (Double)tag->x);
+    checksum = Map__checksum_mix(checksum, (Double)tag->y);
+    map->checksum ^= tag->checksum ^ checksum;
+    tag->checksum = checksum;
+}
+
 /// @brief Returns -1, 0, 1 depending upon the sort order of *map1* and *map2*.
 /// @param map1 is the first *Map* to compare.
 /// @param map2 is the second *Map* to compare.
@@ -202,9 +596,15 @@ Unsigned Map__arc_update(
 /// *Map__compare*() will compare *map1* to *map2* and return -1 if *map1*
 /// sorts before *map2*, 0 if they are equal, and -1 if *map1* would sort
 /// after *map2*.  Realistically, this routine is only used for testing
-/// equality.
+/// equality.  Equal incremental checksums short circuit the full walk,
+/// so the common "no divergence" answer is a single comparison.
 
-Integer Map__compare(Map map1, Map map2) {
+// *Map__compare_walk*() is the original full walk over every tag and
+// arc.  It is the authoritative answer and the debugging fallback; the
+// checksum fast path in *Map__compare*() only ever short circuits the
+// equal case:
+
+static Integer Map__compare_walk(Map map1, Map map2) {
     Integer result = 0;
 
     // First make sure all of the *Tag*'s match up:
@@ -245,6 +645,25 @@ Integer Map__compare(Map map1, Map map2) {
     return result;
 }
 
+Integer Map__compare(Map map1, Map map2) {
+    // Fast path: the checksums cover every persisted tag and arc
+    // field, so matching checksums (and sizes, to be paranoid about
+    // collisions between a tag hash and an arc hash) mean equal maps:
+    if (map1->checksum == map2->checksum &&
+      List__size(map1->all_tags) == List__size(map2->all_tags) &&
+      List__size(map1->all_arcs) == List__size(map2->all_arcs)) {
+	#if !defined(FIDUCIALS__RELEASE)
+	    // Debug builds double check against the full walk:
+	    assert (Map__compare_walk(map1, map2) == 0);
+	#endif // !defined(FIDUCIALS__RELEASE)
+	return 0;
+    }
+
+    // Differing checksums can still compare equal (the walk only
+    // orders by tag ids, not geometry), so fall back to the walk:
+    return Map__compare_walk(map1, map2);
+}
+
 /// @brief Returns the distance per pixel for *id*.
 /// @param map is the *Map* object that contains the distance per pixel table.
 /// @param id is the *Tag* identifier to look up.
@@ -259,10 +678,22 @@ Double Map__distance_per_pixel(Map map, Unsigned id) {
     Double distance_per_pixel = 0.0;
     List /* Tag_Height */ tag_heights = map->tag_heights;
     assert (tag_heights != (List)0);
-    Unsigned size = List__size(tag_heights);
-    for (Unsigned index = 0; index < size; index++) {
-	Tag_Height tag_height = (Tag_Height)List__fetch(tag_heights, index);
-	if (tag_height->first_id <= id && id <= tag_height->last_id) {
+
+    // *tag_heights* is kept sorted by its disjoint id intervals (see
+    // *Map__tag_heights_xml_read*()), so a binary search finds the
+    // interval containing *id* in O(log n).  The result is cached on
+    // each *Tag* (*Tag__create*() stashes it in *distance_per_pixel*),
+    // so the search runs once per tag, not once per detection:
+    Unsigned low = 0;
+    Unsigned high = List__size(tag_heights);
+    while (low < high) {
+	Unsigned middle = (low + high) / 2;
+	Tag_Height tag_height = (Tag_Height)List__fetch(tag_heights, middle);
+	if (id < tag_height->first_id) {
+	    high = middle;
+	} else if (id > tag_height->last_id) {
+	    low = middle + 1;
+	} else {
 	    distance_per_pixel = tag_height->distance_per_pixel;
 	    break;
 	}
@@ -270,6 +701,306 @@ Double Map__distance_per_pixel(Map map, Unsigned id) {
     return distance_per_pixel;
 }
 
+// Spatial grid index: the tags are bucketed into a uniform grid over
+// their bounding box (about one tag per cell), so "which tags are near
+// (x, y)" touches only the cells overlapping the query circle instead
+// of scanning *all_tags*.  The grid is rebuilt lazily: each query
+// compares *grid_checksum* against the incrementally maintained map
+// *checksum* and rebuilds only when the map actually changed.
+
+// *Map__grid_ensure*() rebuilds the grid if the map content changed
+// since the last rebuild (or no grid exists yet):
+
+static void Map__grid_ensure(Map map) {
+    if (map->grid_valid && map->grid_checksum == map->checksum) {
+	return;
+    }
+    List /* <Tag> */ all_tags = map->all_tags;
+    Unsigned all_tags_size = List__size(all_tags);
+
+    // Compute the bounding box of the tag centers and the largest
+    // half diagonal (*Map__svg_write*() reuses both):
+    Double half_diagonal_maximum = 0.0;
+    Double x_minimum = 0.0;
+    Double x_maximum = 0.0;
+    Double y_minimum = 0.0;
+    Double y_maximum = 0.0;
+    for (Unsigned index = 0; index < all_tags_size; index++) {
+	Tag tag = (Tag)List__fetch(all_tags, index);
+	Double x = tag->x;
+	Double y = tag->y;
+	Double half_diagonal = tag->diagonal / 2.0;
+	if (index == 0) {
+	    x_minimum = x;
+	    x_maximum = x;
+	    y_minimum = y;
+	    y_maximum = y;
+	} else {
+	    if (x < x_minimum) {
+		x_minimum = x;
+	    }
+	    if (x > x_maximum) {
+		x_maximum = x;
+	    }
+	    if (y < y_minimum) {
+		y_minimum = y;
+	    }
+	    if (y > y_maximum) {
+		y_maximum = y;
+	    }
+	}
+	if (half_diagonal > half_diagonal_maximum) {
+	    half_diagonal_maximum = half_diagonal;
+	}
+    }
+
+    // Aim for roughly one tag per cell with a square cell layout:
+    Unsigned columns = 1;
+    while (columns * columns < all_tags_size) {
+	columns += 1;
+    }
+    Unsigned rows = columns;
+    Double side = (x_maximum - x_minimum) / (Double)columns;
+    Double y_side = (y_maximum - y_minimum) / (Double)rows;
+    if (y_side > side) {
+	side = y_side;
+    }
+    if (side <= 0.0) {
+	side = 1.0;
+    }
+
+    // Grow the cell list array if needed; the cell *List* objects are
+    // reused across rebuilds to avoid allocation churn:
+    Unsigned cells_size = columns * rows;
+    if (cells_size > map->grid_cells_size) {
+	List *grid_cells =
+	  (List *)Memory__allocate(cells_size * sizeof(List));
+	for (Unsigned index = 0; index < map->grid_cells_size; index++) {
+	    grid_cells[index] = map->grid_cells[index];
+	}
+	for (Unsigned index = map->grid_cells_size;
+	  index < cells_size; index++) {
+	    grid_cells[index] = List__new(); // <Tag>
+	}
+	if (map->grid_cells != (List *)0) {
+	    Memory__free((Memory)map->grid_cells);
+	}
+	map->grid_cells = grid_cells;
+	map->grid_cells_size = cells_size;
+    }
+    for (Unsigned index = 0; index < cells_size; index++) {
+	List__trim(map->grid_cells[index], 0);
+    }
+
+    // Bucket each tag into its cell:
+    for (Unsigned index = 0; index < all_tags_size; index++) {
+	Tag tag = (Tag)List__fetch(all_tags, index);
+	Unsigned column = (Unsigned)(((Double)tag->x - x_minimum) / side);
+	Unsigned row = (Unsigned)(((Double)tag->y - y_minimum) / side);
+	if (column >= columns) {
+	    column = columns - 1;
+	}
+	if (row >= rows) {
+	    row = rows - 1;
+	}
+	List__append(map->grid_cells[row * columns + column], (Memory)tag);
+    }
+
+    map->grid_checksum = map->checksum;
+    map->grid_columns = columns;
+    map->grid_half_diagonal_maximum = half_diagonal_maximum;
+    map->grid_rows = rows;
+    map->grid_side = side;
+    map->grid_valid = (Logical)1;
+    map->grid_x_maximum = x_maximum;
+    map->grid_x_minimum = x_minimum;
+    map->grid_y_maximum = y_maximum;
+    map->grid_y_minimum = y_minimum;
+}
+
+// Journaled persistence: instead of rewriting the whole map file on
+// every periodic save, each created or refined *Arc* appends one fixed
+// layout *Map_Binary_Arc__Struct* record to an open journal file, so
+// durability cost tracks the change rate rather than the map size.
+// *Map__journal_checkpoint*() periodically folds the journal into a
+// full binary snapshot from a forked child, and
+// *Map__journal_restore*() replays any surviving journal on top of the
+// latest snapshot at boot.  Replaying a record that is already
+// reflected in the snapshot is harmless, so no record is ever lost as
+// long as the rotated journal is only unlinked after its snapshot has
+// been renamed into place.
+
+/// @brief Folds the journal of *map* into a fresh binary snapshot.
+/// @param map to checkpoint.
+/// @param snapshot_file_name is the snapshot file to (re)write.
+///
+/// *Map__journal_checkpoint*() rotates the live journal out of the way
+/// and writes *snapshot_file_name* from a forked child process, so the
+/// potentially slow save never stalls the caller.  The child writes to
+/// a temporary file, renames it over the snapshot, and only then
+/// unlinks the rotated journal.  The journal must have been opened
+/// with *Map__journal_open*().
+
+void Map__journal_checkpoint(Map map, const char * snapshot_file_name) {
+    assert (map->journal_file != (File)0);
+    String journal_file_name = map->journal_file_name;
+
+    // Reap the previous checkpoint child first (in steady state it
+    // finished long ago, so this does not block):
+    if (map->journal_checkpoint_pid != 0) {
+	int status = 0;
+	assert (waitpid((pid_t)map->journal_checkpoint_pid, &status, 0) ==
+	  (pid_t)map->journal_checkpoint_pid);
+	map->journal_checkpoint_pid = 0;
+    }
+
+    // Rotate the live journal out of the way and start a fresh one.
+    // Until the child unlinks it, the rotated file keeps every record
+    // that is not yet inside a durable snapshot:
+    File__close(map->journal_file);
+    String pending_file_name =
+      String__format("%s.pending", journal_file_name);
+    assert (rename(journal_file_name, pending_file_name) == 0);
+    map->journal_file = File__open(journal_file_name, "ab");
+    assert (map->journal_file != (File)0);
+
+    // Write the snapshot from a forked child: the child sees a
+    // copy-on-write image of the map as of this instant while the
+    // caller keeps navigating:
+    pid_t checkpoint_pid = fork();
+    assert (checkpoint_pid >= 0);
+    if (checkpoint_pid == 0) {
+	String temporary_file_name =
+	  String__format("%s.tmp", snapshot_file_name);
+	Map__binary_save(map, temporary_file_name);
+	assert (rename(temporary_file_name, snapshot_file_name) == 0);
+	assert (unlink(pending_file_name) == 0);
+	_exit(0);
+    }
+    map->journal_checkpoint_pid = (Integer)checkpoint_pid;
+    String__free(pending_file_name);
+}
+
+/// @brief Starts journaling the arc changes of *map* to *file_name*.
+/// @param map to journal.
+/// @param file_name is the journal file to append to.
+///
+/// *Map__journal_open*() opens *file_name* in append mode and starts
+/// emitting one record per created or refined *Arc*.  Open the journal
+/// only after any *Map__journal_restore*() replay has finished, so the
+/// replayed records are not appended back onto the journal.
+
+void Map__journal_open(Map map, const char * file_name) {
+    assert (map->journal_file == (File)0);
+    map->journal_file = File__open((String)file_name, "ab");
+    assert (map->journal_file != (File)0);
+    map->journal_file_name = String__format("%s", file_name);
+}
+
+/// @brief Emits one journal record for *arc* (no-op with no journal.)
+/// @param map whose journal to append to.
+/// @param arc that was created or refined.
+
+static void Map__journal_record(Map map, Arc arc) {
+    File journal_file = map->journal_file;
+    if (journal_file != (File)0) {
+	struct Map_Binary_Arc__Struct binary_arc;
+	binary_arc.distance = arc->distance;
+	binary_arc.from_twist = arc->from_twist;
+	binary_arc.goodness = arc->goodness;
+	binary_arc.to_twist = arc->to_twist;
+	binary_arc.from_tag_id = arc->from_tag->id;
+	binary_arc.to_tag_id = arc->to_tag->id;
+	binary_arc.in_tree = (Unsigned)arc->in_tree;
+	binary_arc.pad = 0;
+	assert (fwrite(&binary_arc, sizeof(binary_arc), 1,
+	  journal_file) == 1);
+	fflush(journal_file);
+    }
+}
+
+/// @brief Replays the journal records in *file_name* (if any) into *map*.
+/// @param map to replay into.
+/// @param file_name is the journal file to replay.
+///
+/// *Map__journal_replay*() applies every record of *file_name* to
+/// *map*: missing tags and arcs are created, and existing arcs take on
+/// the recorded geometry.  A missing journal file is not an error.
+/// Replay is idempotent, so records that are already reflected in the
+/// map are harmless.
+
+void Map__journal_replay(Map map, const char * file_name) {
+    File in_file = File__open((String)file_name, "rb");
+    if (in_file != (File)0) {
+	struct Map_Binary_Arc__Struct binary_arc;
+	while (fread(&binary_arc, sizeof(binary_arc), 1, in_file) == 1) {
+	    Tag from_tag = Map__tag_lookup(map, binary_arc.from_tag_id);
+	    Tag to_tag = Map__tag_lookup(map, binary_arc.to_tag_id);
+	    Arc arc = Map__arc_lookup(map, from_tag, to_tag);
+	    Arc__update(arc, binary_arc.from_twist, binary_arc.distance,
+	      binary_arc.to_twist, binary_arc.goodness);
+	    arc->in_tree = (Logical)binary_arc.in_tree;
+	    Map__checksum_arc(map, arc);
+	}
+	File__close(in_file);
+    }
+}
+
+/// @brief Restores a *Map* from a snapshot plus any surviving journals.
+/// @param snapshot_file_name is the binary snapshot (may not exist yet.)
+/// @param journal_file_name is the live journal file name.
+/// @returns the restored *Map*.
+///
+/// *Map__journal_restore*() is the boot time counterpart of journaled
+/// persistence: it restores the latest binary snapshot (or starts an
+/// empty map when none exists), then replays the rotated journal left
+/// behind by an interrupted checkpoint (if any) followed by the live
+/// journal.  Call *Map__journal_open*() afterwards to resume
+/// journaling.
+
+Map Map__journal_restore(
+  const char * snapshot_file_name, const char * journal_file_name) {
+    Map map = (Map)0;
+    if (access(snapshot_file_name, F_OK) == 0) {
+	map = Map__binary_restore(snapshot_file_name);
+    } else {
+	map = Map__new((void *)0, Map__tag_announce);
+    }
+
+    // A crash between the journal rotation and the snapshot rename can
+    // leave a ".pending" journal behind; its records are not in the
+    // snapshot yet, so replay it before the live journal:
+    String pending_file_name =
+      String__format("%s.pending", journal_file_name);
+    Map__journal_replay(map, pending_file_name);
+    String__free(pending_file_name);
+    Map__journal_replay(map, journal_file_name);
+    return map;
+}
+
+/// @brief Acquires exclusive access to *map*.
+/// @param map to lock.
+///
+/// *Map__lock*() serializes access to *map* when several detector
+/// threads share it (see *Fiducials__share*()).  Each detector holds
+/// the lock across its whole map interaction -- tag lookups, arc
+/// updates, pose reads, and *Map__update*() -- so the map only ever
+/// changes under one thread at a time.  Single camera programs pay
+/// one uncontended lock per frame.
+
+void Map__lock(Map map) {
+    assert (pthread_mutex_lock(&map->lock) == 0);
+}
+
+/// @brief Releases exclusive access to *map*.
+/// @param map to unlock.
+///
+/// *Map__unlock*() releases the lock acquired by *Map__lock*().
+
+void Map__unlock(Map map) {
+    assert (pthread_mutex_unlock(&map->lock) == 0);
+}
+
 /// @brief Returns a new *Map*.
 /// @returns a new *Map*.
 ///
@@ -281,15 +1012,54 @@ Map Map__new(
     map->all_arcs = List__new(); // <Tag>
     map->all_tags = List__new(); // <Tag>
     map->announce_object = announce_object;
-    map->arcs_table = Table__create((Table_Equal_Routine)Arc__equal,
-      (Table_Hash_Routine)Arc__hash, (Memory)0); // <Arc, Arc>
+    map->changed_arcs = List__new(); // <Arc>
+    map->checksum = 0;
+    map->grid_cells = (List *)0;
+    map->grid_cells_size = 0;
+    map->grid_checksum = 0;
+    map->grid_columns = 0;
+    map->grid_half_diagonal_maximum = 0.0;
+    map->grid_rows = 0;
+    map->grid_side = 0.0;
+    map->grid_valid = (Logical)0;
+    map->grid_x_maximum = 0.0;
+    map->grid_x_minimum = 0.0;
+    map->grid_y_maximum = 0.0;
+    map->grid_y_minimum = 0.0;
     map->is_changed = (Logical)0;
-    map->pending_arcs = List__new(); // <Tag>
+    map->journal_checkpoint_pid = 0;
+    assert (pthread_mutex_init(&map->lock, (pthread_mutexattr_t *)0) == 0);
+    map->journal_file = (File)0;
+    map->journal_file_name = (String)0;
+    map->pending_arcs = Heap__new(
+      (Heap__Compare__Routine)Arc__distance_compare); // <Arc>
+    map->propagate_tags = List__new(); // <Tag>
+    map->share_fd = -1;
+    map->share_header = (Map_Share_Header)0;
+    map->svg_x_offset = 0.0;
+    map->svg_x_scale = 0.0;
+    map->svg_y_offset = 0.0;
+    map->svg_y_scale = 0.0;
     map->tag_announce_routine = tag_announce_routine;
     map->tag_heights = List__new(); // <Tag_Height>
-    map->tags_table = Table__create((Table_Equal_Routine)Unsigned__equal,
-      (Table_Hash_Routine)Unsigned__hash, (Memory)0); // <Unsigned, Tag>
-    map->temporary_arc = Arc__new();
+    map->tags_dense =
+      (Tag *)Memory__allocate(MAP__TAGS_DENSE_LIMIT * sizeof(Tag));
+    map->tags_dense_size = MAP__TAGS_DENSE_LIMIT;
+    for (Unsigned index = 0; index < MAP__TAGS_DENSE_LIMIT; index++) {
+	map->tags_dense[index] = (Tag)0;
+    }
+    map->tags_table = Table_Unsigned__create((Memory)0); // <Unsigned, Tag>
+
+    // Full rebuilds propagate poses with one worker per core by
+    // default (see *Map__update_threads_set*()):
+    Integer processors = (Integer)sysconf(_SC_NPROCESSORS_ONLN);
+    if (processors < 1) {
+	processors = 1;
+    }
+    if (processors > MAP__UPDATE_THREADS_MAXIMUM) {
+	processors = MAP__UPDATE_THREADS_MAXIMUM;
+    }
+    map->update_threads = (Unsigned)processors;
     map->visit = 0;
     return map;
 }
@@ -304,18 +1074,96 @@ Map Map__new(
 /// encountered, a new *Tag* is created and add to the association in *map*.
 
 Tag Map__tag_lookup(Map map, Unsigned tag_id) {
-    Table tags_table /* <Unsigned, Tag> */ = map->tags_table;
-    Memory memory_tag_id = Unsigned__to_memory(tag_id);
-    Tag tag = (Tag)Table__lookup(tags_table, memory_tag_id);
+    // Fast path: ids below *tags_dense_size* are a single array load.
+    // Tags.c hands ids out densely from 0, so this is the common case:
+    if (tag_id < map->tags_dense_size) {
+	Tag tag = map->tags_dense[tag_id];
+	if (tag == (Tag)0) {
+	    tag = Tag__create(tag_id, map);
+	    map->tags_dense[tag_id] = tag;
+	    List__append(map->all_tags, tag);
+	    map->is_changed = (Logical)1;
+	    Map__checksum_tag(map, tag);
+	}
+	return tag;
+    }
+
+    // Sparse ids fall back to the *tags_table* hash:
+    Table_Unsigned tags_table /* <Unsigned, Tag> */ = map->tags_table;
+    Tag tag = (Tag)Table_Unsigned__lookup(tags_table, tag_id);
     if (tag == (Tag)0) {
 	tag = Tag__create(tag_id, map);
-	Table__insert(tags_table, memory_tag_id, (Memory)tag);
+	Table_Unsigned__insert(tags_table, tag_id, (Memory)tag);
 	List__append(map->all_tags, tag);
 	map->is_changed = (Logical)1;
+	Map__checksum_tag(map, tag);
     }
     return tag;
 }
 
+/// @brief Appends the *Tag*'s within *radius* of (*x*, *y*) to *tags*.
+/// @param map to query.
+/// @param x is the query center X coordinate.
+/// @param y is the query center Y coordinate.
+/// @param radius is the query radius.
+/// @param tags is the *List* to append the matching *Tag*'s to.
+/// @returns the number of *Tag*'s appended.
+///
+/// *Map__tags_near*() will append every *Tag* whose center lies within
+/// *radius* of (*x*, *y*) to *tags* and return how many were appended.
+/// Only the grid cells overlapping the query circle are visited, so
+/// the cost tracks the local tag density rather than the map size.
+/// The grid is rebuilt lazily when the map changed since the last
+/// query; an unchanged map pays nothing.
+
+Unsigned Map__tags_near(
+  Map map, Double x, Double y, Double radius, List /* <Tag> */ tags) {
+    Map__grid_ensure(map);
+    Unsigned count = 0;
+    if (List__size(map->all_tags) != 0) {
+	// Clamp the cell range overlapping the query circle's bounding
+	// square (the subtractions can go negative, so clamp before
+	// converting to *Unsigned*):
+	Unsigned columns = map->grid_columns;
+	Unsigned rows = map->grid_rows;
+	Double side = map->grid_side;
+	Double x_low = (x - radius - map->grid_x_minimum) / side;
+	Double x_high = (x + radius - map->grid_x_minimum) / side;
+	Double y_low = (y - radius - map->grid_y_minimum) / side;
+	Double y_high = (y + radius - map->grid_y_minimum) / side;
+	if (x_high >= 0.0 && y_high >= 0.0 &&
+	  x_low < (Double)columns && y_low < (Double)rows) {
+	    Unsigned column_low =
+	      (x_low <= 0.0) ? 0 : (Unsigned)x_low;
+	    Unsigned column_high =
+	      (x_high >= (Double)(columns - 1)) ? columns - 1 : (Unsigned)x_high;
+	    Unsigned row_low =
+	      (y_low <= 0.0) ? 0 : (Unsigned)y_low;
+	    Unsigned row_high =
+	      (y_high >= (Double)(rows - 1)) ? rows - 1 : (Unsigned)y_high;
+	    Double radius_squared = radius * radius;
+	    for (Unsigned row = row_low; row <= row_high; row++) {
+		for (Unsigned column = column_low;
+		  column <= column_high; column++) {
+		    List /* <Tag> */ cell =
+		      map->grid_cells[row * columns + column];
+		    Unsigned cell_size = List__size(cell);
+		    for (Unsigned index = 0; index < cell_size; index++) {
+			Tag tag = (Tag)List__fetch(cell, index);
+			Double dx = (Double)tag->x - x;
+			Double dy = (Double)tag->y - y;
+			if (dx * dx + dy * dy <= radius_squared) {
+			    List__append(tags, (Memory)tag);
+			    count += 1;
+			}
+		    }
+		}
+	    }
+	}
+    }
+    return count;
+}
+
 /// @brief Read a *Map* from *in_file* and returns it.
 /// @param in_file is the file to read from.
 /// @returns the *Map* object.
@@ -323,31 +1171,33 @@ Tag Map__tag_lookup(Map map, Unsigned tag_id) {
 /// *Map__read*() will read in an XML map file from *in_file* and return
 /// the resulting *Map* object.
 
-Map Map__read(File in_file) {
+Map Map__read(File_Reader in_file) {
     // Create *map* and get *tags* list:
     Map map = Map__new((void *)0, Map__tag_announce);
 
     // Read in Map XML tag '<Map Tags_Count="xx" Arcs_Count="xx">' :
-    File__tag_match(in_file, "Map");
+    File_Reader__tag_match(in_file, "Map");
     Unsigned all_tags_size =
-      (Unsigned)File__integer_attribute_read(in_file, "Tags_Count");
+      (Unsigned)File_Reader__integer_attribute_read(in_file, "Tags_Count");
     Unsigned all_arcs_size =
-      (Unsigned)File__integer_attribute_read(in_file, "Arcs_Count");
-    File__string_match(in_file, ">\n");
+      (Unsigned)File_Reader__integer_attribute_read(in_file, "Arcs_Count");
+    File_Reader__string_match(in_file, ">\n");
 
     // Read in the *all_tags_size* *Tag* objects:
     for (Unsigned index = 0; index < all_tags_size; index++) {
 	Tag tag = Tag__read(in_file, map);
     }
 
-    // Read in the *all_arcs_size* *Arc* objects:
+    // Read in the *all_arcs_size* *Arc* objects.  Each one gets
+    // *Map__arc_append*()'ed, so make room for all of them up front:
+    List__reserve(map->all_arcs, all_arcs_size);
     for (Unsigned index = 0; index < all_arcs_size; index++) {
 	Arc arc = Arc__read(in_file, map);
     }
 
     // Process the final Map XML tag "</MAP>":
-    File__tag_match(in_file, "/Map");
-    File__string_match(in_file, ">\n");
+    File_Reader__tag_match(in_file, "/Map");
+    File_Reader__string_match(in_file, ">\n");
 
     // Do some final checks:
     assert (List__size(map->all_arcs) == all_arcs_size);
@@ -364,10 +1214,10 @@ Map Map__read(File in_file) {
 /// resulting *Map* object.
 
 Map Map__restore(const char * file_name) {
-    File in_file = File__open(file_name, "r");
-    assert(in_file != (File)0);
+    File_Reader in_file = File_Reader__open((String)file_name);
+    assert(in_file != (File_Reader)0);
     Map map = Map__read(in_file);
-    File__close(in_file);
+    File_Reader__close(in_file);
     return map;
 }
 
@@ -384,6 +1234,212 @@ void Map__save(Map map, const char * file_name) {
     File__close(out_file);
 }
 
+// Shared memory publication (*Map__share_publish*() and friends): the
+// whole Tag/Arc graph is flattened into a POSIX shared memory segment
+// as pointer-free fixed layout records, so read-only consumers in
+// other processes (planner, dashboard) attach once with
+// *Map__share_attach*() instead of each holding a private copy.  The
+// publisher rewrites the records at the end of every *Map__update*()
+// that changed something, guarded by the seqlock generation counter
+// described in Map.h.
+
+/// @brief Magic number at the front of a shared map segment ("FIDS").
+#define MAP__SHARE_MAGIC 0x46494453
+
+/// @brief Version number of the shared map segment layout.
+#define MAP__SHARE_VERSION 1
+
+/// @brief Returns the total segment size for the given capacities.
+/// @param tags_capacity is the number of tag record slots.
+/// @param arcs_capacity is the number of arc record slots.
+/// @returns the segment size in bytes.
+
+static Unsigned Map__share_bytes(
+  Unsigned tags_capacity, Unsigned arcs_capacity) {
+    return sizeof(struct Map_Share_Header__Struct) +
+      tags_capacity * sizeof(struct Map_Binary_Tag__Struct) +
+      arcs_capacity * sizeof(struct Map_Binary_Arc__Struct);
+}
+
+/// @brief Returns the arc record array of *share_header*.
+/// @param share_header is the attached or published segment.
+/// @returns the first arc record.
+
+Map_Binary_Arc Map__share_arcs(Map_Share_Header share_header) {
+    Map_Binary_Tag tags = (Map_Binary_Tag)(share_header + 1);
+    return (Map_Binary_Arc)&tags[share_header->tags_capacity];
+}
+
+/// @brief Returns the tag record array of *share_header*.
+/// @param share_header is the attached or published segment.
+/// @returns the first tag record.
+
+Map_Binary_Tag Map__share_tags(Map_Share_Header share_header) {
+    return (Map_Binary_Tag)(share_header + 1);
+}
+
+/// @brief Attaches read-only to the shared map segment *share_name*.
+/// @param share_name is the segment name (e.g. "/fiducials_map".)
+/// @returns the mapped segment header.
+///
+/// *Map__share_attach*() maps an already published segment read-only
+/// and validates its magic and version.  Consumers follow the seqlock
+/// protocol documented on *Map_Share_Header__Struct*:
+///
+///     Unsigned before = atomic_load_explicit(
+///       &share_header->generation, memory_order_acquire);
+///     // ... copy the needed tag/arc records ...
+///     atomic_thread_fence(memory_order_acquire);
+///     Unsigned after = atomic_load_explicit(
+///       &share_header->generation, memory_order_relaxed);
+///     // Retry when *before* is odd or *after* != *before*.
+///
+/// The acquire load and the acquire fence pair with the publisher's
+/// release ordering in *Map__share_refresh*(), so a copy that passes
+/// the retry check is guaranteed untorn.  If the capacities in the
+/// header ever imply a larger segment than the one mapped (the
+/// publisher grew the map), detach and attach again.
+
+Map_Share_Header Map__share_attach(const char * share_name) {
+    int share_fd = shm_open(share_name, O_RDONLY, 0);
+    assert (share_fd >= 0);
+    struct stat status;
+    assert (fstat(share_fd, &status) == 0);
+    Map_Share_Header share_header = (Map_Share_Header)mmap((void *)0,
+      (Unsigned)status.st_size, PROT_READ, MAP_SHARED, share_fd, 0);
+    assert (share_header != (Map_Share_Header)MAP_FAILED);
+    assert (close(share_fd) == 0);
+    assert (share_header->magic == MAP__SHARE_MAGIC);
+    assert (share_header->version == MAP__SHARE_VERSION);
+    return share_header;
+}
+
+/// @brief Unmaps a segment attached with *Map__share_attach*().
+/// @param share_header to unmap.
+
+void Map__share_detach(Map_Share_Header share_header) {
+    Unsigned bytes = Map__share_bytes(
+      share_header->tags_capacity, share_header->arcs_capacity);
+    assert (munmap((void *)share_header, bytes) == 0);
+}
+
+/// @brief Rewrites the published records from the current map state.
+/// @param map whose segment to refresh (no-op when not publishing.)
+
+static void Map__share_refresh(Map map) {
+    Map_Share_Header share_header = map->share_header;
+    if (share_header == (Map_Share_Header)0) {
+	return;
+    }
+    List all_tags = map->all_tags;
+    List all_arcs = map->all_arcs;
+    Unsigned tags_size = List__size(all_tags);
+    Unsigned arcs_size = List__size(all_arcs);
+
+    // Grow the segment when the map has outgrown its headroom.
+    // Consumers notice the capacity change and reattach:
+    if (tags_size > share_header->tags_capacity ||
+      arcs_size > share_header->arcs_capacity) {
+	Unsigned generation = atomic_load_explicit(
+	  &share_header->generation, memory_order_relaxed);
+	Unsigned old_bytes = Map__share_bytes(
+	  share_header->tags_capacity, share_header->arcs_capacity);
+	Unsigned tags_capacity = (tags_size | 255) + 1;
+	Unsigned arcs_capacity = (arcs_size | 255) + 1;
+	Unsigned bytes = Map__share_bytes(tags_capacity, arcs_capacity);
+	assert (munmap((void *)share_header, old_bytes) == 0);
+	assert (ftruncate(map->share_fd, bytes) == 0);
+	share_header = (Map_Share_Header)mmap((void *)0, bytes,
+	  PROT_READ | PROT_WRITE, MAP_SHARED, map->share_fd, 0);
+	assert (share_header != (Map_Share_Header)MAP_FAILED);
+	share_header->magic = MAP__SHARE_MAGIC;
+	share_header->version = MAP__SHARE_VERSION;
+	atomic_store_explicit(&share_header->generation, generation,
+	  memory_order_relaxed);
+	share_header->tags_capacity = tags_capacity;
+	share_header->arcs_capacity = arcs_capacity;
+	share_header->pad = 0;
+	map->share_header = share_header;
+    }
+
+    // Seqlock write: make *generation* odd, rewrite the records, and
+    // make it even again.  The release fence keeps the record stores
+    // from being hoisted above the odd store, and the final release
+    // store keeps them from sinking below the even store, so a reader
+    // that sees the same even generation on both sides of its copy
+    // (see *Map__share_attach*()) got a consistent snapshot:
+    Unsigned generation = atomic_load_explicit(
+      &share_header->generation, memory_order_relaxed);
+    atomic_store_explicit(&share_header->generation, generation + 1,
+      memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    share_header->tags_size = tags_size;
+    share_header->arcs_size = arcs_size;
+    Map_Binary_Tag binary_tags = Map__share_tags(share_header);
+    for (Unsigned index = 0; index < tags_size; index++) {
+	Tag tag = (Tag)List__fetch(all_tags, index);
+	Map_Binary_Tag binary_tag = &binary_tags[index];
+	binary_tag->diagonal = tag->diagonal;
+	binary_tag->twist = tag->twist;
+	binary_tag->x = tag->x;
+	binary_tag->y = tag->y;
+	binary_tag->hop_count = tag->hop_count;
+	binary_tag->id = tag->id;
+    }
+    Map_Binary_Arc binary_arcs = Map__share_arcs(share_header);
+    for (Unsigned index = 0; index < arcs_size; index++) {
+	Arc arc = (Arc)List__fetch(all_arcs, index);
+	Map_Binary_Arc binary_arc = &binary_arcs[index];
+	binary_arc->distance = arc->distance;
+	binary_arc->from_twist = arc->from_twist;
+	binary_arc->goodness = arc->goodness;
+	binary_arc->to_twist = arc->to_twist;
+	binary_arc->from_tag_id = arc->from_tag->id;
+	binary_arc->to_tag_id = arc->to_tag->id;
+	binary_arc->in_tree = (Unsigned)arc->in_tree;
+	binary_arc->pad = 0;
+    }
+    atomic_store_explicit(&share_header->generation, generation + 2,
+      memory_order_release);
+}
+
+/// @brief Starts publishing *map* into the shared segment *share_name*.
+/// @param map to publish.
+/// @param share_name is the segment name (e.g. "/fiducials_map".)
+///
+/// *Map__share_publish*() creates (or reuses) the POSIX shared memory
+/// segment *share_name*, flattens the current map into it, and then
+/// keeps it current: every *Map__update*() that changed anything
+/// rewrites the records and bumps the generation counter.
+
+void Map__share_publish(Map map, const char * share_name) {
+    assert (map->share_header == (Map_Share_Header)0);
+    int share_fd = shm_open(share_name, O_CREAT | O_RDWR, 0644);
+    assert (share_fd >= 0);
+
+    // Size the segment with headroom so steady map growth does not
+    // remap on every refresh:
+    Unsigned tags_capacity = (List__size(map->all_tags) | 255) + 1;
+    Unsigned arcs_capacity = (List__size(map->all_arcs) | 255) + 1;
+    Unsigned bytes = Map__share_bytes(tags_capacity, arcs_capacity);
+    assert (ftruncate(share_fd, bytes) == 0);
+    Map_Share_Header share_header = (Map_Share_Header)mmap((void *)0,
+      bytes, PROT_READ | PROT_WRITE, MAP_SHARED, share_fd, 0);
+    assert (share_header != (Map_Share_Header)MAP_FAILED);
+    share_header->magic = MAP__SHARE_MAGIC;
+    share_header->version = MAP__SHARE_VERSION;
+    atomic_store_explicit(&share_header->generation, 0,
+      memory_order_relaxed);
+    share_header->tags_capacity = tags_capacity;
+    share_header->arcs_capacity = arcs_capacity;
+    share_header->tags_size = 0;
+    share_header->arcs_size = 0;
+    share_header->pad = 0;
+    map->share_fd = (Integer)share_fd;
+    map->share_header = share_header;
+    Map__share_refresh(map);
+}
+
 /// @brief Sort the contents of *map* to be in a consistent order.
 /// @param map to reorder.
 ///
@@ -408,11 +1464,21 @@ void Map__svg_write(Map map, const char * svg_base_name, List locations) {
     Unsigned all_tags_size = List__size(all_tags);
     Unsigned all_arcs_size = List__size(all_arcs);
 
-    // Compute the *bounding_box*:
+    // Compute the *bounding_box* from the cached grid extents instead
+    // of walking every tag.  Extending the center bounding box by the
+    // largest half diagonal bounds every tag (the box can come out a
+    // hair larger than the per tag walk, which only affects the SVG
+    // scale):
+    Map__grid_ensure(map);
     Bounding_Box bounding_box = Bounding_Box__new();
-    for (Unsigned index = 0; index < all_tags_size; index++) {
-	Tag tag = (Tag)List__fetch(all_tags, index);
-	Tag__bounding_box_update(tag, bounding_box);
+    if (all_tags_size != 0) {
+	Double half_diagonal = map->grid_half_diagonal_maximum;
+	Bounding_Box__update(bounding_box,
+	  map->grid_x_minimum - half_diagonal,
+	  map->grid_y_minimum - half_diagonal);
+	Bounding_Box__update(bounding_box,
+	  map->grid_x_maximum + half_diagonal,
+	  map->grid_y_maximum + half_diagonal);
     }
 
     // Open the Scalable Vector Graphics file:
@@ -427,10 +1493,35 @@ void Map__svg_write(Map map, const char * svg_base_name, List locations) {
     SVG__line(svg,
       0.0, bounding_box->minimum_y, 0.0, bounding_box->maximum_y, color);
 
-    // Output each *tag in *all_tags*:
+    // A scale or offset change bakes different coordinates into every
+    // fragment, so it invalidates all of the cached ones:
+    Logical scale_changed = (Logical)(
+      map->svg_x_offset != svg->x_offset ||
+      map->svg_x_scale != svg->x_scale ||
+      map->svg_y_offset != svg->y_offset ||
+      map->svg_y_scale != svg->y_scale);
+    map->svg_x_offset = svg->x_offset;
+    map->svg_x_scale = svg->x_scale;
+    map->svg_y_offset = svg->y_offset;
+    map->svg_y_scale = svg->y_scale;
+
+    // Output each *tag in *all_tags*.  Tags whose pose is unchanged
+    // since the previous render (same tag checksum, same scale) replay
+    // their cached fragment instead of reformatting every primitive:
     for (Unsigned index = 0; index < all_tags_size; index++) {
 	Tag tag = (Tag)List__fetch(all_tags, index);
-	Tag__svg_write(tag, svg);
+	if (!scale_changed && tag->svg_fragment != (String)0 &&
+	  tag->svg_checksum == tag->checksum) {
+	    SVG__append(svg, tag->svg_fragment);
+	} else {
+	    Unsigned mark = SVG__mark(svg);
+	    Tag__svg_write(tag, svg);
+	    if (tag->svg_fragment != (String)0) {
+		String__free(tag->svg_fragment);
+	    }
+	    tag->svg_fragment = SVG__fragment(svg, mark);
+	    tag->svg_checksum = tag->checksum;
+	}
     }
 
     // Output each *tag in *all_tags*:
@@ -530,15 +1621,164 @@ void Map__write(Map map, File out_file) {
 
 void Map__tag_announce(void *object, Integer id,
   Double x, Double y, Double z, Double twist, Double dx, Double dy, Double dz) {
-    File__format(stderr, "id=%d x=%f y=%f twist=%f\n", id, x, y, twist);
+    Logger__format(LOGGER__LEVEL_INFO,
+      "id=%d x=%f y=%f twist=%f\n", id, x, y, twist);
 }
 
 /// @brief Updates the location of each *tag* in *map*.
 /// @param map to update
 ///
 /// *Map__update*() will update the location of all the *Tag*'s in *map*.
+/// A structural change (a new tag or arc, flagged by *is_changed*)
+/// rebuilds the spanning tree and re-propagates every pose from the
+/// origin.  When only existing arcs were refined (queued on
+/// *changed_arcs* by *Map__arc_changed*()), just the spanning subtrees
+/// below those arcs are re-propagated and the rest of the map is left
+/// untouched.
+
+// *Map__subtree_propagate*() re-propagates poses through the spanning
+// subtree hanging below *tag*: every in-tree arc to a tag one hop
+// further from the origin is re-applied, depth first.  Re-propagating
+// the same subtree twice is harmless (the computation is idempotent):
+
+static void Map__subtree_propagate(Tag tag) {
+    List /* <Arc> */ arcs = tag->arcs;
+    Unsigned arcs_size = List__size(arcs);
+    for (Unsigned index = 0; index < arcs_size; index++) {
+	Arc arc = (Arc)List__fetch(arcs, index);
+	if (arc->in_tree) {
+	    Tag other = (arc->from_tag == tag) ? arc->to_tag : arc->from_tag;
+	    if (other->hop_count == tag->hop_count + 1) {
+		Tag__update_via_arc(other, arc);
+		Map__subtree_propagate(other);
+	    }
+	}
+    }
+}
+
+// *Map__tag_hop_compare*() orders the propagation schedule by
+// *hop_count*, so all of the tags of one spanning tree level end up
+// contiguous:
+
+static Integer Map__tag_hop_compare(Tag tag1, Tag tag2) {
+    if (tag1->hop_count < tag2->hop_count) {
+	return -1;
+    }
+    if (tag1->hop_count > tag2->hop_count) {
+	return 1;
+    }
+    return 0;
+}
+
+// A *Map_Propagate* hands one propagation worker its slice of the
+// current spanning tree level:
+
+typedef struct Map_Propagate__Struct *Map_Propagate;
+struct Map_Propagate__Struct {
+    Unsigned end;
+    List /* <Tag> */ propagate_tags;
+    Unsigned start;
+    Unsigned stride;
+};
+
+// *Map__propagate_worker*() is the propagation worker entry point.
+// Each worker strides through its level slice, so the workers cover
+// disjoint tags without any locking.  *Tag__arc_propagate*() touches
+// only the tag itself and its (already final) parent pose:
+
+static void *Map__propagate_worker(void *memory) {
+    Map_Propagate propagate = (Map_Propagate)memory;
+    List /* <Tag> */ propagate_tags = propagate->propagate_tags;
+    for (Unsigned index = propagate->start;
+      index < propagate->end; index += propagate->stride) {
+	Tag tag = (Tag)List__fetch(propagate_tags, index);
+	tag->update_changed = Tag__arc_propagate(tag, tag->update_arc);
+    }
+    return (void *)0;
+}
+
+// *Map__poses_propagate*() propagates every pose in the full-rebuild
+// schedule *map*->*propagate_tags* down the freshly extracted spanning
+// tree, level-synchronously: all tags at hop count *h* depend only on
+// tags at hop count *h* - 1, so each level fans out across the
+// propagation workers and the next level starts when the previous one
+// is complete.  The announce callbacks and checksum refreshes are not
+// thread safe, so they run in a serial epilogue:
+
+static void Map__poses_propagate(Map map) {
+    List /* <Tag> */ propagate_tags = map->propagate_tags;
+    Unsigned size = List__size(propagate_tags);
+    if (size == 0) {
+	return;
+    }
+
+    // Sort the schedule by hop count; discovery order interleaves the
+    // levels:
+    List__sort(propagate_tags, (List__Compare__Routine)Map__tag_hop_compare);
+
+    Unsigned level_start = 0;
+    while (level_start < size) {
+	// Find the end of the level that starts at *level_start*:
+	Unsigned hop_count =
+	  ((Tag)List__fetch(propagate_tags, level_start))->hop_count;
+	Unsigned level_end = level_start + 1;
+	while (level_end < size && ((Tag)List__fetch(propagate_tags,
+	  level_end))->hop_count == hop_count) {
+	    level_end += 1;
+	}
+
+	// One worker per 64 tags, so small levels stay serial and skip
+	// the thread create/join overhead entirely:
+	Unsigned threads = (level_end - level_start) / 64;
+	if (threads > map->update_threads) {
+	    threads = map->update_threads;
+	}
+	if (threads > 1) {
+	    struct Map_Propagate__Struct
+	      propagates[MAP__UPDATE_THREADS_MAXIMUM];
+	    pthread_t workers[MAP__UPDATE_THREADS_MAXIMUM];
+	    for (Unsigned index = 0; index < threads; index++) {
+		propagates[index].end = level_end;
+		propagates[index].propagate_tags = propagate_tags;
+		propagates[index].start = level_start + index;
+		propagates[index].stride = threads;
+	    }
+	    for (Unsigned index = 1; index < threads; index++) {
+		assert (pthread_create(&workers[index], (pthread_attr_t *)0,
+		  Map__propagate_worker, (void *)&propagates[index]) == 0);
+	    }
+	    Map__propagate_worker((void *)&propagates[0]);
+	    for (Unsigned index = 1; index < threads; index++) {
+		assert (pthread_join(workers[index], (void **)0) == 0);
+	    }
+	} else {
+	    for (Unsigned index = level_start; index < level_end; index++) {
+		Tag tag = (Tag)List__fetch(propagate_tags, index);
+		tag->update_changed =
+		  Tag__arc_propagate(tag, tag->update_arc);
+	    }
+	}
+	level_start = level_end;
+    }
+
+    // Serial epilogue: announce the tags that moved and refresh every
+    // propagated tag's checksum contribution (which also captures the
+    // *hop_count* writes the extraction made):
+    for (Unsigned index = 0; index < size; index++) {
+	Tag tag = (Tag)List__fetch(propagate_tags, index);
+	if (tag->update_changed) {
+	    map->tag_announce_routine(map->announce_object, tag->id,
+	      tag->x, tag->y, 0.0, tag->twist, 100.0, 100.0, 1.0);
+	    tag->update_changed = (Logical)0;
+	}
+	Map__checksum_tag(map, tag);
+	tag->update_arc = (Arc)0;
+    }
+}
 
 void Map__update(Map map) {
+    Logical updated =
+      (Logical)(map->is_changed != 0 || List__size(map->changed_arcs) != 0);
     if (map->is_changed != 0) {
 	// Increment *visit* to the next value to use for updating:
 	Unsigned visit = map->visit + 1;
@@ -554,35 +1794,33 @@ void Map__update(Map map) {
 	Tag origin_tag = (Tag)List__fetch(all_tags, 0);
 	origin_tag->visit = visit;
 	origin_tag->hop_count = 0;
+	Map__checksum_tag(map, origin_tag);
 	
 	// The first step is to identify all of the *Arc*'s that make a
 	// spanning tree of the *map* *Tags*'s.
 
 	// Initializd *pending_arcs* with the *Arc*'s from *orgin_tag*:
-	List /* <Arc> */ pending_arcs = map->pending_arcs;
-	List__all_append(pending_arcs, origin_tag->arcs);
+	Heap /* <Arc> */ pending_arcs = map->pending_arcs;
+	Heap__all_push(pending_arcs, origin_tag->arcs);
 
-	// We always want to keep *pending_arcs* sorted from longest to
-	// shortest at the end.  *Arc__distance_compare*() sorts longest first:
-	List__sort(pending_arcs, (List__Compare__Routine)Arc__distance_compare);
+	// The extraction below only decides the tree shape and hop
+	// counts; the actual pose writes are collected on
+	// *propagate_tags* and performed level-synchronously (and in
+	// parallel) afterwards:
+	List /* <Tag> */ propagate_tags = map->propagate_tags;
+
+	// *pending_arcs* is a min-heap keyed on arc distance
+	// (*Arc__distance_compare*() sorts longest first, and the heap
+	// pops what sorts last), so each pop is O(log k) instead of the
+	// O(k log k) full re-sort per insertion batch the *List* based
+	// extraction needed.
 
 	// We keep iterating across *pending_arcs* until it goes empty.
-	// since we keep it sorted from longest to shortest (and we always
-	// look at the end), we are building a spanning tree using the shortest
-	// possible *Arc*'s:
-	while (List__size(pending_arcs) != 0) {
-	    // Pop the shortest *arc* off the end of *pending_arcs*:
-	    Arc arc = (Arc)List__pop(pending_arcs);
-
-	    // For debugging only:
-	    //File__format(stderr, "----------\n");
-	    //Unsigned size = List__size(pending_arcs);
-	    //for (Unsigned index = 0; index < size; index++) {
-	    //    Arc arc = (Arc)List__fetch(pending_arcs, index);
-	    //    File__format(stderr,
-	    //      "pending_arcs[%d]: Arc[%d,%d] dist=%f\n",
-	    //      index, arc->origin->id, arc->target->id, arc->distance);
-	    //}
+	// Since every pop returns the shortest pending arc, we are
+	// building a spanning tree using the shortest possible *Arc*'s:
+	while (Heap__size(pending_arcs) != 0) {
+	    // Pop the shortest pending *arc*:
+	    Arc arc = (Arc)Heap__pop(pending_arcs);
 
 	    // If we already visited *arc*, just ignore it:
 	    if (arc->visit != visit) {
@@ -602,35 +1840,86 @@ void Map__update(Map map) {
 			// Add *to* to spanning tree:
 			assert (!to_is_new);
 			from_tag->hop_count = to_tag->hop_count + 1;
-			List__all_append(pending_arcs, from_tag->arcs);
+			Heap__all_push(pending_arcs, from_tag->arcs);
 			from_tag->visit = visit;
-			Tag__update_via_arc(from_tag, arc);
+			from_tag->update_arc = arc;
+			List__append(propagate_tags, (Memory)from_tag);
 		    } else {
 			// Add *from* to spanning tree:
 			assert (!from_is_new);
 			to_tag->hop_count = from_tag->hop_count + 1;
-			List__all_append(pending_arcs, to_tag->arcs);
+			Heap__all_push(pending_arcs, to_tag->arcs);
 			to_tag->visit = visit;
-			Tag__update_via_arc(to_tag, arc);
+			to_tag->update_arc = arc;
+			List__append(propagate_tags, (Memory)to_tag);
 		    }
 
 		    // Mark that *arc* is part of the spanning tree:
 		    arc->in_tree = (Logical)1;
-
-		    // Resort *pending_arcs* to that the shortest distance
-		    // sorts to the end:
-		    List__sort(pending_arcs,
-		      (List__Compare__Routine)Arc__distance_compare);
+		    Map__checksum_arc(map, arc);
 		} else {
 		    // *arc* connects across two nodes of spanning tree:
 		    arc->in_tree = (Logical)0;
+		    Map__checksum_arc(map, arc);
 		}
 	    }
 	}
 
-	// Mark that *map* is fully updated:
+	// Propagate the poses down the extracted tree, one level at a
+	// time across the propagation workers:
+	Map__poses_propagate(map);
+	List__trim(propagate_tags, 0);
+
+	// Mark that *map* is fully updated.  The full rebuild covered
+	// every tag, so individually recorded arc changes are already
+	// reflected:
         map->is_changed = (Logical)0;
+	List__trim(map->changed_arcs, 0);
+    } else {
+	// No structural change (no new tags or arcs): only the
+	// subtrees hanging below refined arcs need re-propagation.
+	// The spanning tree shape is left alone; it is rebuilt the
+	// next time a structural change sets *is_changed*:
+	List /* <Arc> */ changed_arcs = map->changed_arcs;
+	Unsigned changed_arcs_size = List__size(changed_arcs);
+	for (Unsigned index = 0; index < changed_arcs_size; index++) {
+	    Arc arc = (Arc)List__fetch(changed_arcs, index);
+	    if (arc->in_tree) {
+		// The downstream end is the one further from the origin:
+		Tag downstream_tag = arc->to_tag;
+		if (arc->from_tag->hop_count > arc->to_tag->hop_count) {
+		    downstream_tag = arc->from_tag;
+		}
+		Tag__update_via_arc(downstream_tag, arc);
+		Map__subtree_propagate(downstream_tag);
+	    }
+	    // Arcs outside the spanning tree carry no pose; nothing to do.
+	}
+	List__trim(changed_arcs, 0);
+    }
+
+    // Republish the shared memory segment (no-op when not publishing):
+    if (updated) {
+	Map__share_refresh(map);
+    }
+}
+
+/// @brief Sets the pose propagation worker thread count.
+/// @param map to update.
+/// @param update_threads is the number of worker threads to use.
+///
+/// *Map__update_threads_set*() sets how many worker threads the
+/// level-synchronous pose propagation of a full *Map__update*() rebuild
+/// fans out across.  The default is one per processor core; pass 1 to
+/// force the propagation fully serial.  The count is clamped to
+/// *MAP__UPDATE_THREADS_MAXIMUM*.
+
+void Map__update_threads_set(Map map, Unsigned update_threads) {
+    assert (update_threads >= 1);
+    if (update_threads > MAP__UPDATE_THREADS_MAXIMUM) {
+	update_threads = MAP__UPDATE_THREADS_MAXIMUM;
     }
+    map->update_threads = update_threads;
 }
 
 /// @brief Writes *map* out to *xml_in_file*.
@@ -640,12 +1929,12 @@ void Map__update(Map map) {
 /// *Map__tag_heights_xml_read*() will write *map* out to *File* in
 /// XML file.
 
-void Map__tag_heights_xml_read(Map map, File xml_in_file) {
+void Map__tag_heights_xml_read(Map map, File_Reader xml_in_file) {
     // Read in Map XML tag '<Map_Tag_Heights Count="xx">' :
-    File__tag_match(xml_in_file, "Map_Tag_Heights");
+    File_Reader__tag_match(xml_in_file, "Map_Tag_Heights");
     Unsigned count =
-      (Unsigned)File__integer_attribute_read(xml_in_file, "Count");
-    File__string_match(xml_in_file, ">\n");
+      (Unsigned)File_Reader__integer_attribute_read(xml_in_file, "Count");
+    File_Reader__string_match(xml_in_file, ">\n");
 
     List tag_heights = map->tag_heights;
     assert (tag_heights != (List)0);
@@ -657,10 +1946,21 @@ void Map__tag_heights_xml_read(Map map, File xml_in_file) {
     }
 
     // Process the final Map XML tag "</Map_Tag_Heights>":
-    File__tag_match(xml_in_file, "/Map_Tag_Heights");
-    File__string_match(xml_in_file, ">\n");
+    File_Reader__tag_match(xml_in_file, "/Map_Tag_Heights");
+    File_Reader__string_match(xml_in_file, ">\n");
 
-    // Sort *tag_heights*:
+    // Sort *tag_heights* so *Map__distance_per_pixel*() can binary
+    // search it:
     List__sort(tag_heights, (List__Compare__Routine)Tag_Height__compare);
+
+    // Every existing *Tag* caches its resolved height in
+    // *distance_per_pixel*, so a reload must refresh those caches:
+    List /* <Tag> */ all_tags = map->all_tags;
+    Unsigned all_tags_size = List__size(all_tags);
+    for (Unsigned index = 0; index < all_tags_size; index++) {
+	Tag tag = (Tag)List__fetch(all_tags, index);
+	tag->distance_per_pixel =
+	  (Fiducials_Real)Map__distance_per_pixel(map, tag->id);
+    }
 }
 
@@ -0,0 +1,213 @@
+// Copyright (c) 2013 by Wayne C. Gramlich.  All rights reserved.
+
+// Map_Bench synthesizes a *side* x *side* grid map and times the hot
+// *Map* operations on it, so scaling can be charted before a map that
+// large shows up in production:
+//
+//        Map_Bench [side] [iterations]
+//
+// *side* defaults to 100 (i.e. 10000 tags) and *iterations* to 10.
+// Every result goes to standard output as one machine readable line:
+//
+//        map_bench op=<name> tags=<n> arcs=<n> seconds=<s> per_second=<r>
+//
+// so CI can grep the lines and chart per operation throughput.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <time.h>
+
+#include "Arc.h"
+#include "Double.h"
+#include "File.h"
+#include "Integer.h"
+#include "List.h"
+#include "Logical.h"
+#include "Map.h"
+#include "String.h"
+#include "Tag.h"
+#include "Unsigned.h"
+
+// *Map_Bench__tag_announce*() is a silent announce routine; the
+// default *Map__tag_announce*() would print every tag move and swamp
+// the result lines:
+
+static void Map_Bench__tag_announce(void *object, Integer id,
+  Double x, Double y, Double z, Double twist,
+  Double dx, Double dy, Double dz) {
+}
+
+// *Map_Bench__now*() returns the monotonic clock in seconds:
+
+static Double Map_Bench__now(void) {
+    struct timespec now;
+    assert (clock_gettime(CLOCK_MONOTONIC, &now) == 0);
+    return (Double)now.tv_sec + (Double)now.tv_nsec * 1e-9;
+}
+
+// *Map_Bench__report*() emits one machine readable result line.
+// *operations* is how many operations ran in *seconds*:
+
+static void Map_Bench__report(Map map,
+  const char * operation, Unsigned operations, Double seconds) {
+    Double per_second = 0.0;
+    if (seconds > 0.0) {
+	per_second = (Double)operations / seconds;
+    }
+    File__format(stdout,
+      "map_bench op=%s tags=%d arcs=%d seconds=%f per_second=%f\n",
+      operation, List__size(map->all_tags), List__size(map->all_arcs),
+      seconds, per_second);
+}
+
+int main(int arguments_size, char * arguments[]) {
+    Unsigned side = 100;
+    Unsigned iterations = 10;
+    if (arguments_size > 1) {
+	side = String__to_unsigned(arguments[1]);
+    }
+    if (arguments_size > 2) {
+	iterations = String__to_unsigned(arguments[2]);
+    }
+    assert (side >= 2);
+    assert (iterations >= 1);
+
+    Double pi = 3.14159265358979323846264;
+    Double angle90 = pi / 2.0;
+    Double angle180 = pi;
+    Double spacing = 10.0;
+
+    // Build a *side* x *side* grid of tags with an arc between each
+    // pair of horizontal and vertical neighbors.  Tag (column, row)
+    // gets id row x side + column, so every arc already has its lower
+    // id in *from_tag*:
+    Map map = Map__new((void *)0, Map_Bench__tag_announce);
+    Unsigned visit = map->visit;
+    Double start = Map_Bench__now();
+    for (Unsigned row = 0; row < side; row++) {
+	for (Unsigned column = 0; column < side; column++) {
+	    Tag tag = Map__tag_lookup(map, row * side + column);
+	    Tag__initialize(tag,
+	      0.0, (Double)column * spacing, (Double)row * spacing,
+	      1.0, visit);
+	}
+    }
+    Map_Bench__report(map, "tag_create", side * side,
+      Map_Bench__now() - start);
+
+    start = Map_Bench__now();
+    for (Unsigned row = 0; row < side; row++) {
+	for (Unsigned column = 0; column < side; column++) {
+	    Tag tag = Map__tag_lookup(map, row * side + column);
+	    if (column + 1 < side) {
+		Tag right_tag = Map__tag_lookup(map, row * side + column + 1);
+		Arc__create(tag, 0.0, spacing, right_tag, -angle180, 0.0);
+	    }
+	    if (row + 1 < side) {
+		Tag above_tag = Map__tag_lookup(map, (row + 1) * side + column);
+		Arc__create(tag, -angle90, spacing, above_tag, angle90, 0.0);
+	    }
+	}
+    }
+    Unsigned all_arcs_size = List__size(map->all_arcs);
+    Map_Bench__report(map, "arc_create", all_arcs_size,
+      Map_Bench__now() - start);
+
+    // Full spanning tree rebuild plus pose propagation:
+    start = Map_Bench__now();
+    Map__update(map);
+    Map_Bench__report(map, "update_full", 1, Map_Bench__now() - start);
+
+    // Arc churn: refine a spread of existing arcs and run the
+    // incremental update, once per iteration:
+    Unsigned stride = all_arcs_size / 100;
+    if (stride == 0) {
+	stride = 1;
+    }
+    Unsigned churned = 0;
+    start = Map_Bench__now();
+    for (Unsigned iteration = 0; iteration < iterations; iteration++) {
+	for (Unsigned index = 0; index < all_arcs_size; index += stride) {
+	    Arc arc = (Arc)List__fetch(map->all_arcs, index);
+	    Arc__update(arc, arc->from_twist,
+	      arc->distance + 0.001, arc->to_twist, arc->goodness);
+	    Map__arc_changed(map, arc);
+	    churned += 1;
+	}
+	Map__update(map);
+    }
+    Map_Bench__report(map, "arc_churn", churned, Map_Bench__now() - start);
+
+    // Tag and arc lookups over the whole grid:
+    start = Map_Bench__now();
+    for (Unsigned iteration = 0; iteration < iterations; iteration++) {
+	for (Unsigned id = 0; id < side * side; id++) {
+	    Tag tag = Map__tag_lookup(map, id);
+	    assert (tag->id == id);
+	}
+    }
+    Map_Bench__report(map, "tag_lookup", iterations * side * side,
+      Map_Bench__now() - start);
+
+    start = Map_Bench__now();
+    Unsigned arc_lookups = 0;
+    for (Unsigned iteration = 0; iteration < iterations; iteration++) {
+	for (Unsigned row = 0; row < side; row++) {
+	    for (Unsigned column = 0; column + 1 < side; column++) {
+		Tag tag = Map__tag_lookup(map, row * side + column);
+		Tag right_tag = Map__tag_lookup(map, row * side + column + 1);
+		Arc arc = Map__arc_lookup(map, tag, right_tag);
+		assert (arc->from_tag == tag);
+		arc_lookups += 1;
+	    }
+	}
+    }
+    Map_Bench__report(map, "arc_lookup", arc_lookups,
+      Map_Bench__now() - start);
+
+    // Neighborhood queries through the spatial grid index:
+    List /* <Tag> */ near_tags = List__new();
+    start = Map_Bench__now();
+    Unsigned near_queries = 0;
+    for (Unsigned iteration = 0; iteration < iterations; iteration++) {
+	for (Unsigned row = 0; row < side; row += 7) {
+	    for (Unsigned column = 0; column < side; column += 7) {
+		List__trim(near_tags, 0);
+		(void)Map__tags_near(map, (Double)column * spacing,
+		  (Double)row * spacing, 2.5 * spacing, near_tags);
+		near_queries += 1;
+	    }
+	}
+    }
+    Map_Bench__report(map, "tags_near", near_queries,
+      Map_Bench__now() - start);
+
+    // Sorting (already sorted after the update; this times the
+    // verification-friendly common case):
+    start = Map_Bench__now();
+    Map__sort(map);
+    Map_Bench__report(map, "sort", 1, Map_Bench__now() - start);
+
+    // Text format save/restore round trip:
+    start = Map_Bench__now();
+    Map__save(map, "Map_Bench.xml");
+    Map_Bench__report(map, "save_text", 1, Map_Bench__now() - start);
+
+    start = Map_Bench__now();
+    Map restored_map = Map__restore("Map_Bench.xml");
+    Map_Bench__report(map, "restore_text", 1, Map_Bench__now() - start);
+    assert (Map__compare(map, restored_map) == 0);
+
+    // Binary snapshot save/restore round trip:
+    start = Map_Bench__now();
+    Map__binary_save(map, "Map_Bench.fidmap");
+    Map_Bench__report(map, "save_binary", 1, Map_Bench__now() - start);
+
+    start = Map_Bench__now();
+    Map binary_map = Map__binary_restore("Map_Bench.fidmap");
+    Map_Bench__report(map, "restore_binary", 1, Map_Bench__now() - start);
+    assert (Map__compare(map, binary_map) == 0);
+
+    return 0;
+}
@@ -0,0 +1,182 @@
+// Copyright (c) 2013 by Wayne C. Gramlich.  All rights reserved.
+
+// Map_Merge combines the map files produced by several robots mapping
+// one site simultaneously into a single map file:
+//
+//        Map_Merge merged.xml input1.xml input2.xml ...
+//
+// The input files are parsed in parallel (one loader thread per file.)
+// The first input establishes the reference frame; every further input
+// is aligned through the tag ids it shares with the maps merged before
+// it -- tag poses are derived from arcs, so importing an input's arcs
+// into the merged map re-expresses its tags in the merged frame.  When
+// the same arc (the same tag id pair) appears in several inputs, the
+// measurement with the best (lowest) goodness wins.  One final
+// *Map__update*() pass rebuilds the spanning tree and propagates every
+// pose before the merged map is written out.
+//
+// An input that shares no tag id with the maps merged before it cannot
+// be aligned; it is still merged (its tags keep their own frame until
+// some later mapping run connects them), but a warning is printed.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "Arc.h"
+#include "Double.h"
+#include "File.h"
+#include "Integer.h"
+#include "List.h"
+#include "Logical.h"
+#include "Map.h"
+#include "Memory.h"
+#include "String.h"
+#include "Tag.h"
+#include "Unsigned.h"
+
+// *Map_Merge__tag_announce*() is a silent announce routine; the final
+// *Map__update*() pass moves every tag and the default announce routine
+// would print each move:
+
+static void Map_Merge__tag_announce(void *object, Integer id,
+  Double x, Double y, Double z, Double twist,
+  Double dx, Double dy, Double dz) {
+}
+
+// *Map_Merge__now*() returns the monotonic clock in seconds:
+
+static Double Map_Merge__now(void) {
+    struct timespec now;
+    assert (clock_gettime(CLOCK_MONOTONIC, &now) == 0);
+    return (Double)now.tv_sec + (Double)now.tv_nsec * 1e-9;
+}
+
+// A *Map_Merge_Load* hands one loader thread its input file and
+// receives the parsed *Map* back:
+
+typedef struct Map_Merge_Load__Struct *Map_Merge_Load;
+struct Map_Merge_Load__Struct {
+    String file_name;
+    Map map;
+};
+
+// *Map_Merge__load*() is the loader thread entry point.  Each input
+// file is slurped and parsed into its own private *Map*, so the loads
+// share nothing and run fully in parallel:
+
+static void *Map_Merge__load(void *memory) {
+    Map_Merge_Load load = (Map_Merge_Load)memory;
+    load->map = Map__restore(load->file_name);
+    return (void *)0;
+}
+
+int main(int arguments_size, char * arguments[]) {
+    if (arguments_size < 3) {
+	File__format(stderr,
+	  "Usage: Map_Merge merged.xml input1.xml input2.xml ...\n");
+	return 1;
+    }
+    String merged_file_name = arguments[1];
+    Unsigned inputs_size = (Unsigned)(arguments_size - 2);
+
+    // Parse every input file on its own loader thread:
+    Double start = Map_Merge__now();
+    struct Map_Merge_Load__Struct *loads =
+      (struct Map_Merge_Load__Struct *)Memory__allocate(
+      inputs_size * sizeof(struct Map_Merge_Load__Struct));
+    pthread_t *loaders =
+      (pthread_t *)Memory__allocate(inputs_size * sizeof(pthread_t));
+    for (Unsigned index = 0; index < inputs_size; index++) {
+	loads[index].file_name = arguments[index + 2];
+	loads[index].map = (Map)0;
+	assert (pthread_create(&loaders[index], (pthread_attr_t *)0,
+	  Map_Merge__load, (void *)&loads[index]) == 0);
+    }
+    for (Unsigned index = 0; index < inputs_size; index++) {
+	assert (pthread_join(loaders[index], (void **)0) == 0);
+    }
+    Double parse_seconds = Map_Merge__now() - start;
+
+    // Reconcile the inputs into *merged_map* in argument order:
+    start = Map_Merge__now();
+    Map merged_map = Map__new((void *)0, Map_Merge__tag_announce);
+    Unsigned arc_updates = 0;
+    for (Unsigned input_index = 0; input_index < inputs_size; input_index++) {
+	Map input_map = loads[input_index].map;
+	List /* <Tag> */ input_tags = input_map->all_tags;
+	Unsigned input_tags_size = List__size(input_tags);
+
+	// Verify that this input shares a tag id with the maps merged
+	// so far; without one it cannot be aligned into their frame:
+	if (input_index > 0) {
+	    Logical shared = (Logical)0;
+	    for (Unsigned index = 0; index < input_tags_size; index++) {
+		Tag input_tag = (Tag)List__fetch(input_tags, index);
+		if (input_tag->id < merged_map->tags_dense_size &&
+		  merged_map->tags_dense[input_tag->id] != (Tag)0) {
+		    shared = (Logical)1;
+		    break;
+		}
+	    }
+	    if (!shared) {
+		File__format(stderr, "Map_Merge: '%s' shares no tag id "
+		  "with the preceding inputs; merging it unaligned\n",
+		  loads[input_index].file_name);
+	    }
+	}
+
+	// Import the tags.  The first input that mentions a tag seeds
+	// its pose and diagonal; the final update pass re-propagates
+	// every pose from the merged origin anyway:
+	for (Unsigned index = 0; index < input_tags_size; index++) {
+	    Tag input_tag = (Tag)List__fetch(input_tags, index);
+	    Tag merged_tag = Map__tag_lookup(merged_map, input_tag->id);
+	    if (!merged_tag->initialized) {
+		merged_tag->diagonal = input_tag->diagonal;
+		merged_tag->initialized = (Logical)1;
+		merged_tag->twist = input_tag->twist;
+		merged_tag->x = input_tag->x;
+		merged_tag->y = input_tag->y;
+	    }
+	}
+
+	// Import the arcs, keeping the best goodness for duplicates.
+	// *Map__arc_lookup*() creates a missing arc with an absurdly
+	// bad goodness, so creation and improvement are one code path:
+	List /* <Arc> */ input_arcs = input_map->all_arcs;
+	Unsigned input_arcs_size = List__size(input_arcs);
+	for (Unsigned index = 0; index < input_arcs_size; index++) {
+	    Arc input_arc = (Arc)List__fetch(input_arcs, index);
+	    Tag from_tag =
+	      Map__tag_lookup(merged_map, input_arc->from_tag->id);
+	    Tag to_tag = Map__tag_lookup(merged_map, input_arc->to_tag->id);
+	    Arc merged_arc = Map__arc_lookup(merged_map, from_tag, to_tag);
+	    if (input_arc->goodness < merged_arc->goodness) {
+		Arc__update(merged_arc, input_arc->from_twist,
+		  input_arc->distance, input_arc->to_twist,
+		  input_arc->goodness);
+		arc_updates += 1;
+	    }
+	}
+    }
+    Double merge_seconds = Map_Merge__now() - start;
+
+    // One full update pass rebuilds the spanning tree and propagates
+    // every pose in the merged frame:
+    start = Map_Merge__now();
+    Map__update(merged_map);
+    Double update_seconds = Map_Merge__now() - start;
+
+    Map__save(merged_map, merged_file_name);
+
+    File__format(stdout,
+      "map_merge inputs=%d tags=%d arcs=%d arc_updates=%d"
+      " parse_seconds=%f merge_seconds=%f update_seconds=%f\n",
+      inputs_size, List__size(merged_map->all_tags),
+      List__size(merged_map->all_arcs), arc_updates,
+      parse_seconds, merge_seconds, update_seconds);
+    return 0;
+}
@@ -43,6 +43,129 @@ Memory Memory__reallocate(Memory memory, Unsigned new_size) {
     return memory;
 }
 
+// *Memory_Arena* routines:
+
+/// @brief *Memory_Arena_Block* is one chunk of arena storage; the
+/// allocatable bytes follow immediately after the header.
+typedef struct Memory_Arena_Block__Struct *Memory_Arena_Block;
+
+struct Memory_Arena_Block__Struct {
+    /// @brief The next block in the chain (or null.)
+    Memory_Arena_Block next;
+
+    /// @brief The number of allocatable bytes that follow the header.
+    Unsigned size;
+
+    /// @brief The number of bytes already handed out.
+    Unsigned used;
+};
+
+struct Memory_Arena__Struct {
+    /// @brief The default number of allocatable bytes per block.
+    Unsigned block_size;
+
+    /// @brief The block currently being filled.
+    Memory_Arena_Block current;
+
+    /// @brief The head of the block chain.
+    Memory_Arena_Block first;
+};
+
+/// @brief Allocates and returns one arena block with *size* bytes.
+/// @param size is the number of allocatable bytes.
+/// @returns the new block.
+
+static Memory_Arena_Block Memory_Arena_Block__create(Unsigned size) {
+    Memory_Arena_Block block =
+      (Memory_Arena_Block)Memory__allocate(sizeof(*block) + size);
+    block->next = (Memory_Arena_Block)0;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+/// @brief Creates and returns an empty arena.
+/// @param block_size is the default number of bytes per block.
+/// @returns the new arena.
+///
+/// *Memory__arena_create*() will create and return an arena that
+/// allocates storage in blocks of *block_size* bytes.  Allocations
+/// larger than *block_size* get a dedicated block of their own.
+
+Memory_Arena Memory__arena_create(Unsigned block_size) {
+    assert (block_size > 0);
+    Memory_Arena arena = Memory__new(Memory_Arena);
+    arena->block_size = block_size;
+    arena->first = Memory_Arena_Block__create(block_size);
+    arena->current = arena->first;
+    return arena;
+}
+
+/// @brief Allocates *bytes* of storage from *arena*.
+/// @param arena to allocate from.
+/// @param bytes is the number of bytes to allocate.
+/// @returns a pointer to the allocated storage.
+///
+/// *Memory__arena_allocate*() will return *bytes* bytes of storage
+/// (rounded up so that every allocation stays 8 byte aligned) from
+/// *arena*.  The storage stays valid until the next call to
+/// *Memory__arena_reset*() or *Memory__arena_free*(); it must never be
+/// passed to *Memory__free*().
+
+Memory Memory__arena_allocate(Memory_Arena arena, Unsigned bytes) {
+    // Keep every allocation 8 byte aligned:
+    bytes = (bytes + 7) & ~(Unsigned)7;
+
+    // Advance to (or create) a block with enough room:
+    Memory_Arena_Block block = arena->current;
+    while (block->used + bytes > block->size) {
+	Memory_Arena_Block next = block->next;
+	if (next == (Memory_Arena_Block)0) {
+	    Unsigned size = arena->block_size;
+	    if (bytes > size) {
+		size = bytes;
+	    }
+	    next = Memory_Arena_Block__create(size);
+	    block->next = next;
+	}
+	block = next;
+	arena->current = block;
+    }
+
+    // Bump *used* and return the storage:
+    Memory memory = (Memory)((char *)(block + 1) + block->used);
+    block->used += bytes;
+    return memory;
+}
+
+/// @brief Recycles every allocation in *arena* at once.
+/// @param arena to reset.
+///
+/// *Memory__arena_reset*() will mark all of the storage in *arena* as
+/// available again.  The blocks themselves are kept for reuse, so a
+/// steady state arena performs no allocator calls at all.
+
+void Memory__arena_reset(Memory_Arena arena) {
+    for (Memory_Arena_Block block = arena->first;
+      block != (Memory_Arena_Block)0; block = block->next) {
+	block->used = 0;
+    }
+    arena->current = arena->first;
+}
+
+/// @brief Releases *arena* and all of its blocks.
+/// @param arena to release.
+
+void Memory__arena_free(Memory_Arena arena) {
+    Memory_Arena_Block block = arena->first;
+    while (block != (Memory_Arena_Block)0) {
+	Memory_Arena_Block next = block->next;
+	Memory__free((Memory)block);
+	block = next;
+    }
+    Memory__free((Memory)arena);
+}
+
 /// @brief Return *unsigned1* as a *Memory* pointer.
 /// @param unsigned1 is the value to be treated as *Memory*
 /// @returns *unsigned1* as a *Memory* pointer.
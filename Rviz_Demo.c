@@ -4,6 +4,7 @@
 #include "sys/time.h"
 #include <unistd.h>
 
+#include "Announce.h"
 #include "Character.h"
 #include "CV.h"
 #include "Double.h"
@@ -87,9 +88,16 @@ int main(int arguments_size, char * arguments[]) {
         image = CV_Image__pnm_read(image_file_name0);
         assert (image != (CV_Image)0);
         void *rviz = initRviz(arguments_size, arguments, "Rviz_Demo");
+
+        // Publish markers from a drain thread rather than synchronously
+        // from the detection loop, so ROS publish time never inflates
+        // the per frame detection latency:
+        Announce_Queue announce_queue = Announce_Queue__create(rviz,
+          Rviz__location_announce, Rviz__tag_announce);
         Fiducials fiducials =
           Fiducials__create(image, lens_calibrate_file_name,
-          rviz, Rviz__location_announce, Rviz__tag_announce);
+          (void *)announce_queue, Announce_Queue__location_announce,
+          Announce_Queue__tag_announce);
         Fiducials__tag_heights_xml_read(fiducials, "Tag_Heights.xml");
 
         for (Unsigned index = 0; index < size; index++) {
@@ -130,6 +138,7 @@ int main(int arguments_size, char * arguments[]) {
               "Outputing %d locations\n", List__size(locations));
             Map__svg_write(map, "Demo", locations);
         }
+        Announce_Queue__free(announce_queue);
     }
 
 
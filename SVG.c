@@ -1,14 +1,101 @@
 // Copyright (c) by Wayne C. Gramlich.  All rights reserved.
 
 #include <assert.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
 
 #include "Bounding_Box.h"
 #include "Double.h"
 #include "Integer.h"
+#include "Memory.h"
 #include "String.h"
 #include "SVG.h"
 #include "Unsigned.h"
 
+// All output is accumulated in a growable in-memory buffer and written
+// to the file with a single write when the *SVG* is closed, instead of
+// trickling out through one *File__format*() call per primitive.
+// *SVG__mark*()/*SVG__fragment*()/*SVG__append*() let a caller capture
+// the bytes emitted for one object and replay them verbatim on a later
+// render (see *Map__svg_write*()).
+
+// *SVG__buffer_reserve*() makes sure at least *bytes* more bytes fit
+// in the buffer of *svg*:
+
+static void SVG__buffer_reserve(SVG svg, Unsigned bytes) {
+    Unsigned needed = svg->buffer_size + bytes;
+    if (needed > svg->buffer_limit) {
+	Unsigned buffer_limit = svg->buffer_limit;
+	while (buffer_limit < needed) {
+	    buffer_limit <<= 1;
+	}
+	svg->buffer =
+	  (String)Memory__reallocate((Memory)svg->buffer, buffer_limit);
+	svg->buffer_limit = buffer_limit;
+    }
+}
+
+// *SVG__format*() appends formatted text to the buffer of *svg*:
+
+static void SVG__format(SVG svg, const char *format, ...) {
+    va_list arguments;
+    va_start(arguments, format);
+    Unsigned available = svg->buffer_limit - svg->buffer_size;
+    Integer written = vsnprintf(
+      svg->buffer + svg->buffer_size, available, format, arguments);
+    va_end(arguments);
+    assert (written >= 0);
+
+    // If the formatted text did not fit, grow the buffer and rerun:
+    if ((Unsigned)written >= available) {
+	SVG__buffer_reserve(svg, (Unsigned)written + 1);
+	va_start(arguments, format);
+	written = vsnprintf(svg->buffer + svg->buffer_size,
+	  svg->buffer_limit - svg->buffer_size, format, arguments);
+	va_end(arguments);
+	assert (written >= 0);
+    }
+    svg->buffer_size += (Unsigned)written;
+}
+
+/// @brief Appends the previously captured *fragment* to *svg*.
+/// @param svg to append to.
+/// @param fragment returned by a previous *SVG__fragment*() call.
+///
+/// *SVG__append*() copies *fragment* into the output buffer verbatim,
+/// skipping all of the coordinate formatting that produced it.
+
+void SVG__append(SVG svg, String fragment) {
+    Unsigned bytes = String__size(fragment);
+    SVG__buffer_reserve(svg, bytes + 1);
+    (void)memcpy(svg->buffer + svg->buffer_size, fragment, bytes);
+    svg->buffer_size += bytes;
+    svg->buffer[svg->buffer_size] = '\0';
+}
+
+/// @brief Returns a copy of everything emitted since *mark*.
+/// @param svg to copy from.
+/// @param mark returned by *SVG__mark*() before the object was emitted.
+/// @returns the captured fragment (release with *String__free*().)
+
+String SVG__fragment(SVG svg, Unsigned mark) {
+    assert (mark <= svg->buffer_size);
+    Unsigned bytes = svg->buffer_size - mark;
+    String fragment = (String)Memory__allocate(bytes + 1);
+    (void)memcpy(fragment, svg->buffer + mark, bytes);
+    fragment[bytes] = '\0';
+    return fragment;
+}
+
+/// @brief Returns the current output position of *svg*.
+/// @param svg to mark.
+/// @returns the mark to pass to *SVG__fragment*().
+
+Unsigned SVG__mark(SVG svg) {
+    return svg->buffer_size;
+}
+
 /// @brief Turns *svg* into a cartesian graphing canvas bounded by
 /// *bounding_box*.
 /// @param svg is the *SVG* object to modify.
@@ -73,11 +160,18 @@ void SVG__cartesian_scale(
 /// *SVG__close*() will close *svg*.
 
 void SVG__close(SVG svg) {
-    // Close *svg*:
+    // Terminate the document and flush the whole buffer with a single
+    // write:
+    SVG__format(svg, "</svg>\n");
     File svg_stream = svg->stream;
-    File__format(svg_stream, "</svg>\n");
+    assert (fwrite(svg->buffer, 1, svg->buffer_size, svg_stream) ==
+      svg->buffer_size);
     File__close(svg_stream);
     svg->stream = (File)0;
+    Memory__free((Memory)svg->buffer);
+    svg->buffer = (String)0;
+    svg->buffer_limit = 0;
+    svg->buffer_size = 0;
 }
 
 /// @brief Draw a line from (*x1*, *y1*) to (*x2*, *y2*) using *stroke*.
@@ -94,21 +188,20 @@ void SVG__close(SVG svg) {
 void SVG__line(SVG svg,
   Double x1, Double y1, Double x2, Double y2, String stroke) {
     // Extract some values from *svg*:
-    File svg_stream = svg->stream;
     Double x_offset = svg->x_offset;
     Double y_offset = svg->y_offset;
     Double x_scale = svg->x_scale;
     Double y_scale = svg->y_scale;
     String units = svg->units;
 
-    // Output "<line ... />" to *svg_stream*:
-    File__format(svg_stream,
+    // Output "<line ... />" to the buffer:
+    SVG__format(svg,
       "<line x1=\"%f%s\" y1=\"%f%s\"",
       (x1 + x_offset) * x_scale, units, (y1 + y_offset) * y_scale, units);
-    File__format(svg_stream, 
-      " x2=\"%f%s\" y2=\"%f%s\"", 
+    SVG__format(svg,
+      " x2=\"%f%s\" y2=\"%f%s\"",
       (x2 + x_offset) * x_scale, units, (y2 + y_offset) * y_scale, units);
-    File__format(svg_stream,
+    SVG__format(svg,
        " style=\"stroke:%s\"/>\n", stroke);
 }
 
@@ -134,13 +227,18 @@ SVG SVG__open(String base_name,
     // Get *svg_stream* opened:
     SVG svg = (SVG)0;
     char file_name[100];
-    (void)sprintf(file_name, "%s.svg", base_name);
+    (void)String__format_into(file_name, sizeof(file_name),
+      "%s.svg", base_name);
     File svg_stream = File__open(file_name, "w");
     if (svg_stream == (File)0) {
 	File__format(stderr, "Unable to open %s.svg\n", base_name);
     } else {
         // Allocate and load up *svg*:
 	svg = Memory__new(SVG);
+	svg->buffer = (String)Memory__allocate(4096);
+	svg->buffer[0] = '\0';
+	svg->buffer_limit = 4096;
+	svg->buffer_size = 0;
 	svg->height = height;
 	svg->stream = svg_stream;
 	svg->width = width;
@@ -151,18 +249,18 @@ SVG SVG__open(String base_name,
 	svg->y_offset = 0.0;
 
 	// Ouput the header for *svg*:
-	File__format(svg_stream,
+	SVG__format(svg,
 	  "<?xml version=\"1.0\" standalone=\"no\"?>\n\n");
-	File__format(svg_stream,
+	SVG__format(svg,
 	  "<!DOCTYPE svg PUBLIC \"-//W3C//DTD SVG 1.1//EN\"\n");
-	File__format(svg_stream,
+	SVG__format(svg,
           " \"http://www.w3.org/Graphics/SVG/1.1/DTD/svg11.dtd\">\n\n");
-	File__format(svg_stream,
+	SVG__format(svg,
 	  "<svg width=\"%f%s\" height=\"%f%s\"\n",
 	  width * x_scale, units, height * y_scale, units);
-	File__format(svg_stream,
+	SVG__format(svg,
 	 " version=\"1.1\"\n");
-	File__format(svg_stream,
+	SVG__format(svg,
 	 " xmlns=\"http://www.w3.org/2000/svg\">\n\n");
     }
 
@@ -187,22 +285,21 @@ SVG SVG__open(String base_name,
 void SVG__rectangle(SVG svg, Double x, Double y,
   Double width, Double height, String stroke_color, String fill_color) {
     // Grab some values from svg:
-    File svg_stream = svg->stream;
     Double x_offset = svg->x_offset;
     Double y_offset = svg->y_offset;
     Double x_scale = svg->x_scale;
     Double y_scale = svg->y_scale;
     String units = svg->units;
 
-    // Output "<rect ... />" to *svg_stream*:
+    // Output "<rect ... />" to the buffer:
     Double x_final = (x + x_offset) * x_scale;
     Double y_final = (y + y_offset) * y_scale;
-    File__format(svg_stream, 
+    SVG__format(svg,
       "<rect x=\"%f%s\" y=\"%f%s\"", x_final, units, y_final, units);
-    File__format(svg_stream,
+    SVG__format(svg,
       " width=\"%f%s\" height=\"%f%s\"",
       width * x_scale,  units, height * y_scale, units);
-    File__format(svg_stream,
+    SVG__format(svg,
       " style=\"stroke:%s; fill:%s\"/>\n", stroke_color, fill_color);
 }
 
@@ -218,17 +315,16 @@ void SVG__rectangle(SVG svg, Double x, Double y,
 void SVG__text(SVG svg,
   String message, Double x, Double y, String font_family, Unsigned font_size) {
     // Grab some values from *svg*:
-    File svg_stream = svg->stream;
     Double x_offset = svg->x_offset;
     Double y_offset = svg->y_offset;
     Double x_scale = svg->x_scale;
     Double y_scale = svg->y_scale;
     String units = svg->units;
 
-    File__format(svg_stream,
+    SVG__format(svg,
       "<text x=\"%f%s\" y=\"%f%s\"",
       (x + x_offset) * x_scale, units, (y + y_offset) * y_scale, units);
-    File__format(svg_stream,
+    SVG__format(svg,
       " style=\"font-family:%s; font-size:%d\">", font_family, font_size);
-    File__format(svg_stream, "%s</text>\n", message);
+    SVG__format(svg, "%s</text>\n", message);
 }
@@ -6,6 +6,7 @@
 #include <string.h>
 
 #include "Character.h"
+#include "Integer.h"
 #include "Logical.h"
 #include "String.h"
 #include "Memory.h"
@@ -50,15 +51,46 @@ String String__format(String format, ...) {
     // Compute *formatted_size*:
     char buffer[2];
     Unsigned formatted_size = vsnprintf(buffer, 0, format, variadic_arguments);
+    va_end(variadic_arguments);
+
     // Allocated *formatted*:
     String formatted = (String)Memory__allocate(formatted_size + 1);
 
-    // Format *formatted*:
+    // Format *formatted* (the variadic arguments must be restarted;
+    // they are indeterminate after the sizing pass above):
+    va_start(variadic_arguments, format);
     (void)vsnprintf(formatted, formatted_size + 1, format, variadic_arguments);
+    va_end(variadic_arguments);
 
     return formatted;
 }
 
+/// @brief Format into a caller provided *buffer* with no allocation.
+/// @param buffer is the caller provided buffer to format into.
+/// @param buffer_size is the size of *buffer* including the trailing null.
+/// @param format is the string to format.
+/// @param ... are the additional arguments to be formatted.
+/// @returns the full formatted size excluding the trailing null.
+///
+/// *String__format_into*() will format into *buffer* using the
+/// additional variadic arguments and always null terminate it.  Unlike
+/// *String__format*(), no heap allocation occurs, so it is safe to call
+/// in per frame and per tag loops; the buffer's lifetime is entirely
+/// the caller's.  If the result does not fit it is truncated, and the
+/// returned size (the untruncated size) will be *buffer_size* or more.
+
+Unsigned String__format_into(
+  String buffer, Unsigned buffer_size, String format, ...) {
+    assert (buffer_size > 0);
+    va_list variadic_arguments;
+    va_start(variadic_arguments, format);
+    Integer formatted_size =
+      vsnprintf(buffer, buffer_size, format, variadic_arguments);
+    va_end(variadic_arguments);
+    assert (formatted_size >= 0);
+    return (Unsigned)formatted_size;
+}
+
 /// @brief will free memory assciated with *string*.
 /// @param string to free.
 
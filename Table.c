@@ -11,6 +11,270 @@
 
 // *Table* routines:
 
+#if defined(TABLE__OPEN_ADDRESSING)
+
+// The open addressing backend keeps every binding in one flat array of
+// *Table_Slot_Struct* slots and resolves collisions by linear probing.
+// A lookup is a handful of sequential slot reads instead of a chain of
+// dependent pointer dereferences, which is what the per frame tag and
+// arc lookups in Map.c want.  The table is kept at most 75% full, so
+// there is always an empty slot and every probe terminates.
+
+/// @brief Returns the slot in *table* that either holds *key* or is the
+///        empty slot where *key* would go.
+/// @param table is the table to probe.
+/// @param hash is the 32-bit hash of *key*.
+/// @param key is the key to probe for.
+/// @returns the matching or empty slot.
+
+static Table_Slot Table__probe(Table table, Unsigned hash, Memory key)
+{
+    Table_Slot slots = table->slots;
+    Unsigned mask = table->slots_size - 1;
+    Table_Equal_Routine equal_routine = table->equal_routine;
+    Unsigned index = hash & mask;
+    while (1)
+    {
+	Table_Slot slot = &slots[index];
+	if (!slot->used ||
+	  (slot->hash == hash && equal_routine(slot->key, key)))
+	{
+	    return slot;
+	}
+	index = (index + 1) & mask;
+    }
+}
+
+/// @brief Allocates and returns *slots_size* empty slots.
+/// @param slots_size is the number of slots to allocate.
+/// @returns the empty slot array.
+
+static Table_Slot Table__slots_allocate(Unsigned slots_size)
+{
+    Table_Slot slots = (Table_Slot)Memory__allocate(
+      slots_size * sizeof(struct Table_Slot_Struct));
+    for (Unsigned index = 0; index < slots_size; index++)
+    {
+	slots[index].used = (Logical)0;
+    }
+    return slots;
+}
+
+/// @brief Returns a newly created table for string key/binding
+///        associatons.
+/// @param equal_routine is a procedure variable that is used to determine
+///        if two keys are equal.
+/// @param hash_routine is a procedure variable that is used to compute a
+///        32-bit hash of a key.
+/// @param empty_value is a value that is returned on lookup failure.
+///
+/// *Table__create*() will create and return an empty table for
+/// storing key/value bindings.  *equal_routine*() is used to test key equality.
+/// *hash_routine* is used to compute a 32-bit hash value of key.
+/// *empty_value* is returned when a lookup fails.
+
+Table Table__create(Table_Equal_Routine equal_routine,
+  Table_Hash_Routine hash_routine, Memory empty_value)
+{
+    Unsigned slots_size = 8;
+    Table table = Memory__new(Table);
+    table->slots = Table__slots_allocate(slots_size);
+    table->slots_size = slots_size;
+    table->empty_value = empty_value;
+    table->equal_routine = equal_routine;
+    table->hash_routine = hash_routine;
+    table->size = 0;
+    table->threshold = 6;
+    return table;
+}
+
+/// @brief Frees the storage associated with *table*.
+/// @param table is the *Table* object to free.
+///
+/// *Table__free*() will free the storage associated with *table*.  The
+/// various keys and values that are in *table* are not freed.
+
+void Table__free(Table table)
+{
+    Memory__free((Memory)table->slots);
+    Memory__free((Memory)table);
+}
+
+/// @brief Returns true if *key* is in *table*.
+/// @param table is the table to search *key* for.
+/// @param key is the key to look for in *table*.
+/// @returns true (1) for success and false (0) otherwise.
+///
+/// *Table__has_key*() returns true if *key* is in *table* and false
+/// otherwise.
+
+Logical Table__has_key(Table table, Memory key)
+{
+    Unsigned hash = table->hash_routine(key);
+    return Table__probe(table, hash, key)->used;
+}
+
+/// @brief Inserts a *key*-*value* binding into *table*.
+/// @param table is the table to insert the *key*-*value* binding into.
+/// @param key is the key portion of the key/value binding.
+/// @param value is the value portion of the key/value binding.
+///
+/// *Table__insert*() inserts *key*-*value* as a binding into *table*.
+/// An assertion failure occurs if *table* already has *key* in it.
+
+void Table__insert(Table table, Memory key, Memory value)
+{
+    // See whether we need to resize.
+    Unsigned size = table->size;
+    if (size >= table->threshold)
+    {
+	Table__resize(table);
+    }
+
+    // Probe for the *key* and make sure it is not already bound:
+    Unsigned hash = table->hash_routine(key);
+    Table_Slot slot = Table__probe(table, hash, key);
+    assert (!slot->used);
+
+    // Fill in the empty *slot*:
+    slot->hash = hash;
+    slot->key = key;
+    slot->value = value;
+    slot->used = (Logical)1;
+    table->size = size + 1;
+}
+
+/// @brief Return the matching key stored in *table* that matches *key*.
+/// @param table is the table to search for *key* in.
+/// @param key is the key value to match in *table*.
+/// @returns the key from *table* that matches *key* on success and and null
+///        empty otherwise.
+///
+/// *Table__key_lookup*() will return the key stored in *table* that matches
+/// *key*.  If *key* is matched*, null is returned.
+
+Memory Table__key_lookup(Table table, Memory key)
+{
+    Unsigned hash = table->hash_routine(key);
+    Table_Slot slot = Table__probe(table, hash, key);
+    key = (Memory)0;
+    if (slot->used)
+    {
+	key = slot->key;
+    }
+    return key;
+}
+
+/// @brief Return the value associated *key* in *table*.
+/// @param table is the table to search for *key* in.
+/// @param key is the key value to search for in *table*.
+/// @returns the value associted with *key* on success and an empty value
+///          otherwise.
+///
+/// *Table__lookup*() will return the value associated with *key* in
+/// *table*. If *key* is not in *table*, the empty value that was provided when
+/// *table* was created by *Table__create*().
+
+Memory Table__lookup(Table table, Memory key)
+{
+    Unsigned hash = table->hash_routine(key);
+    Table_Slot slot = Table__probe(table, hash, key);
+    Memory value = table->empty_value;
+    if (slot->used)
+    {
+	value = slot->value;
+    }
+    return value;
+}
+
+/// @brief Replace the *value* associated with *key* in *table*.
+/// @param table is the table to replace the *key*-*value* binding in.
+/// @param key is the key to search for in *table*.
+/// @param value is the new value to bind to *key*.
+///
+/// *Table__replace*() will replace the value asociated with *key* in
+/// *table* with *value*.  This routine triggers an assertion failure if *key*
+/// is not in *table*.
+
+void Table__replace(Table table, Memory key, Memory value)
+{
+    Unsigned hash = table->hash_routine(key);
+    Table_Slot slot = Table__probe(table, hash, key);
+    assert (slot->used);
+    slot->value = value;
+}
+
+/// @brief Double the number of slots in *table*.
+/// @param table is the table to resize.
+///
+/// *Table__resize*() will double the number of slots available in *table*.
+/// Hash table performance is kept up by keeping the table only about
+/// 75% full.
+
+void Table__resize(Table table)
+{
+    // Allocate a fresh empty slot array of twice the size:
+    Table_Slot old_slots = table->slots;
+    Unsigned old_slots_size = table->slots_size;
+    Unsigned new_slots_size = old_slots_size << 1;
+    table->slots = Table__slots_allocate(new_slots_size);
+    table->slots_size = new_slots_size;
+    table->threshold = new_slots_size * 3 / 4;
+
+    // Reinsert every used slot into the new array:
+    for (Unsigned index = 0; index < old_slots_size; index++)
+    {
+	Table_Slot old_slot = &old_slots[index];
+	if (old_slot->used)
+	{
+	    Table_Slot new_slot =
+	      Table__probe(table, old_slot->hash, old_slot->key);
+	    *new_slot = *old_slot;
+	}
+    }
+    Memory__free((Memory)old_slots);
+}
+
+/// @brief Output the contents of *table* to *file*.
+/// @param table is the table to show.
+/// @param file is the file to output to.
+///
+/// *Table__show*() will output the contents of *table* to *file* using
+/// the key/value show routines that were supplied to *table* by calling
+/// *Table__show_enable*().
+
+void Table__show(Table table, File file)
+{
+    // Grab some values from *table*:
+    Unsigned slots_size = table->slots_size;
+    Table_Key_Show_Routine key_show_routine = table->key_show_routine;
+    Table_Value_Show_Routine value_show_routine = table->value_show_routine;
+    assert(key_show_routine != (Table_Key_Show_Routine)0);
+    assert(value_show_routine != (Table_Value_Show_Routine)0);
+
+    // Print out a header line:
+    File__format(file, "Table: size=%d threshold=%d slots_size=%d\n",
+      table->size, table->threshold, slots_size);
+
+    // Output each used slot:
+    Table_Slot slots = table->slots;
+    for (Unsigned index = 0; index < slots_size; index++)
+    {
+	Table_Slot slot = &slots[index];
+	if (slot->used)
+	{
+	    File__format(file, "[%d]: (0x%08x, ", index, slot->hash);
+	    key_show_routine(slot->key, file);
+	    File__format(file, ", ");
+	    value_show_routine(slot->value, file);
+	    File__format(file, ")\n");
+	}
+    }
+    File__format(file, "\n");
+}
+
+#else // defined(TABLE__OPEN_ADDRESSING)
+
 /// @brief Returns a newly created table for string key/binding
 ///        associatons.
 /// @param equal_routine is a procedure variable that is used to determine
@@ -308,6 +572,8 @@ void Table__show(Table table, File file)
     File__format(file, "\n");
 }
 
+#endif // defined(TABLE__OPEN_ADDRESSING)
+
 /// @brief Enable *Table__show* by provide by storing both a key and value
 ///        show routine into *table*.
 /// @param table is the table to associate the show routines with.
@@ -328,6 +594,7 @@ void Table__show_enable(
     table->value_show_routine = value_show_routine;
 }
 
+#if !defined(TABLE__OPEN_ADDRESSING)
 // *Table__List* routines:
 
 /// @brief Append a (*hash*, *key*, *value*) triple to the end fo *table_list*.
@@ -524,3 +791,4 @@ void Table_List__show(Table_List table_list,
     }
     File__format(file, "\n");
 }
+#endif // !defined(TABLE__OPEN_ADDRESSING)
@@ -66,12 +66,17 @@ Tag Tag__create(Unsigned id, Map map) {
     Tag tag =  Memory__new(Tag);
     tag->twist = (Double)0.0;
     tag->arcs = List__new(); // <Arc>
+    tag->checksum = 0;
     tag->diagonal = 0.0;
     tag->hop_count = 0;
     tag->id = id;
     tag->initialized = (Logical)0;
     tag->map = map;
     tag->distance_per_pixel = Map__distance_per_pixel(map, id);
+    tag->svg_checksum = 0;
+    tag->svg_fragment = (String)0;
+    tag->update_arc = (Arc)0;
+    tag->update_changed = (Logical)0;
     tag->visit = map->visit;
     tag->x = (Double)0.0;
     tag->y = (Double)0.0;
@@ -122,6 +127,7 @@ void Tag__initialize(
     tag->x = x;
     tag->y = y;
     tag->visit = visit;
+    Map__checksum_tag(tag->map, tag);
 }
 
 /// @brief Read in an XML <Tag ...> from *in_file* using *map*.
@@ -132,17 +138,17 @@ void Tag__initialize(
 /// *Tag__read*() will read in an XML <Tag ...> from *in_file* using *map*
 /// for *Tag* assoiciations.  The resulting *Tag* is returned.
 
-Tag Tag__read(File in_file, Map map) {
+Tag Tag__read(File_Reader in_file, Map map) {
     // Read in "<Tag .../>":
-    File__tag_match(in_file, "Tag");
-    Unsigned tag_id = (Unsigned)File__integer_attribute_read(in_file, "Id");
-    Unsigned diagonal = File__float_attribute_read(in_file, "Diagonal");
-    Double twist = File__float_attribute_read(in_file, "Twist");
-    Double x = File__float_attribute_read(in_file, "X");
-    Double y = File__float_attribute_read(in_file, "Y");
+    File_Reader__tag_match(in_file, "Tag");
+    Unsigned tag_id = (Unsigned)File_Reader__integer_attribute_read(in_file, "Id");
+    Unsigned diagonal = File_Reader__float_attribute_read(in_file, "Diagonal");
+    Double twist = File_Reader__float_attribute_read(in_file, "Twist");
+    Double x = File_Reader__float_attribute_read(in_file, "X");
+    Double y = File_Reader__float_attribute_read(in_file, "Y");
     Unsigned hop_count =
-      (Unsigned)File__integer_attribute_read(in_file, "Hop_Count");
-    File__string_match(in_file, "/>\n");
+      (Unsigned)File_Reader__integer_attribute_read(in_file, "Hop_Count");
+    File_Reader__string_match(in_file, "/>\n");
 
     // Convert *twist* from *degrees_to_radians*:
     Double pi = (Double)3.14159265358979323846264;
@@ -206,23 +212,24 @@ void Tag__svg_write(Tag tag, SVG svg) {
     SVG__line(svg, x4, y4, x1, y1, bottom_edge);
 
     // Plot the id number:
-    //String id_text = String__format("%d", id);
     char id_text[20];
-    (void)sprintf(id_text, "%d", id);
+    (void)String__format_into(id_text, sizeof(id_text), "%d", id);
     SVG__text(svg, id_text, x, y, "ariel", 20);
-    //String__free(id_text);
 }
 
 
-/// @brief Updates the position and orientation of *tag* using *arc*.
+/// @brief Computes and writes the pose of *tag* from the far end of *arc*.
 /// @param tag to update.
-/// @param arc to use to find the arc to update from.
+/// @param arc to propagate the pose through.
+/// @returns true if the pose of *tag* changed.
 ///
-/// *Tag__update_via_arc*() will use the contents of *arc* to update
-/// the position and oritation of *tag*.  The position is computed using
-/// the "other" end of *arc*.
+/// *Tag__arc_propagate*() is the pose arithmetic of
+/// *Tag__update_via_arc*() with no announce callback and no checksum
+/// refresh.  It writes only *tag* and reads only the far end's pose, so
+/// the parallel propagation workers in *Map__update*() can run it
+/// concurrently on disjoint tags of one spanning tree level.
 
-void Tag__update_via_arc(Tag tag, Arc arc) {
+Logical Tag__arc_propagate(Tag tag, Arc arc) {
     // Some values to use for radian/degree conversion:
     Double pi = (Double)3.14159265358979323846264;
     Double r2d = 180.0 / pi;
@@ -276,20 +283,38 @@ void Tag__update_via_arc(Tag tag, Arc arc) {
     // If *to_tag* values are to change
     if (to_tag->twist != to_tag_twist ||
       to_tag->x != to_tag_x || to_tag->y != to_tag_y) {
-	// Let any interested party know that tag values changed.
-	Map map = to_tag->map;
-	map->tag_announce_routine(map->announce_object,
-	  to_tag->id, to_tag_x, to_tag_y, 0.0, to_tag_twist, 100.0, 100.0, 1.0);
-
 	// Load new values into *to_tag*:
 	to_tag->twist = to_tag_twist;
 	to_tag->x = to_tag_x;
 	to_tag->y = to_tag_y;
+	return (Logical)1;
     }
 
-
     //File__format(stderr, "To_Tag[id:%d x:%.2f y:%.2f tw:%.4f] angle=%.4f\n",
     //  to_tag->id, to_tag->x, to_tag->y, to_tag->twist * r2d, angle * r2d);
+    return (Logical)0;
+}
+
+/// @brief Updates the position and orientation of *tag* using *arc*.
+/// @param tag to update.
+/// @param arc to use to find the arc to update from.
+///
+/// *Tag__update_via_arc*() will use the contents of *arc* to update
+/// the position and oritation of *tag*.  The position is computed using
+/// the "other" end of *arc*.  Any change is announced through the map's
+/// tag announce routine.
+
+void Tag__update_via_arc(Tag tag, Arc arc) {
+    if (Tag__arc_propagate(tag, arc)) {
+	// Let any interested party know that tag values changed.
+	Map map = tag->map;
+	map->tag_announce_routine(map->announce_object,
+	  tag->id, tag->x, tag->y, 0.0, tag->twist, 100.0, 100.0, 1.0);
+    }
+
+    // Refresh the map checksum contribution of *tag* (this also
+    // captures the *hop_count* write the caller just made):
+    Map__checksum_tag(tag->map, tag);
 }
 
 /// @brief Writes *tag* out ot *out_file* in XML format.
@@ -341,17 +366,17 @@ Integer Tag_Height__compare(Tag_Height tag_height1, Tag_Height tag_height2)
 /// *xml_in_file* and return the resulting *Tag_Height* object.
 
 Tag_Height 
-Tag_Height__xml_read(File xml_in_file)
+Tag_Height__xml_read(File_Reader xml_in_file)
 {
     // Read in "<Tag_Height .../>":
-    File__tag_match(xml_in_file, "Tag_Height");
+    File_Reader__tag_match(xml_in_file, "Tag_Height");
     Unsigned first_id =
-      (Unsigned)File__integer_attribute_read(xml_in_file, "First_Id");
+      (Unsigned)File_Reader__integer_attribute_read(xml_in_file, "First_Id");
     Unsigned last_id =
-      (Unsigned)File__integer_attribute_read(xml_in_file, "Last_Id");
+      (Unsigned)File_Reader__integer_attribute_read(xml_in_file, "Last_Id");
     Double distance_per_pixel =
-       File__float_attribute_read(xml_in_file, "Distance_Per_Pixel");
-    File__string_match(xml_in_file, "/>\n");
+       File_Reader__float_attribute_read(xml_in_file, "Distance_Per_Pixel");
+    File_Reader__string_match(xml_in_file, "/>\n");
 
     // Load up *tag_height*:
     Tag_Height tag_height = Memory__new(Tag_Height);
@@ -1,42 +1,214 @@
 // Copyright (c) 2013 by Wayne C. Gramlich.  All rights reserved.
 
 #include <assert.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include "Codeword.h"
 #include "Double.h"
-#include "CRC.h"
-#include "FEC.h"
 #include "Logical.h"
+#include "Memory.h"
 #include "String.h"
 #include "SVG.h"
 #include "Unsigned.h"
 
+extern void SVG__tag_render(SVG svg, Codeword_Table codeword_table,
+  Unsigned tag_id, Double cell_width, Logical border);
 extern void SVG__tag_write(/* Extractor extractor, */
+  Codeword_Table codeword_table, String directory,
   Unsigned tag_id, Unsigned tag_size, Logical border);
 extern void SVG__tag_bit(SVG svg,
   Double cell_width, Unsigned row, Unsigned column, Logical border);
-extern void SVG__tag_write(/* Extractor extractor, */
-  Unsigned tag_id, Unsigned tag_size, Logical border);
+
+/// @brief The maximum number of tag generation worker threads.
+#define TAGS__WORKERS_MAXIMUM 16
+
+typedef struct Tags_Worker__Struct *Tags_Worker;
+
+/// @brief *Tags_Worker__Struct* is the per worker thread view of one
+/// batch generation run.  Every worker shares the (read only) codeword
+/// table and id list and strides through the ids starting at its own
+/// *worker_index*, so the workers cover disjoint ids without locking.
+/// Each tag gets its own buffered *SVG* writer, so the only file
+/// system traffic is one write per generated tag.
+struct Tags_Worker__Struct {
+    Logical border;
+    Codeword_Table codeword_table;
+    String directory;
+    Unsigned *ids;
+    Unsigned ids_size;
+    Unsigned tag_size;
+    pthread_t thread;
+    Unsigned worker_index;
+    Unsigned workers_size;
+};
+
+// *Tags__worker*() is the tag generation worker thread entry point:
+
+static void *Tags__worker(void *memory) {
+    Tags_Worker worker = (Tags_Worker)memory;
+    for (Unsigned index = worker->worker_index;
+      index < worker->ids_size; index += worker->workers_size) {
+	SVG__tag_write(worker->codeword_table, worker->directory,
+	  worker->ids[index], worker->tag_size, worker->border);
+    }
+    return (void *)0;
+}
+
+// *Tags__sheet_write*() renders every id in {ids} onto a single sheet
+// SVG named {sheet_base_name}.svg, laid out in a roughly square grid:
+
+static void Tags__sheet_write(Codeword_Table codeword_table,
+  String directory, String sheet_base_name, Unsigned *ids,
+  Unsigned ids_size, Unsigned tag_size, Logical border) {
+    Double cell_width = (Double)(tag_size) / 10.0;
+
+    // One tag footprint is 12 x 12 cells plus margin and label room:
+    Double x_pitch = 14.0 * cell_width;
+    Double y_pitch = 15.0 * cell_width;
+
+    // Pick a roughly square grid:
+    Unsigned columns = 1;
+    while (columns * columns < ids_size) {
+	columns += 1;
+    }
+    Unsigned rows = (ids_size + columns - 1) / columns;
+
+    char directory_base_name[256];
+    String base_name = sheet_base_name;
+    if (directory != (String)0) {
+	(void)String__format_into(directory_base_name,
+	  sizeof(directory_base_name), "%s/%s", directory, sheet_base_name);
+	base_name = directory_base_name;
+    }
+    SVG svg = SVG__open(base_name,
+      (Double)columns * x_pitch, (Double)rows * y_pitch, 1.0, 1.0, "mm");
+    assert (svg != (SVG)0);
+
+    // Render each tag at its grid cell by sliding the *svg* offsets:
+    for (Unsigned index = 0; index < ids_size; index++) {
+	svg->x_offset =
+	  5.0 + (Double)(index % columns) * x_pitch;
+	svg->y_offset =
+	  5.0 + cell_width + (Double)(index / columns) * y_pitch;
+	SVG__tag_render(svg, codeword_table, ids[index], cell_width, border);
+    }
+    SVG__close(svg);
+}
 
 int main(int arguments_size, char * arguments[]) {
     if (arguments_size <= 1) {
-        File__format(stderr, "Usage: tag_id...\n");
+        File__format(stderr,
+	  "Usage: Tags [-L] [-o directory] [-j threads] [-s sheet_name]\n");
+        File__format(stderr,
+	  "  tag_id... (each tag_id is either one id or first-last)\n");
+	return 0;
+    }
+
+    Logical border = 1;
+    String directory = (String)0;
+    String sheet_name = (String)0;
+    Unsigned tag_size = 160;
+    Unsigned workers_size = 1;
+
+    // First pass over the arguments: process the options, count the
+    // requested ids, and find the largest one so the codeword table
+    // can be sized to cover them all:
+    Unsigned ids_size = 0;
+    Unsigned table_size = 1;
+    for (Unsigned index = 1; index < arguments_size; index++) {
+	String tag_name = arguments[index];
+	if (String__equal(tag_name, "-L")) {
+	    tag_size = (Unsigned)(160.0 * 11.0 / 8.5);
+	} else if (String__equal(tag_name, "-o")) {
+	    assert (index + 1 < arguments_size);
+	    directory = arguments[++index];
+	} else if (String__equal(tag_name, "-j")) {
+	    assert (index + 1 < arguments_size);
+	    workers_size = String__to_unsigned(arguments[++index]);
+	    assert (workers_size >= 1);
+	    assert (workers_size <= TAGS__WORKERS_MAXIMUM);
+	} else if (String__equal(tag_name, "-s")) {
+	    assert (index + 1 < arguments_size);
+	    sheet_name = arguments[++index];
+	} else {
+	    // {tag_name} is either one tag id or a {first}-{last} range:
+	    Unsigned first = String__to_unsigned(tag_name);
+	    Unsigned last = first;
+	    char *dash = strchr(tag_name, '-');
+	    if (dash != (char *)0) {
+		last = String__to_unsigned(dash + 1);
+	    }
+	    assert (first <= last);
+	    ids_size += last - first + 1;
+	    if (last + 1 > table_size) {
+		table_size = last + 1;
+	    }
+	}
+    }
+
+    // Second pass: expand the ids and ranges into {ids}:
+    Unsigned *ids =
+      (Unsigned *)Memory__allocate(ids_size * sizeof(Unsigned));
+    Unsigned ids_index = 0;
+    for (Unsigned index = 1; index < arguments_size; index++) {
+	String tag_name = arguments[index];
+	if (String__equal(tag_name, "-o") || String__equal(tag_name, "-j") ||
+	  String__equal(tag_name, "-s")) {
+	    index += 1;
+	} else if (!String__equal(tag_name, "-L")) {
+	    Unsigned first = String__to_unsigned(tag_name);
+	    Unsigned last = first;
+	    char *dash = strchr(tag_name, '-');
+	    if (dash != (char *)0) {
+		last = String__to_unsigned(dash + 1);
+	    }
+	    for (Unsigned id = first; id <= last; id++) {
+		ids[ids_index++] = id;
+	    }
+	}
+    }
+    assert (ids_index == ids_size);
+
+    Codeword_Table codeword_table = Codeword_Table__create(table_size);
+    if (sheet_name != (String)0) {
+	// Sheet mode: all of the requested ids go onto one sheet SVG:
+	Tags__sheet_write(codeword_table, directory, sheet_name,
+	  ids, ids_size, tag_size, border);
     } else {
-	Logical border = 1;
-	Unsigned tag_size = 160;
-	for (Unsigned index = 1; index < arguments_size; index++) {
-	    String tag_name = arguments[index];
-	    if (String__equal(tag_name, "-L")) {
-	      tag_size = (Unsigned)(160.0 * 11.0 / 8.5);
-	    } else {
-		Unsigned tag_number = String__to_unsigned(tag_name);
-		//File__format(stdout,
-		//  "[%d]: '%s' %d\n", index, tag_name, tag_number);
-	        SVG__tag_write(tag_number, tag_size, border);
+	// One SVG per tag, fanned out across the worker threads:
+	struct Tags_Worker__Struct workers[TAGS__WORKERS_MAXIMUM];
+	if (workers_size > ids_size && ids_size >= 1) {
+	    workers_size = ids_size;
+	}
+	for (Unsigned index = 0; index < workers_size; index++) {
+	    Tags_Worker worker = &workers[index];
+	    worker->border = border;
+	    worker->codeword_table = codeword_table;
+	    worker->directory = directory;
+	    worker->ids = ids;
+	    worker->ids_size = ids_size;
+	    worker->tag_size = tag_size;
+	    worker->worker_index = index;
+	    worker->workers_size = workers_size;
+	    if (index == 0) {
+		continue;
 	    }
+	    assert (pthread_create(&worker->thread,
+	      (pthread_attr_t *)0, Tags__worker, (void *)worker) == 0);
+	}
+
+	// This thread doubles as worker 0; then collect the rest:
+	(void)Tags__worker((void *)&workers[0]);
+	for (Unsigned index = 1; index < workers_size; index++) {
+	    assert (pthread_join(workers[index].thread, (void **)0) == 0);
 	}
     }
+
+    Memory__free((Memory)ids);
+    Codeword_Table__free(codeword_table);
     return 0;
 }
 
@@ -106,46 +278,19 @@ void SVG__tag_bit(SVG svg,
     SVG__tag_bits(svg, cell_width, row, column, row, column, border);
 }
 
-// This routine will write out an SVG file for {tag_id} that is
-// {tag_size} millimeters square.  {border} specifies whether there
-// is a black line drawn around the "white" border of the tag.
-
-void SVG__tag_write(/* Extractor extractor, */
-  Unsigned tag_id, Unsigned tag_size, Logical border) {
+// This routine renders the tag for {tag_id} to {svg} at the current
+// {svg} offsets.  {cell_width} is the width of one tag cell in
+// millimeters and {border} specifies whether there is a black line
+// drawn around the "white" border of the tag.  The same routine
+// draws both the one-tag-per-file output and each cell of a sheet.
 
-    Double cell_width = (Double)(tag_size) / 10.0;
-    //Double offset = cell_width / 2.0;
-    Double offset = 5.0;
+void SVG__tag_render(SVG svg, Codeword_Table codeword_table,
+  Unsigned tag_id, Double cell_width, Logical border) {
     Double length = 10.0 * cell_width;
-    Double length_plus = length + 5.0 * cell_width;
 
-    // Open the file for writing:
-    String base_name = String__format("tag%d", tag_id);
-    SVG svg = SVG__open(base_name,
-      length + 3.0 * cell_width, length_plus, 1.0, 1.0, "mm");
-    assert (svg != (SVG)0);
-    svg->x_offset = offset;
-    svg->y_offset = offset + cell_width;
-
-    // Initialize {tag_bytes} to contain 8 bytes of 0:
-    Unsigned tag_bytes[8];
-    for (Unsigned index = 0; index < 8; index++) {
-	tag_bytes[index] = 0;
-    }
-
-    // Place the tag id into the tag id buffer.
-    Unsigned id = tag_id;
-    tag_bytes[1] = (id >> 8) & 0xff;
-    tag_bytes[0] = id & 0xff;
-
-    // Calculate the 16-bit CCITT CRC portion of the tag id buffer:
-    Unsigned crc = CRC__compute(tag_bytes, 2);
-    tag_bytes[3] = (crc >> 8) & 0xff;
-    tag_bytes[2] = crc & 0xff;
-
-    // Calculate the FEC portion of the tag id buffer:
-    FEC fec = FEC__create(8, 4, 4);
-    FEC__parity(fec, tag_bytes, 8);
+    // Grab the precomputed codeword (tag id, CCITT CRC, and FEC
+    // parity) for {tag_id}:
+    Unsigned *tag_bytes = Codeword_Table__fetch(codeword_table, tag_id);
 
     // Print a line border around everything:
     if (border) {
@@ -204,7 +349,8 @@ void SVG__tag_write(/* Extractor extractor, */
     }
 
     // Put some text on the page:
-    String tag_name = String__format("%d", tag_id);
+    char tag_name[20];
+    (void)String__format_into(tag_name, sizeof(tag_name), "%d", tag_id);
     if (border) {
 	SVG__text(svg, tag_name,
 	  6.0 * cell_width, 12.25 * cell_width,
@@ -214,9 +360,41 @@ void SVG__tag_write(/* Extractor extractor, */
 	  5.0 * cell_width, 12.25 * cell_width,
 	  "ariel", (Unsigned)(cell_width) / 2);
     }
-    String__free(tag_name);
+}
+
+// This routine will write out an SVG file for {tag_id} that is
+// {tag_size} millimeters square.  The file is named tag{tag_id}.svg
+// and lands in {directory} (or the current directory if {directory}
+// is null).  {border} specifies whether there is a black line drawn
+// around the "white" border of the tag.
+
+void SVG__tag_write(/* Extractor extractor, */
+  Codeword_Table codeword_table, String directory,
+  Unsigned tag_id, Unsigned tag_size, Logical border) {
+
+    Double cell_width = (Double)(tag_size) / 10.0;
+    //Double offset = cell_width / 2.0;
+    Double offset = 5.0;
+    Double length = 10.0 * cell_width;
+    Double length_plus = length + 5.0 * cell_width;
+
+    // Open the file for writing:
+    char base_name[256];
+    if (directory != (String)0) {
+	(void)String__format_into(base_name, sizeof(base_name),
+	  "%s/tag%d", directory, tag_id);
+    } else {
+	(void)String__format_into(base_name, sizeof(base_name),
+	  "tag%d", tag_id);
+    }
+    SVG svg = SVG__open(base_name,
+      length + 3.0 * cell_width, length_plus, 1.0, 1.0, "mm");
+    assert (svg != (SVG)0);
+    svg->x_offset = offset;
+    svg->y_offset = offset + cell_width;
 
-    // Close *svg*:
+    // Render the tag and flush it out with one write:
+    SVG__tag_render(svg, codeword_table, tag_id, cell_width, border);
     SVG__close(svg);
 }
 
@@ -1,12 +1,17 @@
 // Copyright (c) 2013 by Wayne C. Gramlich.  All rights reserved.
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <assert.h>
+#include <time.h>
 
 #include "Character.h"
 #include "CV.h"
+#include "Double.h"
 #include "File.h"
 #include "High_GUI2.h"
 #include "Integer.h"
+#include "Logical.h"
 #include "String.h"
 #include "Unsigned.h"
 
@@ -18,9 +23,41 @@
 /// *main*() opens a camera (or video file) and allows the user to capture
 /// images by typing the [space] key.
 
+// This routine grabs and decodes the next frame for the decode-ahead
+// reader.  *cvQueryFrame*() reuses one internal buffer, so the frame
+// is snapshotted before it is queued:
+
+static CV_Image Video_Capture__frame_read(void *object) {
+    CV_Capture capture = (CV_Capture)object;
+    CV_Image frame = CV_Capture__query_frame(capture);
+    if (frame != (CV_Image)0) {
+	frame = CV__clone_image(frame);
+    }
+    return frame;
+}
+
+// The frame skip governor: when the video loop runs longer than one
+// camera period, frames queue behind the decode-ahead reader and the
+// display falls ever further behind reality.  The governor estimates
+// the camera period from the fetch-to-fetch intervals -- when the loop
+// keeps up, each fetch blocks until the next frame is captured, so the
+// smallest intervals track the true period -- and after a slow pass
+// drains the stale queued frames, so the next displayed frame is the
+// newest one.  Only live cameras are governed; a video file should be
+// consumed frame by frame.
+
+// *Video_Capture__now*() returns the monotonic clock in seconds:
+
+static Double Video_Capture__now(void) {
+    struct timespec now;
+    assert (clock_gettime(CLOCK_MONOTONIC, &now) == 0);
+    return (Double)now.tv_sec + (Double)now.tv_nsec * 1e-9;
+}
+
 int main(int arguments_size, char * arguments[]) {
     CV_Capture capture = (CV_Capture)0;
     String capture_base_name = "video_capture";
+    Logical live = (Logical)0;
 
     if (arguments_size <= 1) {
 	// No arguments; let the user know the usage:
@@ -51,6 +88,7 @@ int main(int arguments_size, char * arguments[]) {
 	      CV_Capture__property_frame_width, (Double)640);
 	    CV_Capture__set_property(capture,
 	      CV_Capture__property_frame_height, (Double)480);
+	    live = (Logical)1;
 	} else {
 	    // Open a video file format:
 	    capture = CV_Capture__create_file(argument1);
@@ -68,17 +106,45 @@ int main(int arguments_size, char * arguments[]) {
     String window_name = "Video_Capture";
     CV__named_window(window_name, CV__window_auto_size);
 
+    // A decode-ahead reader thread keeps a few decoded frames queued in
+    // front of the video loop, so the loop is never gated on the codec:
+    CV_Image_Reader image_reader =
+      CV_Image_Reader__create((void *)capture, Video_Capture__frame_read);
+
+    // Frame skip governor state (see *Video_Capture__now*() above).
+    // *governor_debt* carries the fractional backlog, so a loop
+    // running at (say) 1.5x the camera period still skips every other
+    // frame instead of rounding its backlog down to zero forever:
+    Double governor_debt = 0.0;
+    Double governor_period = 0.0;
+    Unsigned governor_skips = 0;
+    Double previous_arrival = 0.0;
+
     // Do a video loop:
     Unsigned capture_number = 0;
     while (1) {
-        // Grab a frame from the video source:
-	CV_Image frame = CV_Capture__query_frame(capture);
+        // Grab the next prefetched frame:
+	CV_Image frame = CV_Image_Reader__fetch(image_reader);
 	if (frame == (CV_Image)0) {
 	    // When *frame* is null, the video source is at end-of-file
 	    // or disconnected:
 	    break;
 	}
-	
+
+	// Fold the arrival interval into the governor's camera period
+	// estimate, drifting slowly upward so a camera that slows down
+	// is tracked too:
+	Double arrival = Video_Capture__now();
+	if (previous_arrival > 0.0) {
+	    Double interval = arrival - previous_arrival;
+	    if (governor_period == 0.0 || interval < governor_period) {
+		governor_period = interval;
+	    } else {
+		governor_period += (interval - governor_period) * 0.05;
+	    }
+	}
+	previous_arrival = arrival;
+
 	// Show the image:
 	CV_Image__show(frame, window_name);
 
@@ -86,19 +152,63 @@ int main(int arguments_size, char * arguments[]) {
 	Character character = CV__wait_key(33);
 	if (character == '\033') {
 	    // [Esc] key causes program to escape:
+	    CV__release_image(frame);
 	    break;
 	} else if (character == ' ') {
 	    // Write out image out to file system as a .tga file:
-	    String file_name =
-	      String__format("%s-%02d.pnm", capture_base_name, capture_number);
+	    char file_name[256];
+	    (void)String__format_into(file_name, sizeof(file_name),
+	      "%s-%02d.pnm", capture_base_name, capture_number);
 	    CV_Image__pnm_write(frame, file_name);
 	    File__format(stderr, "Wrote frame out to file '%s'\n", file_name);
 	    capture_number += 1;
-	    String__free(file_name);
 	}
+
+	// The frame is a private snapshot; release it:
+	CV__release_image(frame);
+
+	// Frame skip governor (live cameras only): when this pass ran
+	// longer than the camera period, drain the stale frames that
+	// queued behind the reader, so the next displayed frame is
+	// the newest one:
+	Double frame_seconds = Video_Capture__now() - arrival;
+	if (live && governor_period > 0.0 &&
+	  frame_seconds > governor_period) {
+	    governor_debt += frame_seconds / governor_period - 1.0;
+	    Unsigned behind = (Unsigned)governor_debt;
+	    if (behind > 8) {
+		behind = 8;
+	    }
+	    governor_debt -= (Double)behind;
+	    Unsigned skipped = 0;
+	    for (Unsigned skip = 0; skip < behind; skip++) {
+		CV_Image stale_frame =
+		  CV_Image_Reader__try_fetch(image_reader);
+		if (stale_frame == (CV_Image)0) {
+		    break;
+		}
+		CV__release_image(stale_frame);
+		skipped += 1;
+	    }
+	    if (skipped > 0) {
+		governor_skips += skipped;
+
+		// The next arrival interval is distorted by the
+		// discards; keep it out of the estimate:
+		previous_arrival = 0.0;
+	    }
+	} else {
+	    // A frame that kept up pays off any leftover debt:
+	    governor_debt = 0.0;
+	}
+    }
+    if (governor_skips > 0) {
+	File__format(stderr,
+	  "Governor skipped %d stale frame(s)\n", governor_skips);
     }
 
     // Clean up and leave:
+    CV_Image_Reader__free(image_reader);
     CV_Capture__release(capture);
     CV__destroy_window(window_name);
 
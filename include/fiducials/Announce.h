@@ -0,0 +1,42 @@
+// Copyright (c) 2013 by Wayne C. Gramlich.  All rights reserved.
+
+#if !defined(ANNOUNCE_H_INCLUDED)
+#define ANNOUNCE_H_INCLUDED 1
+
+#include "Double.h"
+#include "Integer.h"
+#include "Unsigned.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// @brief *Announce_Queue* is a fixed-size lock-free single-producer/
+/// single-consumer ring that decouples the detection thread from slow
+/// announce consumers (the structure itself is private to Announce.c.)
+typedef struct Announce_Queue__Struct *Announce_Queue;
+
+/// @brief The publisher callback for location announcements (the same
+/// signature as *Fiducials_Location_Announce_Routine*.)
+typedef void (*Announce_Location_Routine)(void *object, Integer id,
+  Double x, Double y, Double z, Double bearing);
+
+/// @brief The publisher callback for tag pose announcements (the same
+/// signature as *Fiducials_Tag_Announce_Routine* and
+/// *Map_Tag_Announce_Routine*.)
+typedef void (*Announce_Tag_Routine)(void *object, Integer id,
+  Double x, Double y, Double z, Double twist, Double dx, Double dy, Double dz);
+
+// External declarations:
+extern Announce_Queue Announce_Queue__create(void *publish_object,
+  Announce_Location_Routine location_routine, Announce_Tag_Routine tag_routine);
+extern void Announce_Queue__free(Announce_Queue announce_queue);
+extern void Announce_Queue__location_announce(void *object, Integer id,
+  Double x, Double y, Double z, Double bearing);
+extern void Announce_Queue__tag_announce(void *object, Integer id,
+  Double x, Double y, Double z, Double twist, Double dx, Double dy, Double dz);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // !defined(ANNOUNCE_H_INCLUDED)
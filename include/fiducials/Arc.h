@@ -60,19 +60,23 @@ extern "C" {
 struct Arc__Struct {
     /// @brief The angle in radians from the *origin* center parallel to the
     /// bottom edge to the line that connects the *origin* and *target* centers.
-    Double angle;
+    Fiducials_Real angle;
+
+    /// @brief This arc's current contribution to the incremental map
+    /// checksum (see *Map__checksum_arc*().)
+    Unsigned checksum;
 
     /// @brief The distance between the *from* and *to*.
-    Double distance;
+    Fiducials_Real distance;
 
     /// @brief The from *Tag*.
     Tag from_tag;
 
     /// @brief The amount *from_tag* is twisted from distance line segment.
-    Double from_twist;
+    Fiducials_Real from_twist;
 
     /// @brief Distance between camera center and line connecting both tags.
-    Double goodness;
+    Fiducials_Real goodness;
 
     /// @brief Set to true if this *Arc* is part of the map tree.
     Logical in_tree;
@@ -81,7 +85,7 @@ struct Arc__Struct {
     Tag to_tag;
 
     /// @brief The amount *to_tag* is twisted from distance line segment.
-    Double to_twist;
+    Fiducials_Real to_twist;
 
     /// @brief The visit number for the arc.
     Unsigned visit;
@@ -96,7 +100,7 @@ extern Arc Arc__create(Tag from_tag, Double from_twist,
   Double distance, Tag to_tag, Double to_twist, Double goodness);
 extern Arc Arc__new(void);
 extern Unsigned Arc__hash(Arc arc);
-extern Arc Arc__read(File out_file, Map map);
+extern Arc Arc__read(File_Reader in_file, Map map);
 extern void Arc__svg_write(Arc arc, SVG svg);
 extern void Arc__update(
   Arc arc, Double distance, Double angle, Double twist, Double goodness);
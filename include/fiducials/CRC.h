@@ -3,12 +3,16 @@
 #if !defined(CRC_H_INCLUDED)
 #define CRC_H_INCLUDED 1
 
+#include "Memory.h"
 #include "Unsigned.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
+extern Unsigned CRC__begin(void);
 extern Unsigned CRC__compute(Unsigned *buffer, Unsigned size);
+extern Unsigned CRC__finish(Unsigned crc);
+extern Unsigned CRC__update(Unsigned crc, Memory buffer, Unsigned size);
 #ifdef __cplusplus
 }
 #endif
@@ -17,6 +17,18 @@ extern "C" {
 #endif
 typedef CvContour *CV_Contour;
 typedef IplImage *CV_Image;
+
+/// @brief *CV_Image_Dumper* is a double buffered background image
+/// writer (the structure itself is private to CV.c.)
+typedef struct CV_Image_Dumper__Struct *CV_Image_Dumper;
+
+/// @brief *CV_Image_Reader* is a background decode-ahead frame reader
+/// (the structure itself is private to CV.c.)
+typedef struct CV_Image_Reader__Struct *CV_Image_Reader;
+
+/// @brief *CV_Image_Reader_Read_Routine* decodes and returns the next
+/// frame from a reader's source, or null when the source is exhausted.
+typedef CV_Image (*CV_Image_Reader_Read_Routine)(void *object);
 typedef CvMat *CV_Matrix;
 typedef CvMemStorage *CV_Memory_Storage;
 typedef CvPoint *CV_Point;
@@ -39,6 +51,7 @@ extern Integer CV__rgb_to_gray;
 extern Integer CV__thresh_binary;
 extern Integer CV__window_auto_size;
 
+extern CV_Image CV__clone_image(CV_Image image);
 extern Integer CV__round(Double value);
 extern Integer CV__undistortion_setup(const char * calibrate_file_name,
   Integer width, Integer height, CV_Image *mapx, CV_Image *mapy);
@@ -55,8 +68,12 @@ extern void CV_Image__copy(
   CV_Image source_image, CV_Image destination_image, CV_Image mask);
 extern CV_Image CV_Image__create(
   CV_Size size, Unsigned depth, Unsigned channels);
+extern CV_Image CV_Image__create_aligned(
+  CV_Size size, Unsigned depth, Unsigned channels);
 extern CV_Image CV_Image__header_create(
   CV_Size size, Unsigned depth, Unsigned channels);
+extern void CV_Image__decimate(
+  CV_Image source_image, CV_Image destination_image, Integer scale);
 extern void CV_Image__cross_draw(
   CV_Image image, Integer x, Integer y, CV_Scalar color);
 extern void CV_Image__draw_contours(CV_Image image, CV_Sequence contour,
@@ -70,15 +87,32 @@ extern void CV_Image__find_corner_sub_pix(CV_Image image,
   CV_Size zero_zone, CV_Term_Criteria criteria);
 extern void CV_Image__flip(
   CV_Image from_image, CV_Image to_image, Integer flip_code);
+extern void CV_Image__fused_gray_threshold(CV_Image source_image,
+  CV_Image gray_image, CV_Image destination_image,
+  Integer block_size, Double offset, Unsigned *integral);
 extern Integer CV_Image__gray_fetch(CV_Image image, Integer x, Integer y);
 extern Integer CV_Image__height_get(CV_Image image);
+extern void CV_Image__integrals_compute(
+  CV_Image image, Unsigned *sums, Double *squares);
 extern Integer CV_Image__points_maximum(CV_Image image,
   CV_Point2D32F_Vector points, Unsigned start_index, Unsigned end_index);
 extern Integer CV_Image__points_minimum(CV_Image image,
   CV_Point2D32F_Vector points, Unsigned start_index, Unsigned end_index);
 extern Integer CV_Image__point_sample(CV_Image image, CV_Point2D32F point);
+extern void CV_Image__points_sample(CV_Image image,
+  CV_Point2D32F_Vector points, Unsigned size,
+  Integer *weights, Integer *values);
 extern void CV_Image__remap(CV_Image source_image, CV_Image destination_image,
   CV_Image map_x, CV_Image map_y, Integer flags, CV_Scalar fill_value);
+extern void CV_Image__remap_lut(CV_Image source_image,
+  CV_Image destination_image, Integer *lut, CV_Scalar fill_value);
+extern Integer *CV_Image__remap_lut_create(
+  CV_Image map_x, CV_Image map_y, CV_Image source_image);
+extern void CV_Image__roi_reset(CV_Image image);
+extern Memory CV_Image__row_fetch(CV_Image image, Integer y);
+extern Integer CV_Image__stride_get(CV_Image image);
+extern void CV_Image__roi_set(CV_Image image,
+  Integer x, Integer y, Integer width, Integer height);
 extern Integer CV_Image__save(
   CV_Image image, const char * file_name, Integer *parameters);
 extern void CV_Image__smooth(CV_Image source_image, CV_Image destination_image,
@@ -90,6 +124,18 @@ extern CV_Image CV_Image__tga_read(CV_Image image, const char * file_name);
 extern void CV_Image__tga_write(CV_Image image, const char * file_name);
 extern Integer CV_Image__width_get(CV_Image image);
 
+extern CV_Image_Dumper CV_Image_Dumper__create(void);
+extern Unsigned CV_Image_Dumper__dropped_get(CV_Image_Dumper dumper);
+extern void CV_Image_Dumper__free(CV_Image_Dumper dumper);
+extern Logical CV_Image_Dumper__submit(
+  CV_Image_Dumper dumper, CV_Image image, const char * file_name);
+
+extern CV_Image_Reader CV_Image_Reader__create(
+  void *object, CV_Image_Reader_Read_Routine read_routine);
+extern CV_Image CV_Image_Reader__fetch(CV_Image_Reader reader);
+extern CV_Image CV_Image_Reader__try_fetch(CV_Image_Reader reader);
+extern void CV_Image_Reader__free(CV_Image_Reader reader);
+
 extern Integer CV__term_criteria_iterations;
 extern Integer CV__term_criteria_eps;
 extern CV_Term_Criteria CV_Term_Criteria__create(
@@ -100,7 +146,9 @@ extern CV_Memory_Storage CV_Memory_Storage__create(Integer block_size);
 
 extern CV_Point CV_Point__create(Integer x, Integer y);
 extern Integer CV_Point__y_get(CV_Point point);
+extern void CV_Point__y_set(CV_Point point, Integer y);
 extern Integer CV_Point__x_get(CV_Point point);
+extern void CV_Point__x_set(CV_Point point, Integer x);
 
 extern void CV_Point2D32F_Vector__corners_normalize(
   CV_Point2D32F_Vector corners);
@@ -124,6 +172,8 @@ extern CV_Sequence CV_Sequence__approximate_polygon(CV_Sequence contour,
   Integer parameter1, Double parameter2);
 extern Double CV_Sequence__arc_length(
  CV_Sequence contour, CV_Slice slice, Integer is_closed);
+extern void CV_Sequence__bounding_rectangle(CV_Sequence contour,
+  Integer *x, Integer *y, Integer *width, Integer *height);
 extern Logical CV_Sequence__check_contour_convexity(CV_Sequence contour);
 extern Double CV_Sequence__contour_area(
   CV_Sequence contour, CV_Slice slice, Integer oriented);
@@ -18,7 +18,7 @@ extern "C" {
 /// a camera frame.
 struct Camera_Tag__Struct {
     /// @brief The average diagonal of the tag measured in camera pixels.
-    Double diagonal;
+    Fiducials_Real diagonal;
 
     /// @brief The direction (0-3) that matched the fiducial tag.
     Unsigned direction;
@@ -28,13 +28,13 @@ struct Camera_Tag__Struct {
 
     /// @brief The amount the fiducial tag is twisted from the camera x axis
     /// measured in radians.
-    Double twist;
+    Fiducials_Real twist;
 
     /// @brief The X coordinate of the fiducial tag center in camera pixels.
-    Double x;
+    Fiducials_Real x;
 
     /// @brief The Y coordinate of the fiducial tag center in camera pixels.
-    Double y;
+    Fiducials_Real y;
 };
 
 // *Camera_Tag* routines:
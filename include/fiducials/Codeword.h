@@ -0,0 +1,58 @@
+// Copyright (c) 2013 by Wayne C. Gramlich.  All rights reserved.
+
+#if !defined(CODEWORD_H_INCLUDED)
+#define CODEWORD_H_INCLUDED 1
+
+/// @brief *Codeword_Table* is a precomputed table of complete tag
+/// codewords.
+typedef struct Codeword_Table__Struct *Codeword_Table;
+
+#include "Logical.h"
+#include "Unsigned.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// @brief The number of bytes in one complete tag codeword (2 bytes of
+/// tag id, 2 bytes of CCITT CRC, and 4 bytes of Reed-Solomon parity.)
+#define CODEWORD__SIZE 8
+
+/// @brief *Codeword_Table__Struct* holds the complete codeword for
+/// every tag id below *ids_size*, plus an open addressed hash that maps
+/// a raw sampled codeword back to its tag id in one probe.
+///
+/// The encode side (Tags) indexes *bytes* directly instead of redoing
+/// the CRC and Reed-Solomon parity computations for every rendered tag.
+/// The decode side probes the hash with the raw sampled bytes; an exact
+/// hit identifies a pristine read without touching the Reed-Solomon
+/// correction machinery at all, and a miss simply falls back to the
+/// usual FEC/CRC path, so the table never has to cover the full 16-bit
+/// id space to be correct.
+struct Codeword_Table__Struct {
+    /// @brief *bytes* + id * *CODEWORD__SIZE* is the codeword for id.
+    Unsigned *bytes;
+
+    /// @brief Open addressed hash buckets holding tag id + 1 (0 is empty.)
+    Unsigned *hash_buckets;
+
+    /// @brief The size of *hash_buckets* minus 1 (a power of 2 minus 1.)
+    Unsigned hash_mask;
+
+    /// @brief The number of tag ids covered by the table.
+    Unsigned ids_size;
+};
+
+// External declarations:
+
+extern Codeword_Table Codeword_Table__create(Unsigned ids_size);
+extern Unsigned *Codeword_Table__fetch(
+  Codeword_Table codeword_table, Unsigned id);
+extern void Codeword_Table__free(Codeword_Table codeword_table);
+extern Logical Codeword_Table__lookup(
+  Codeword_Table codeword_table, Unsigned *codeword, Unsigned *tag_id);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // !defined(CODEWORD_H_INCLUDED)
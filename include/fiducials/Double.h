@@ -11,6 +11,20 @@ extern "C" {
 #endif
 /// @brief *Double* is a double precision (64-bits) floating point number.
 typedef double Double;
+
+/// @brief *Fiducials_Real* is the numeric type used for stored map
+/// geometry (the *Tag*, *Arc*, and *Camera_Tag* coordinate fields.)
+/// It defaults to *Double*; building with -DFIDUCIALS__REAL_FLOAT=1
+/// (CMake option FIDUCIALS_REAL_FLOAT) stores the geometry as 32-bit
+/// floats instead, halving the map memory footprint.  Camera corner
+/// positions carry well under single float precision, so the map
+/// accuracy is unaffected.
+#if defined(FIDUCIALS__REAL_FLOAT)
+typedef float Fiducials_Real;
+#else
+typedef double Fiducials_Real;
+#endif
+
 // *Double* routines:
 
 extern Double Double__absolute(Double value);
@@ -84,6 +84,8 @@ rvInt16 rvFec_Correct(rvFec* self, rvUint8* blockBuffer);
 // External declarations:
 
 Logical FEC__correct(FEC fec, Unsigned *data, Unsigned size);
+Unsigned FEC__correct_batch(FEC fec,
+  Unsigned *codewords, Unsigned codewords_size, Unsigned codeword_size);
 void FEC__parity(FEC fec, Unsigned *data, Unsigned size);
 FEC FEC__create(Unsigned symbol_size, Unsigned data_size, Unsigned parity_size);
 
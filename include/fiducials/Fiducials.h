@@ -8,8 +8,10 @@ typedef struct Fiducials__Struct *Fiducials;
 #include <assert.h>
 #include <sys/time.h>
 
+#include "Bounding_Box.h"
 #include "Camera_Tag.h"
 #include "Character.h"
+#include "Codeword.h"
 #include "CRC.h"
 #include "CV.h"
 #include "Double.h"
@@ -34,65 +36,276 @@ typedef void (*Fiducials_Tag_Announce_Routine)(void *object, Integer id,
   Double x, Double y, Double z, Double twist, Double dx, Double dy, Double dz);
 typedef Logical Mapping[64];
 typedef struct timeval *Time_Value;
+typedef struct Fiducials_Backend__Struct *Fiducials_Backend;
+typedef struct Fiducials_Candidate__Struct *Fiducials_Candidate;
+typedef struct Fiducials_Decode__Struct *Fiducials_Decode;
+typedef struct Fiducials_Prior__Struct *Fiducials_Prior;
+typedef struct Fiducials_Stats__Struct *Fiducials_Stats;
+
+/// @brief The maximum number of decode worker threads.
+#define FIDUCIALS__DECODE_THREADS_MAXIMUM 16
+
+/// @brief The number of tag ids covered by the precomputed codeword
+/// table (deployments use well under 4096 ids; reads of an uncovered
+/// id still decode through the FEC/CRC fallback path.)
+#define FIDUCIALS__CODEWORD_IDS_SIZE 4096
+
+/// @brief *Fiducials_Backend_Process_Routine* runs the fixed-function
+/// remap + adaptive threshold stages as one unit.  *converted_image* is
+/// the gray converted camera frame; the routine must leave the
+/// (optionally undistorted) gray frame in *gray_image* and the
+/// thresholded result in *edge_image*.  *remap_lut* is null when no
+/// undistortion is configured, in which case *converted_image* and
+/// *gray_image* are the same image.  *block_size* (odd) and *offset*
+/// are the current adaptive threshold parameters; the auto-tuner can
+/// change them between frames.
+typedef void (*Fiducials_Backend_Process_Routine)(void *object,
+  CV_Image converted_image, CV_Image gray_image, CV_Image edge_image,
+  Integer *remap_lut, CV_Scalar fill_color,
+  Integer block_size, Double offset);
+
+/// @brief *Fiducials_Backend__Struct* abstracts the fixed-function
+/// remap and adaptive threshold stages of *Fiducials__process*() behind
+/// one handoff, so an accelerator backend can keep the frame resident
+/// on the device across both stages.  The gray image must still be
+/// materialized because the decode phase samples it on the CPU.
+struct Fiducials_Backend__Struct {
+    /// @brief Short backend name for diagnostics (e.g. "cpu".)
+    String name;
+
+    /// @brief Opaque backend state passed to *process_routine*.
+    void *object;
+
+    /// @brief Runs the remap + threshold stages.
+    Fiducials_Backend_Process_Routine process_routine;
+};
+
+/// @brief *Fiducials_Candidate__Struct* records one 4-sided candidate quad
+/// harvested from the contour sweep.  The decode phase fills in the
+/// remaining fields.
+struct Fiducials_Candidate__Struct {
+    /// @brief The 4 corner X coordinates (raw, then sub-pixel refined.)
+    Double corner_xs[4];
+
+    /// @brief The 4 corner Y coordinates (raw, then sub-pixel refined.)
+    Double corner_ys[4];
+
+    /// @brief The mapping direction index that decoded (valid if *matched*.)
+    Unsigned direction;
+
+    /// @brief True if the candidate decoded into a valid tag.
+    Logical matched;
+
+    /// @brief Index + 1 of the matching prior frame tag in *priors*
+    /// (0 when no prior frame tag overlaps this quad.)
+    Unsigned prior;
+
+    /// @brief The decoded tag identifier (valid if *matched*.)
+    Unsigned tag_id;
+};
+
+/// @brief *Fiducials_Prior__Struct* remembers one tag decoded in the
+/// previous frame: its refined (counter-clockwise normalized) corners
+/// and the mapping direction that decoded.  A candidate quad that
+/// overlaps a prior seeds the sub-pixel refiner with the prior corners
+/// and first tries only the prior direction, skipping the 4-direction
+/// trial decode in the (common) case where the tag has barely moved.
+struct Fiducials_Prior__Struct {
+    /// @brief The 4 refined corner X coordinates from the prior frame.
+    Double corner_xs[4];
+
+    /// @brief The 4 refined corner Y coordinates from the prior frame.
+    Double corner_ys[4];
+
+    /// @brief The mapping direction index that decoded.
+    Unsigned direction;
+
+    /// @brief The decoded tag identifier.
+    Unsigned tag_id;
+};
+
+/// @brief *Fiducials_Decode__Struct* is the per-worker scratch storage
+/// used while decoding candidate quads.  Each decode worker thread gets
+/// its own copy so that they do not trample on one another.
+struct Fiducials_Decode__Struct {
+    CV_Point2D32F_Vector corners;
+    Logical debugging;
+    Fiducials fiducials;
+    CV_Point2D32F_Vector references;
+    CV_Point2D32F_Vector sample_points;
+    Logical tag_bits[64];
+    Unsigned worker_index;
+};
+
+/// @brief *Fiducials_Stats__Struct* accumulates per stage timing and
+/// event counters for the detection pipeline.  All times are in seconds
+/// measured with the monotonic clock and accumulate across frames until
+/// *Fiducials__stats_reset*() is called.  When the fused kernel is
+/// active its single pass is charged to *threshold_seconds*.  ROI
+/// tracking and pyramid frames charge their (smaller) threshold and
+/// contour work to the same accumulators.
+struct Fiducials_Stats__Struct {
+    /// @brief Seconds spent in the camera tag pair Map__arc_update sweep.
+    Double arc_seconds;
+
+    /// @brief Number of candidate quads tried by the decode phase.
+    Unsigned candidates;
+
+    /// @brief Seconds spent finding contours and harvesting quads.
+    Double contour_seconds;
+
+    /// @brief Number of contours swept by the quad harvester.
+    Unsigned contours;
+
+    /// @brief Seconds spent converting the camera image to gray scale.
+    Double convert_seconds;
+
+    /// @brief Seconds spent refining, sampling and FEC/CRC decoding.
+    Double decode_seconds;
+
+    /// @brief Number of frames processed.
+    Unsigned frames;
+
+    /// @brief Seconds spent in Map__update.
+    Double map_update_seconds;
+
+    /// @brief Seconds spent in the undistortion remap.
+    Double remap_seconds;
+
+    /// @brief Number of stale camera frames the capture loop's frame
+    /// skip governor discarded (incremented by the capture loop, not
+    /// by *Fiducials__process*().)
+    Unsigned skips;
+
+    /// @brief Number of tags successfully decoded.
+    Unsigned tags;
+
+    /// @brief Seconds spent in the adaptive threshold.
+    Double threshold_seconds;
+};
 
 struct Fiducials__Struct {
     void *announce_object;
+    Fiducials_Backend backend;
     CV_Scalar black;
     CV_Scalar blue;
     Logical blur;
     List /* <Camera_Tag> */ camera_tags;
     List /* <Camera_Tag> */ camera_tags_pool;
+    Fiducials_Candidate candidates;
+    Unsigned candidates_limit;
+    Unsigned candidates_size;
+    Codeword_Table codeword_table;
+    Unsigned contour_count;
+    Unsigned contour_reject_count;
     CV_Point2D32F_Vector corners;
+    Unsigned decode_threads;
+    Fiducials_Decode *decodes;
+    Logical early_reject;
     CV_Scalar cyan;
     CV_Image debug_image;
     Unsigned debug_index;
     CV_Image edge_image;
     FEC fec;
+    Memory_Arena frame_arena;
+    Logical fuse;
+    Unsigned *fused_integral;
+    Unsigned fused_integral_size;
     CV_Image gray_image;
     CV_Scalar green;
+    Logical headless;
+    Unsigned integral_size;
+    Double *integral_squares;
+    Unsigned *integral_sums;
+    Logical integral_valid;
     Fiducials_Location_Announce_Routine location_announce_routine;
+    Location location_latest;
     List /*<Location>*/ locations;
+    Unsigned locations_head;
+    Unsigned locations_limit;
+    List /*<Location>*/ locations_pool;
     Map map;
     CV_Point origin;
     CV_Image original_image;
     Logical **mappings;
     CV_Image map_x;
     CV_Image map_y;
+    Fiducials_Prior priors;
+    Unsigned priors_limit;
+    Unsigned priors_size;
     CV_Scalar purple;
+    CV_Image pyramid_edge_image;
+    CV_Image pyramid_gray_image;
+    Unsigned pyramid_scale;
     CV_Scalar red;
     CV_Point2D32F_Vector references;
+    Integer *remap_lut;
     CV_Point2D32F_Vector sample_points;
     CV_Size size_5x5;
     CV_Size size_m1xm1;
+    struct Fiducials_Stats__Struct stats;
     CV_Memory_Storage storage;
     Fiducials_Tag_Announce_Routine tag_announce_routine;
     Logical tag_bits[64];	// FIXME: Make this Logical *tag_bits;
+    Logical temporal;
     CV_Image temporary_gray_image;
     CV_Term_Criteria term_criteria;
+    Integer threshold_block_size;
+    Double threshold_offset;
+    List /* <Bounding_Box> */ track_boxes;
+    List /* <Bounding_Box> */ track_boxes_pool;
+    Logical track_enable;
+    Unsigned track_frame;
+    Unsigned track_interval;
+    CV_Point track_origin;
+    Logical tune;
+    Integer tune_streak;
     Unsigned weights_index;
     Logical y_flip;
 };
 
 extern void Fiducials__location_announce(void *object, Integer id,
   Double x, Double y, Double z, Double bearing);
+extern Location Fiducials__location_latest(Fiducials fiducials);
+extern void Fiducials__locations_limit_set(
+  Fiducials fiducials, Unsigned locations_limit);
 extern void Fiducials__sample_points_compute(
   CV_Point2D32F_Vector corners, CV_Point2D32F_Vector sample_points);
 extern CV_Point2D32F_Vector Fiducials__references_compute(
   Fiducials fiducials, CV_Point2D32F_Vector corners);
+extern void Fiducials__backend_set(
+  Fiducials fiducials, Fiducials_Backend backend);
 extern Fiducials Fiducials__create(
   CV_Image original_image, const char * lens_calibrate_file_name,
   void *announce_object,
   Fiducials_Location_Announce_Routine location_announce_routine,
   Fiducials_Tag_Announce_Routine tag_announce_routine);
+extern void Fiducials__decode_threads_set(
+  Fiducials fiducials, Unsigned decode_threads);
+extern void Fiducials__early_reject_set(
+  Fiducials fiducials, Logical early_reject);
+extern void Fiducials__fuse_set(Fiducials fiducials, Logical fuse);
+extern void Fiducials__headless_set(Fiducials fiducials, Logical headless);
 extern void Fiducials__image_set(Fiducials fiducials, CV_Image image);
 extern void Fiducials__image_show(Fiducials fiducials, Logical show);
 extern Unsigned Fiducials__process(Fiducials fiducials);
+extern void Fiducials__pyramid_set(
+  Fiducials fiducials, Unsigned pyramid_scale);
+extern Fiducials Fiducials__share(Fiducials primary,
+  CV_Image original_image, const char * lens_calibrate_file_name,
+  void *announce_object,
+  Fiducials_Location_Announce_Routine location_announce_routine);
 extern Integer Fiducials__point_sample(
   Fiducials fiducials, CV_Point2D32F point);
 extern void Fiducials__sample_points_helper(
   String label, CV_Point2D32F corner, CV_Point2D32F sample_point);
+extern Fiducials_Stats Fiducials__stats_get(Fiducials fiducials);
+extern void Fiducials__stats_reset(Fiducials fiducials);
 extern void Fiducials__tag_heights_xml_read(
   Fiducials fiducials, const char * xml_file_name);
+extern void Fiducials__temporal_set(Fiducials fiducials, Logical temporal);
+extern void Fiducials__tracking_set(Fiducials fiducials, Logical track_enable);
+extern void Fiducials__tune_set(Fiducials fiducials, Logical tune);
 extern Integer Fiducials__points_maximum(Fiducials fiducials,
   CV_Point2D32F_Vector points, Unsigned start_index, Unsigned end_index);
 extern Integer Fiducials__points_minimum(Fiducials fiducials,
@@ -18,6 +18,11 @@ extern "C" {
 /// @brief *FILE* is a file I/O object.
 typedef FILE *File;
 
+/// @brief *File_Reader* is a block buffered reader that slurps an
+/// entire file into memory and serves the parse routines from the
+/// buffer (the structure itself is private to File.c.)
+typedef struct File_Reader__Struct *File_Reader;
+
 // External declarations:
 extern Unsigned File__byte_read(File file);
 extern void File__byte_write(File file, Unsigned byte);
@@ -33,6 +38,16 @@ extern File File__open(String file_name, String flags);
 extern void File__string_match(File in_file, String pattern);
 extern void File__tag_match(File in_file, String tag_name);
 
+extern Character File_Reader__character_read(File_Reader reader);
+extern void File_Reader__close(File_Reader reader);
+extern Float File_Reader__float_attribute_read(
+  File_Reader reader, String attribute_name);
+extern Integer File_Reader__integer_attribute_read(
+  File_Reader reader, String attribute_name);
+extern File_Reader File_Reader__open(String file_name);
+extern void File_Reader__string_match(File_Reader reader, String pattern);
+extern void File_Reader__tag_match(File_Reader reader, String tag_name);
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,50 @@
+// Copyright (c) 2013 by Wayne C. Gramlich.  All rights reserved.
+
+#if !defined(HEAP_H_INCLUDED)
+#define HEAP_H_INCLUDED 1
+
+#include "List.h"
+#include "Memory.h"
+#include "Unsigned.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/// @brief *Heap* is a pointer to a binary heap object.
+typedef struct Heap__Struct *Heap;
+
+/// @brief A procedure variable signature for comparing two *Memory* objects.
+typedef Integer (*Heap__Compare__Routine)(Memory, Memory);
+
+/// @brief *Heap__Struct* is the structure for a binary heap of items.
+/// *Heap__pop*() always returns the item that *compare_routine* sorts
+/// last, so a heap is a drop-in replacement for the keep-a-*List*-
+/// sorted-and-pop-the-end pattern, with O(log n) pushes and pops in
+/// place of a full sort per insertion batch.
+struct Heap__Struct {
+    /// @brief The ordering routine; the item it sorts last pops first.
+    Heap__Compare__Routine compare_routine;
+
+    /// @brief The items, stored in the usual implicit binary tree
+    /// layout (the children of item *i* are items 2*i+1 and 2*i+2.)
+    Memory *items;
+
+    /// @brief The maximum number of items before a resize is required.
+    Unsigned limit;
+
+    /// @brief The current number of items in the heap.
+    Unsigned size;
+};
+
+// *Heap* routines:
+
+extern void Heap__all_push(Heap heap, List list);
+extern Heap Heap__new(Heap__Compare__Routine compare_routine);
+extern Memory Heap__pop(Heap heap);
+extern void Heap__push(Heap heap, Memory item);
+extern Unsigned Heap__size(Heap heap);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // !defined(HEAP_H_INCLUDED)
@@ -5,13 +5,21 @@
 
 #include <opencv2/highgui/highgui_c.h>
 
+#include "Character.h"
 #include "Double.h"
 #include "Integer.h"
+#include "Logical.h"
+#include "Unsigned.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 typedef CvCapture *CV_Capture;
+
+/// @brief *CV_Viewer* is a decoupled display viewer that consumes
+/// frames from a single-slot mailbox at its own throttled rate (the
+/// structure itself is private to High_GUI2.c.)
+typedef struct CV_Viewer__Struct *CV_Viewer;
 typedef CvVideoWriter *CV_Video_Writer;
 
 extern CvCapture CV_Capture__Initial;
@@ -40,6 +48,12 @@ extern Integer CV_Video_Writer__write_frame(
   CV_Video_Writer writer, CV_Image frame);
 extern Integer CV__wait_key(Integer delay);
 
+extern CV_Viewer CV_Viewer__create(
+  String window_name, Unsigned interval_milliseconds);
+extern void CV_Viewer__free(CV_Viewer viewer);
+extern Character CV_Viewer__key_get(CV_Viewer viewer);
+extern Logical CV_Viewer__submit(CV_Viewer viewer, CV_Image image);
+
 #ifdef __cplusplus
 }
 #endif
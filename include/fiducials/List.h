@@ -19,9 +19,14 @@ typedef Integer (*List__Compare__Routine)(Memory, Memory);
 /// for equality.
 typedef Logical (*List__Equal__Routine)(Memory, Memory);
 
+/// @brief The number of items that fit into the inline buffer of a
+/// *List__Struct* before the list spills over into the heap.
+#define LIST__INLINE_LIMIT 4
+
 /// @brief *List__Struct* is the structure for a list of items.
 struct List__Struct {
     /// @brief The items of data.  Always at least 1 item is available.
+    /// Points at *inline_items* until the list outgrows it.
     Memory *items;
 
     /// @brief The maximum number of items before a resize is required.
@@ -29,6 +34,10 @@ struct List__Struct {
 
     /// @brief the current number items in the list.
     Unsigned size;
+
+    /// @brief Inline storage for the first few items, so that short
+    /// lived short lists never touch the heap allocator.
+    Memory inline_items[LIST__INLINE_LIMIT];
 };
 
 // *List* routines:
@@ -36,7 +45,9 @@ struct List__Struct {
 extern void List__all_append(List to_list, List from_list);
 extern void List__append(List list, Memory item);
 extern List List__new(void);
+extern List List__new_with_capacity(Unsigned capacity);
 extern Memory List__pop(List list);
+extern void List__reserve(List list, Unsigned capacity);
 extern void List__sort(List list1, List__Compare__Routine compare_routine);
 extern Memory List__fetch(List list, Unsigned index);
 extern Unsigned List__size(List list);
@@ -32,6 +32,8 @@ struct Location__Struct {
 
 extern Location Location__create(
   Double x, Double y, Double bearing, Double goodness, Unsigned index);
+extern Location Location__initialize(Location location,
+  Double x, Double y, Double bearing, Double goodness, Unsigned index);
 
 #ifdef __cplusplus
 }
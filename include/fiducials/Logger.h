@@ -0,0 +1,35 @@
+// Copyright (c) 2013 by Wayne C. Gramlich.  All rights reserved.
+
+#if !defined(LOGGER_H_INCLUDED)
+#define LOGGER_H_INCLUDED 1
+
+#include "File.h"
+#include "Logical.h"
+#include "Unsigned.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// @brief Chatty diagnostics that are only useful when debugging.
+#define LOGGER__LEVEL_DEBUG 0
+
+/// @brief Normal progress messages (e.g. per frame location announces.)
+#define LOGGER__LEVEL_INFO 1
+
+/// @brief Unexpected but recoverable conditions.
+#define LOGGER__LEVEL_WARN 2
+
+/// @brief Errors; these are never filtered out.
+#define LOGGER__LEVEL_ERROR 3
+
+// External declarations:
+extern void Logger__format(Unsigned level, const char * format, ...);
+extern void Logger__level_set(Unsigned level);
+extern void Logger__start(File file);
+extern void Logger__stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // !defined(LOGGER_H_INCLUDED)
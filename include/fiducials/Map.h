@@ -3,10 +3,15 @@
 #if !defined(MAP_H_INCLUDED)
 #define MAP_H_INCLUDED 1
 
+#include <pthread.h>
+#include <stdatomic.h>
+
 #include "File.h"
+#include "Heap.h"
 #include "List.h"
 #include "Location.h"
 #include "Table.h"
+#include "Table_Unsigned.h"
 #include "Unsigned.h"
 
 /// @brief *Map* is the representation of a fiducial marker map.
@@ -21,6 +26,64 @@ extern "C" {
 typedef void (*Map_Tag_Announce_Routine)(void *object, Integer id,
   Double x, Double y, Double z, Double twist, Double dx, Double dy, Double dz);
 
+/// @brief Tag ids below this bound live in the direct index *tags_dense*
+/// array; only ids at or above it fall back to the *tags_table* hash.
+/// Tags.c allocates ids densely from 0 upward, so in practice every
+/// lookup takes the dense path.
+#define MAP__TAGS_DENSE_LIMIT 1024
+
+/// @brief The maximum number of pose propagation worker threads.
+#define MAP__UPDATE_THREADS_MAXIMUM 16
+
+typedef struct Map_Binary_Arc__Struct *Map_Binary_Arc;
+typedef struct Map_Binary_Tag__Struct *Map_Binary_Tag;
+typedef struct Map_Share_Header__Struct *Map_Share_Header;
+
+/// @brief One fixed layout tag record (the same fields as
+/// *Tag__write*(), with angles in radians.)  Used by the binary
+/// snapshot format, the arc journal, and the shared memory segment.
+struct Map_Binary_Tag__Struct {
+    Double diagonal;
+    Double twist;
+    Double x;
+    Double y;
+    Unsigned hop_count;
+    Unsigned id;
+};
+
+/// @brief One fixed layout arc record (the same fields as
+/// *Arc__write*(), with angles in radians.)
+struct Map_Binary_Arc__Struct {
+    Double distance;
+    Double from_twist;
+    Double goodness;
+    Double to_twist;
+    Unsigned from_tag_id;
+    Unsigned to_tag_id;
+    Unsigned in_tree;
+    Unsigned pad;
+};
+
+/// @brief The header of a published shared memory map segment.  The
+/// tag records start right after the header and the arc records start
+/// after *tags_capacity* tag records (see *Map__share_tags*() and
+/// *Map__share_arcs*().)  *generation* follows a seqlock protocol: the
+/// publisher makes it odd before rewriting the records and even again
+/// afterwards, so a consumer reads the generation, copies what it
+/// needs, and retries if the generation was odd or changed.  The
+/// atomic loads/stores and fences that make the protocol sound are
+/// spelled out on *Map__share_attach*().
+struct Map_Share_Header__Struct {
+    Unsigned magic;
+    Unsigned version;
+    _Atomic Unsigned generation;
+    Unsigned tags_capacity;
+    Unsigned arcs_capacity;
+    Unsigned tags_size;
+    Unsigned arcs_size;
+    Unsigned pad;
+};
+
 /// @brief A *Map__Struct* represents the fiducial location map.
 struct Map__Struct {
     /// @brief All of the *Arc*'s (i.e. measured intertag distances) in the map.
@@ -32,14 +95,96 @@ struct Map__Struct {
     /// @brief Object passed into announce routine.
     void *announce_object;
 
-    /// @brief An lookup *Arc* table.
-    Table /* <Arc, Arc> */ arcs_table;
+    /// @brief Existing *Arc*'s whose geometry was refined since the
+    /// last *Map__update*() (feeds the incremental propagation path.)
+    List /* <Arc> */ changed_arcs;
+
+    /// @brief Incrementally maintained XOR of the per tag and per arc
+    /// content hashes.  Equal checksums mean equal map content, so
+    /// change detection and map equality are a single comparison.
+    Unsigned checksum;
+
+    /// @brief Per cell *Tag* lists of the spatial grid index (null
+    /// until the first neighborhood query builds the grid.)
+    List /* <Tag> */ *grid_cells;
+
+    /// @brief The number of cell lists allocated in *grid_cells*.
+    Unsigned grid_cells_size;
+
+    /// @brief The map *checksum* the grid was last rebuilt at; a
+    /// mismatch triggers a lazy rebuild on the next query.
+    Unsigned grid_checksum;
+
+    /// @brief The number of grid columns (X direction.)
+    Unsigned grid_columns;
+
+    /// @brief The largest half diagonal of any indexed tag.
+    Double grid_half_diagonal_maximum;
+
+    /// @brief The number of grid rows (Y direction.)
+    Unsigned grid_rows;
+
+    /// @brief The edge length of one square grid cell.
+    Double grid_side;
+
+    /// @brief True once the grid reflects *grid_checksum*.
+    Logical grid_valid;
+
+    /// @brief The bounding box of the indexed tag centers.
+    Double grid_x_maximum;
+
+    /// @brief See *grid_x_maximum*.
+    Double grid_x_minimum;
+
+    /// @brief See *grid_x_maximum*.
+    Double grid_y_maximum;
+
+    /// @brief See *grid_x_maximum*.
+    Double grid_y_minimum;
 
     /// @brief True if map has changed since last update.
     Logical is_changed;
 
-    /// @brief List of pending *Arc*'s for map tree extraction.
-    List /* <Arc> */ pending_arcs;
+    /// @brief Serializes map access when several detector threads share
+    /// one map (see *Map__lock*()/*Map__unlock*().)
+    pthread_mutex_t lock;
+
+    /// @brief Process id of the in-flight checkpoint child (0 if none.)
+    Integer journal_checkpoint_pid;
+
+    /// @brief Open append-only arc journal (null when journaling is off.)
+    File journal_file;
+
+    /// @brief File name of the open journal.
+    String journal_file_name;
+
+    /// @brief Min-heap (keyed on arc distance) of the pending *Arc*'s
+    /// for map tree extraction.
+    Heap /* <Arc> */ pending_arcs;
+
+    /// @brief The full-rebuild propagation schedule: every *Tag* the
+    /// spanning tree extraction reached, re-sorted by *hop_count* so
+    /// poses can be propagated one tree level at a time.
+    List /* <Tag> */ propagate_tags;
+
+    /// @brief Mapped shared memory segment (null when not publishing.)
+    Map_Share_Header share_header;
+
+    /// @brief File descriptor of the shared memory segment.
+    Integer share_fd;
+
+    /// @brief The SVG scale/offset of the previous render; a change
+    /// invalidates every cached tag fragment.
+    Double svg_x_offset;
+
+    /// @brief See *svg_x_offset*.
+    Double svg_x_scale;
+
+    /// @brief See *svg_x_offset*.
+    Double svg_y_offset;
+
+    /// @brief See *svg_x_offset*.
+    Double svg_y_scale;
 
     /// @brief Routine that is called each time a tag is changed.
     Map_Tag_Announce_Routine tag_announce_routine;
@@ -47,11 +192,19 @@ struct Map__Struct {
     /// @brief List of all known tag heights:
     List /* <Tag_Height> */ tag_heights;
 
-    /// @brief Table of all *tags* indexed by *Tag* *id*.
-    Table /* <Unsigned, Tag>*/ tags_table;
+    /// @brief Direct index array of the *Tag*'s with an id below
+    /// *tags_dense_size* (null means not yet created.)
+    Tag *tags_dense;
+
+    /// @brief The number of slots in *tags_dense*.
+    Unsigned tags_dense_size;
+
+    /// @brief Table of the *tags* with an id of *tags_dense_size* or more.
+    Table_Unsigned /* <Unsigned, Tag>*/ tags_table;
 
-    /// @brief a te
-    Arc temporary_arc;
+    /// @brief Worker thread count for the level-synchronous pose
+    /// propagation in *Map__update*() (see *Map__update_threads_set*().)
+    Unsigned update_threads;
 
     /// @brief Increment *visit* each time a map update is propogated.
     Unsigned visit;
@@ -60,24 +213,46 @@ struct Map__Struct {
 // *Map* routines:
 
 extern void Map__arc_append(Map map, Arc arc);
+extern void Map__arc_changed(Map map, Arc arc);
 extern Arc Map__arc_lookup(Map map, Tag from, Tag to);
 extern Unsigned Map__arc_update(
   Map map, Camera_Tag camera_from, Camera_Tag camera_to, CV_Image image);
+extern Unsigned Map__arc_updates(
+  Map map, List /* <Camera_Tag> */ camera_tags, CV_Image image);
+extern Map Map__binary_restore(const char * file_name);
+extern void Map__binary_save(Map map, const char * file_name);
+extern void Map__checksum_arc(Map map, Arc arc);
+extern void Map__checksum_tag(Map map, Tag tag);
 extern Integer Map__compare(Map map1, Map map2);
 extern Double Map__distance_per_pixel(Map map, Unsigned id);
+extern void Map__journal_checkpoint(Map map, const char * snapshot_file_name);
+extern void Map__lock(Map map);
+extern void Map__journal_open(Map map, const char * file_name);
+extern void Map__journal_replay(Map map, const char * file_name);
+extern Map Map__journal_restore(
+  const char * snapshot_file_name, const char * journal_file_name);
 extern Map Map__new(
   void *announce_object, Map_Tag_Announce_Routine announce_routine);
-extern Map Map__read(File in_file);
+extern Map Map__read(File_Reader in_file);
 extern Map Map__restore(const char * file_name);
 extern void Map__save(Map map, const char * file_name);
+extern Map_Binary_Arc Map__share_arcs(Map_Share_Header share_header);
+extern Map_Share_Header Map__share_attach(const char * share_name);
+extern void Map__share_detach(Map_Share_Header share_header);
+extern void Map__share_publish(Map map, const char * share_name);
+extern Map_Binary_Tag Map__share_tags(Map_Share_Header share_header);
 extern void Map__sort(Map map);
 extern void Map__svg_write(
   Map map, const char * svg_base_name, List /*<Location>*/ locations);
-extern void Map__tag_heights_xml_read(Map map, File xml_in_file);
+extern void Map__tag_heights_xml_read(Map map, File_Reader xml_in_file);
+extern void Map__unlock(Map map);
 extern void Map__tag_announce(void *object, Integer id,
   Double x, Double y, Double z, Double twist, Double dx, Double dy, Double dz);
 extern Tag Map__tag_lookup(Map map, Unsigned tag_id);
+extern Unsigned Map__tags_near(
+  Map map, Double x, Double y, Double radius, List /* <Tag> */ tags);
 extern void Map__update(Map map);
+extern void Map__update_threads_set(Map map, Unsigned update_threads);
 extern void Map__write(Map map, File out_file);
 
 #ifdef __cplusplus
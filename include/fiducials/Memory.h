@@ -28,9 +28,23 @@ extern "C" {
 /// @brief *Memory* is a pointer to memory.
 typedef void *Memory;
 
+/// @brief *Memory_Arena* is a bump allocator for short lived objects.
+///
+/// An arena hands out storage from a chain of large blocks with a
+/// simple pointer bump, so individual allocations never hit the global
+/// allocator and never need to be freed one at a time.  Instead,
+/// *Memory__arena_reset*() recycles every allocation in the arena at
+/// once (the blocks are kept for reuse.)  The typical use is a
+/// per-frame arena that is reset at the start of each frame.
+typedef struct Memory_Arena__Struct *Memory_Arena;
+
 // Extern declarations:
 
 extern Memory Memory__allocate(Unsigned bytes);
+extern Memory Memory__arena_allocate(Memory_Arena arena, Unsigned bytes);
+extern Memory_Arena Memory__arena_create(Unsigned block_size);
+extern void Memory__arena_free(Memory_Arena arena);
+extern void Memory__arena_reset(Memory_Arena arena);
 extern void Memory__free(Memory memory);
 extern Memory Memory__reallocate(Memory memory, Unsigned new_size);
 extern Memory Unsigned__to_memory(Unsigned unsigned1);
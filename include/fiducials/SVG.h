@@ -26,6 +26,16 @@ struct SVG__Struct {
     /// @brief The output stream.
     File stream;
 
+    /// @brief The growable output buffer; everything is accumulated
+    /// here and written to *stream* with one write at close time.
+    String buffer;
+
+    /// @brief The number of bytes allocated for *buffer*.
+    Unsigned buffer_limit;
+
+    /// @brief The number of bytes currently used in *buffer*.
+    Unsigned buffer_size;
+
     /// @brief Hight of SVG image.
     Double height;
 
@@ -50,11 +60,14 @@ struct SVG__Struct {
 
 // External declarations:
 
+extern void SVG__append(SVG svg, String fragment);
 extern void SVG__cartesian_scale(
   SVG svg, Double x_width, Double y_height, Bounding_Box bounding_box);
 extern void SVG__close(SVG svg);
+extern String SVG__fragment(SVG svg, Unsigned mark);
 extern void SVG__line(SVG svg,
   Double x1, Double y1, Double x2, Double y2, String stroke);
+extern Unsigned SVG__mark(SVG svg);
 extern SVG SVG__open(String base_name,
   Double width, Double height, Double x_scale, Double y_scale, String units);
 extern void SVG__rectangle(SVG svg, Double x, Double y,
@@ -17,6 +17,8 @@ typedef char *String;
 extern Logical String__equal(String string1, String string2);
 extern String String__allocate(Unsigned size);
 extern String String__format(String format, ...);
+extern Unsigned String__format_into(
+  String buffer, Unsigned buffer_size, String format, ...);
 extern void String__free(String string);
 extern Unsigned String__size(String string);
 extern Unsigned String__to_unsigned(String string);
@@ -12,8 +12,17 @@
 #ifdef __cplusplus
 extern "C" {
 #endif
+
+// The default *Table* backend is open addressing (linear probing over a
+// flat slot array.)  Define TABLE__CHAINED to fall back to the original
+// chained (*Table_List* per bucket) backend:
+#if !defined(TABLE__CHAINED)
+#define TABLE__OPEN_ADDRESSING 1
+#endif
+
 typedef struct Table_Struct *Table;
 typedef struct Table_List_Struct *Table_List;
+typedef struct Table_Slot_Struct *Table_Slot;
 typedef struct Table_Triple_Struct *Table_Triple;
 
 typedef Logical (*Table_Equal_Routine)(Memory, Memory);
@@ -23,8 +32,13 @@ typedef void (*Table_Value_Show_Routine)(Memory, File);
 
 struct Table_Struct
 {
+#if defined(TABLE__OPEN_ADDRESSING)
+    Table_Slot slots;
+    Unsigned slots_size;
+#else
     Table_List *table_lists;
     Unsigned table_lists_size;
+#endif
     Memory empty_value;
     Table_Equal_Routine equal_routine;
     Table_Hash_Routine hash_routine;
@@ -34,6 +48,16 @@ struct Table_Struct
     Table_Value_Show_Routine value_show_routine;
 };
 
+/// @brief *Table_Slot_Struct* is one slot of the open addressing
+/// backend.  A zero *used* flag marks an empty slot.
+struct Table_Slot_Struct
+{
+    Unsigned hash;
+    Memory key;
+    Memory value;
+    Logical used;
+};
+
 /// @brief *Table__Triple_Struct* contains a key/value binding.
 struct Table_Triple_Struct
 {
@@ -67,6 +91,7 @@ extern void Table__show_enable(Table table,
   Table_Key_Show_Routine key_show_routine,
   Table_Value_Show_Routine value_show_routine);
 
+#if !defined(TABLE__OPEN_ADDRESSING)
 // *Table__List* routine:
 
 extern Table_List Table_List__append(
@@ -81,6 +106,7 @@ extern Table_Triple Table_List__search(
 extern void Table_List__show(Table_List table_list, File file,
   Table_Key_Show_Routine key_show_routine,
   Table_Value_Show_Routine value_show_routine);
+#endif // !defined(TABLE__OPEN_ADDRESSING)
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,206 @@
+// Copyright (c) 2013 by Wayne C. Gramlich.  All rights reserved.
+
+#ifndef TABLE_UNSIGNED_H_INCLUDED
+#define TABLE_UNSIGNED_H_INCLUDED 1
+
+#include <assert.h>
+
+#include "Logical.h"
+#include "Memory.h"
+#include "Unsigned.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// *Table_Unsigned* is a hand specialized copy of the open addressing
+// *Table* backend (see Table.c) for *Unsigned* keys.  The identity hash
+// and the key comparison are spelled out inline instead of going
+// through the *hash_routine*/*equal_routine* procedure variables, so a
+// probe performs no indirect calls.  Everything lives in this header as
+// *static* *inline* routines so the compiler can flatten a whole lookup
+// into the caller.  If the generic backend in Table.c changes, this
+// specialization needs to be regenerated to match.
+
+typedef struct Table_Unsigned_Struct *Table_Unsigned;
+typedef struct Table_Unsigned_Slot_Struct *Table_Unsigned_Slot;
+
+/// @brief *Table_Unsigned_Slot_Struct* is one slot of the table.  A
+/// zero *used* flag marks an empty slot.
+struct Table_Unsigned_Slot_Struct
+{
+    Unsigned key;
+    Memory value;
+    Logical used;
+};
+
+struct Table_Unsigned_Struct
+{
+    Table_Unsigned_Slot slots;
+    Unsigned slots_size;
+    Memory empty_value;
+    Unsigned size;
+    Unsigned threshold;
+};
+
+/// @brief Allocates and returns *slots_size* empty slots.
+/// @param slots_size is the number of slots to allocate.
+/// @returns the empty slot array.
+
+static inline Table_Unsigned_Slot Table_Unsigned__slots_allocate(
+  Unsigned slots_size)
+{
+    Table_Unsigned_Slot slots = (Table_Unsigned_Slot)Memory__allocate(
+      slots_size * sizeof(struct Table_Unsigned_Slot_Struct));
+    for (Unsigned index = 0; index < slots_size; index++)
+    {
+	slots[index].used = (Logical)0;
+    }
+    return slots;
+}
+
+/// @brief Returns the slot in *table* that either holds *key* or is the
+///        empty slot where *key* would go.
+/// @param table is the table to probe.
+/// @param key is the key to probe for.
+/// @returns the matching or empty slot.
+
+static inline Table_Unsigned_Slot Table_Unsigned__probe(
+  Table_Unsigned table, Unsigned key)
+{
+    Table_Unsigned_Slot slots = table->slots;
+    Unsigned mask = table->slots_size - 1;
+    Unsigned index = key & mask;
+    while (1)
+    {
+	Table_Unsigned_Slot slot = &slots[index];
+	if (!slot->used || slot->key == key)
+	{
+	    return slot;
+	}
+	index = (index + 1) & mask;
+    }
+}
+
+/// @brief Returns a newly created table for *Unsigned* key/value
+///        bindings.
+/// @param empty_value is a value that is returned on lookup failure.
+/// @returns the new empty table.
+
+static inline Table_Unsigned Table_Unsigned__create(Memory empty_value)
+{
+    Unsigned slots_size = 8;
+    Table_Unsigned table = Memory__new(Table_Unsigned);
+    table->slots = Table_Unsigned__slots_allocate(slots_size);
+    table->slots_size = slots_size;
+    table->empty_value = empty_value;
+    table->size = 0;
+    table->threshold = 6;
+    return table;
+}
+
+/// @brief Frees the storage associated with *table*.
+/// @param table is the table to free.  The values in *table* are not
+///        freed.
+
+static inline void Table_Unsigned__free(Table_Unsigned table)
+{
+    Memory__free((Memory)table->slots);
+    Memory__free((Memory)table);
+}
+
+/// @brief Double the number of slots in *table*.
+/// @param table is the table to resize.
+
+static inline void Table_Unsigned__resize(Table_Unsigned table)
+{
+    Table_Unsigned_Slot old_slots = table->slots;
+    Unsigned old_slots_size = table->slots_size;
+    Unsigned new_slots_size = old_slots_size << 1;
+    table->slots = Table_Unsigned__slots_allocate(new_slots_size);
+    table->slots_size = new_slots_size;
+    table->threshold = new_slots_size * 3 / 4;
+    for (Unsigned index = 0; index < old_slots_size; index++)
+    {
+	Table_Unsigned_Slot old_slot = &old_slots[index];
+	if (old_slot->used)
+	{
+	    Table_Unsigned_Slot new_slot =
+	      Table_Unsigned__probe(table, old_slot->key);
+	    *new_slot = *old_slot;
+	}
+    }
+    Memory__free((Memory)old_slots);
+}
+
+/// @brief Returns true if *key* is in *table*.
+/// @param table is the table to search *key* for.
+/// @param key is the key to look for in *table*.
+/// @returns true (1) for success and false (0) otherwise.
+
+static inline Logical Table_Unsigned__has_key(Table_Unsigned table,
+  Unsigned key)
+{
+    return Table_Unsigned__probe(table, key)->used;
+}
+
+/// @brief Inserts a *key*-*value* binding into *table*.
+/// @param table is the table to insert the *key*-*value* binding into.
+/// @param key is the key portion of the key/value binding.
+/// @param value is the value portion of the key/value binding.
+///
+/// An assertion failure occurs if *table* already has *key* in it.
+
+static inline void Table_Unsigned__insert(Table_Unsigned table,
+  Unsigned key, Memory value)
+{
+    Unsigned size = table->size;
+    if (size >= table->threshold)
+    {
+	Table_Unsigned__resize(table);
+    }
+    Table_Unsigned_Slot slot = Table_Unsigned__probe(table, key);
+    assert (!slot->used);
+    slot->key = key;
+    slot->value = value;
+    slot->used = (Logical)1;
+    table->size = size + 1;
+}
+
+/// @brief Return the value associated with *key* in *table*.
+/// @param table is the table to search for *key* in.
+/// @param key is the key value to search for in *table*.
+/// @returns the value associated with *key* on success and the empty
+///          value otherwise.
+
+static inline Memory Table_Unsigned__lookup(Table_Unsigned table,
+  Unsigned key)
+{
+    Table_Unsigned_Slot slot = Table_Unsigned__probe(table, key);
+    Memory value = table->empty_value;
+    if (slot->used)
+    {
+	value = slot->value;
+    }
+    return value;
+}
+
+/// @brief Replace the *value* associated with *key* in *table*.
+/// @param table is the table to replace the *key*-*value* binding in.
+/// @param key is the key to search for in *table*.
+/// @param value is the new value to bind to *key*.
+///
+/// An assertion failure occurs if *key* is not in *table*.
+
+static inline void Table_Unsigned__replace(Table_Unsigned table,
+  Unsigned key, Memory value)
+{
+    Table_Unsigned_Slot slot = Table_Unsigned__probe(table, key);
+    assert (slot->used);
+    slot->value = value;
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif // TABLE_UNSIGNED_H_INCLUDED
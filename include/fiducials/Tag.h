@@ -67,11 +67,15 @@ struct Tag__Struct {
     /// @brief List *Arc*'s connected to this *Tag*.
     List /* <Arc>*/ arcs;
 
+    /// @brief This tag's current contribution to the incremental map
+    /// checksum (see *Map__checksum_tag*().)
+    Unsigned checksum;
+
     /// @brief Fiducial tag diagnal distance in camera pixels.
-    Double diagonal;
+    Fiducials_Real diagonal;
 
     /// @brief Distance per camera pixel.
-    Double distance_per_pixel;
+    Fiducials_Real distance_per_pixel;
 
     ///@brief True if rest of *Tag* is initialized.
     Logical initialized;
@@ -85,17 +89,33 @@ struct Tag__Struct {
     /// @brief Parent *Map* object.
     Map map;
 
+    /// @brief The tag *checksum* the cached SVG fragment was rendered
+    /// at (see *Map__svg_write*().)
+    Unsigned svg_checksum;
+
+    /// @brief Cached SVG fragment from the previous render (null if
+    /// none.)
+    String svg_fragment;
+
     /// @brief The twist from the floor X axis to the tag bottom edge.
-    Double twist;
+    Fiducials_Real twist;
+
+    /// @brief Transient: the spanning tree arc this tag's pose
+    /// propagates through (valid only inside *Map__update*().)
+    Arc update_arc;
+
+    /// @brief Transient: true if the last propagation moved this tag
+    /// (valid only inside *Map__update*().)
+    Logical update_changed;
 
     /// @brief Visit counter.
     Unsigned visit;
 
     /// @brief Absolute X floor coordinate.
-    Double x;
+    Fiducials_Real x;
 
     /// @brief Absolute Y floor coordinate.
-    Double y;
+    Fiducials_Real y;
 };
 
 /// @brief A *Tag_Height__Struct* represents a span of tags a the same
@@ -114,6 +134,7 @@ struct Tag_Height__Struct {
 // *Tag* routines;
 
 extern void Tag__arc_append(Tag tag, Arc arc);
+extern Logical Tag__arc_propagate(Tag tag, Arc arc);
 extern void Tag__bounding_box_update(Tag tag, Bounding_Box bounding_box);
 extern Tag Tag__create(Unsigned id, Map map);
 extern Integer Tag__compare(Tag tag1, Tag tag2);
@@ -122,7 +143,7 @@ extern Unsigned Tag__hash(Tag tag);
 extern void Tag__initialize(
   Tag tag, Double angle, Double x, Double y, Double diagonal, Unsigned visit);
 extern void Tag__sort(Tag tag);
-extern Tag Tag__read(File in_file, Map map);
+extern Tag Tag__read(File_Reader in_file, Map map);
 extern void Tag__svg_write(Tag tag, SVG svg);
 extern void Tag__write(Tag tag, File out_file);
 extern void Tag__update_via_arc(Tag tag, Arc arc);
@@ -130,7 +151,7 @@ extern void Tag__update_via_arc(Tag tag, Arc arc);
 // *Tag_Height* routines:
 extern Integer Tag_Height__compare(
   Tag_Height tag_height1, Tag_Height tag_height2);
-extern Tag_Height Tag_Height__xml_read(File in_file);
+extern Tag_Height Tag_Height__xml_read(File_Reader in_file);
 
 #ifdef __cplusplus
 }